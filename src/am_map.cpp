@@ -1770,6 +1770,7 @@ void DAutomap::drawGrid (int color)
 	double minx, miny;
 	auto bmaporgx = Level->blockmap.bmaporgx;
 	auto bmaporgy = Level->blockmap.bmaporgy;
+	int blocksize = Level->blockmap.BlockSize;
 
 	// [RH] Calculate a minimum for how long the grid lines should be so that
 	// they cover the screen at any rotation.
@@ -1782,12 +1783,12 @@ void DAutomap::drawGrid (int color)
 
 	// Figure out start of vertical gridlines
 	start = minx - extx;
-	start = ceil((start - bmaporgx) / FBlockmap::MAPBLOCKUNITS) * FBlockmap::MAPBLOCKUNITS + bmaporgx;
+	start = ceil((start - bmaporgx) / blocksize) * blocksize + bmaporgx;
 
 	end = minx + minlen - extx;
 
 	// draw vertical gridlines
-	for (x = start; x < end; x += FBlockmap::MAPBLOCKUNITS)
+	for (x = start; x < end; x += blocksize)
 	{
 		ml.a.x = x;
 		ml.b.x = x;
@@ -1803,11 +1804,11 @@ void DAutomap::drawGrid (int color)
 
 	// Figure out start of horizontal gridlines
 	start = miny - exty;
-	start = ceil((start - bmaporgy) / FBlockmap::MAPBLOCKUNITS) * FBlockmap::MAPBLOCKUNITS + bmaporgy;
+	start = ceil((start - bmaporgy) / blocksize) * blocksize + bmaporgy;
 	end = miny + minlen - exty;
 
 	// draw horizontal gridlines
-	for (y=start; y<end; y+=FBlockmap::MAPBLOCKUNITS)
+	for (y=start; y<end; y+=blocksize)
 	{
 		ml.a.x = minx - extx;
 		ml.b.x = ml.a.x + minlen;
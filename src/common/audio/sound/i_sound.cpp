@@ -46,6 +46,7 @@
 #include "v_text.h"
 #include "c_cvars.h"
 #include "stats.h"
+#include "m_fixed.h"
 #include <zmusic.h>
 
 
@@ -338,6 +339,66 @@ FString SoundStream::GetStats()
 	return "No stream stats available.";
 }
 
+//==========================================================================
+//
+// S_DecodeSound
+//
+// Decodes any format ZMusic knows about. Loop points are converted to
+// samples.
+//
+//==========================================================================
+
+bool S_DecodeSound(const uint8_t *sfxdata, int length, FDecodedSound &out)
+{
+	ChannelConfig chans;
+	SampleType type;
+	int srate;
+	uint32_t loop_start = 0, loop_end = ~0u;
+	zmusic_bool startass = false, endass = false;
+
+	FindLoopTags(sfxdata, length, &loop_start, &startass, &loop_end, &endass);
+	auto decoder = CreateDecoder(sfxdata, length, true);
+	if (!decoder)
+		return false;
+
+	SoundDecoder_GetInfo(decoder, &srate, &chans, &type);
+	if ((chans != ChannelConfig_Mono && chans != ChannelConfig_Stereo) ||
+		(type != SampleType_UInt8 && type != SampleType_Int16))
+	{
+		SoundDecoder_Close(decoder);
+		out.Error.Format("Unsupported audio format: %s, %s\n", GetChannelConfigName(chans),
+			GetSampleTypeName(type));
+		return false;
+	}
+	out.Frequency = srate;
+	out.Channels = chans == ChannelConfig_Stereo ? 2 : 1;
+	out.Bits = type == SampleType_Int16 ? 16 : 8;
+
+	unsigned total = 0;
+	unsigned got;
+
+	out.Data.Resize(total + 32768);
+	while ((got = (unsigned)SoundDecoder_Read(decoder, (char*)&out.Data[total], out.Data.Size() - total)) > 0)
+	{
+		total += got;
+		out.Data.Resize(total * 2);
+	}
+	out.Data.Resize(total);
+	SoundDecoder_Close(decoder);
+	if (total == 0)
+	{
+		return false;
+	}
+
+	if (!startass) loop_start = Scale(loop_start, srate, 1000);
+	if (!endass && loop_end != ~0u) loop_end = Scale(loop_end, srate, 1000);
+	const uint32_t samples = total / (out.Channels * out.Bits / 8);
+	if (loop_start > samples) loop_start = 0;
+	out.LoopStart = loop_start;
+	out.LoopEnd = loop_end < samples ? int(loop_end) : -1;
+	return true;
+}
+
 //==========================================================================
 //
 // SoundRenderer :: LoadSoundVoc
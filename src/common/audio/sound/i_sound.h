@@ -88,6 +88,21 @@ typedef bool (*SoundStreamCallback)(SoundStream *stream, void *buff, int len, vo
 struct SoundDecoder;
 class MIDIDevice;
 
+// A compressed sound decoded to PCM, in the form LoadSoundRaw takes it.
+struct FDecodedSound
+{
+	TArray<uint8_t> Data;
+	int Frequency = 0;
+	int Channels = 0;
+	int Bits = 0;
+	int LoopStart = -1;
+	int LoopEnd = -1;
+	FString Error;
+};
+
+// Does not touch the sound device or print anything, so this may be called from any thread.
+bool S_DecodeSound(const uint8_t *sfxdata, int length, FDecodedSound &out);
+
 class SoundRenderer
 {
 public:
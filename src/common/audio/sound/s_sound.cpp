@@ -35,6 +35,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 #include "s_soundinternal.h"
@@ -44,8 +47,10 @@
 #include "m_random.h"
 #include "printf.h"
 #include "c_cvars.h"
+#include "i_time.h"
 
 CVARD(Bool, snd_enabled, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG, "enables/disables sound effects")
+CVARD(Bool, snd_asyncload, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG, "decode sounds that are not loaded yet in the background instead of stalling the game")
 
 int SoundEnabled()
 {
@@ -59,6 +64,75 @@ enum
 static FRandom pr_soundpitch ("SoundPitch");
 SoundEngine* soundEngine;
 
+//==========================================================================
+//
+// FSoundLoader
+//
+// A worker thread that decodes compressed sounds. Reading the lump and
+// handing the decoded data to the sound device are left to the main
+// thread, because neither the file system nor the device may be used
+// from here.
+//
+//==========================================================================
+
+struct FSoundLoader
+{
+	struct Job
+	{
+		int SoundID;
+		TArray<uint8_t> Lump;
+		FDecodedSound Decoded;
+		bool Success = false;
+	};
+
+	std::thread Thread;
+	std::mutex Lock;
+	std::condition_variable Wake;
+	std::condition_variable Idle;
+	TArray<Job*> Queue;
+	TArray<Job*> Done;
+	int Busy = 0;
+	bool Exit = false;
+
+	FSoundLoader()
+	{
+		Thread = std::thread([this] { Run(); });
+	}
+
+	~FSoundLoader()
+	{
+		{
+			std::unique_lock<std::mutex> lock(Lock);
+			Exit = true;
+		}
+		Wake.notify_all();
+		Thread.join();
+		for (auto job : Queue) delete job;
+		for (auto job : Done) delete job;
+	}
+
+	void Run()
+	{
+		std::unique_lock<std::mutex> lock(Lock);
+		for (;;)
+		{
+			Wake.wait(lock, [this] { return Exit || Queue.Size() > 0; });
+			if (Exit) return;
+
+			Job *job = Queue[0];
+			Queue.Delete(0);
+			Busy++;
+			lock.unlock();
+			job->Success = S_DecodeSound(job->Lump.Data(), job->Lump.Size(), job->Decoded);
+			job->Lump.Reset();
+			lock.lock();
+			Busy--;
+			Done.Push(job);
+			Idle.notify_all();
+		}
+	}
+};
+
 //==========================================================================
 //
 // S_Init
@@ -85,6 +159,7 @@ void SoundEngine::Init(TArray<uint8_t> &curve)
 void SoundEngine::Clear()
 {
 	StopAllChannels();
+	StopSoundLoads();
 	UnloadAllSounds();
 	GetSounds().Clear();
 	ClearRandoms();
@@ -101,6 +176,9 @@ void SoundEngine::Shutdown ()
 	FSoundChan *chan, *next;
 
 	StopAllChannels();
+	StopSoundLoads();
+	delete Loader;
+	Loader = nullptr;
 
 	for (chan = FreeChannels; chan != NULL; chan = next)
 	{
@@ -121,6 +199,10 @@ void SoundEngine::MarkUsed(int id)
 	if ((unsigned)id < S_sfx.Size())
 	{
 		S_sfx[id].bUsed = true;
+		if (PreloadMarked)
+		{
+			PreloadSound(&S_sfx[id]);
+		}
 	}
 }
 
@@ -180,6 +262,37 @@ void SoundEngine::CacheSound (sfxinfo_t *sfx)
 	}
 }
 
+//==========================================================================
+//
+// S_PreloadSound
+//
+// Like CacheSound, but the data is decoded in the background if possible,
+// for sounds that are likely to be needed soon.
+//
+//==========================================================================
+
+void SoundEngine::PreloadSound(sfxinfo_t *sfx)
+{
+	if (GSnd && !sfx->bTentative)
+	{
+		while (!sfx->bRandomHeader && sfx->link != sfxinfo_t::NO_LINK)
+		{
+			sfx = &S_sfx[sfx->link];
+		}
+		if (sfx->bRandomHeader)
+		{
+			for (auto choice : S_rnd[sfx->link].Choices)
+			{
+				PreloadSound(&S_sfx[choice]);
+			}
+		}
+		else
+		{
+			LoadSound(sfx, snd_asyncload);
+		}
+	}
+}
+
 //==========================================================================
 //
 // S_UnloadSound
@@ -246,6 +359,7 @@ void SoundEngine::ReturnChannel(FSoundChan *chan)
 
 void SoundEngine::UnlinkChannel(FSoundChan *chan)
 {
+	UnindexChannel(chan);
 	*(chan->PrevChan) = chan->NextChan;
 	if (chan->NextChan != NULL)
 	{
@@ -270,6 +384,133 @@ void SoundEngine::LinkChannel(FSoundChan *chan, FSoundChan **head)
 	chan->PrevChan = head;
 }
 
+//==========================================================================
+//
+// Channel lookup tables
+//
+// Each active channel is filed under its source and its sound IDs. The
+// lists are linked through the channels themselves, most recently
+// started first like the main list, so filing a channel does not need
+// to allocate anything.
+//
+//==========================================================================
+
+template<class Map, class Key>
+static void AddToIndex(Map &map, Key key, FSoundChan *chan, FSoundChan *FSoundChan::*next, FSoundChan *FSoundChan::*prev)
+{
+	FSoundChan **head = map.CheckKey(key);
+	chan->*prev = nullptr;
+	if (head != nullptr)
+	{
+		chan->*next = *head;
+		(*head)->*prev = chan;
+		*head = chan;
+	}
+	else
+	{
+		chan->*next = nullptr;
+		map.Insert(key, chan);
+	}
+}
+
+template<class Map, class Key>
+static void RemoveFromIndex(Map &map, Key key, FSoundChan *chan, FSoundChan *FSoundChan::*next, FSoundChan *FSoundChan::*prev)
+{
+	if (chan->*next != nullptr)
+	{
+		(chan->*next)->*prev = chan->*prev;
+	}
+	if (chan->*prev != nullptr)
+	{
+		(chan->*prev)->*next = chan->*next;
+	}
+	else if (chan->*next != nullptr)
+	{
+		map[key] = chan->*next;
+	}
+	else
+	{
+		map.Remove(key);
+	}
+	chan->*next = chan->*prev = nullptr;
+}
+
+//==========================================================================
+//
+// S_IndexChannel
+//
+// Files the channel under its current source and sound. This must be
+// called whenever these get changed on a playing channel.
+//
+//==========================================================================
+
+void SoundEngine::IndexChannel(FSoundChan *chan)
+{
+	UnindexChannel(chan);
+	if (chan->Source != nullptr)
+	{
+		chan->IndexedSource = chan->Source;
+		AddToIndex(SourceChannels, chan->IndexedSource, chan, &FSoundChan::NextSourceChan, &FSoundChan::PrevSourceChan);
+	}
+	if (chan->SoundID > 0)
+	{
+		chan->IndexedSound = chan->SoundID;
+		AddToIndex(SoundChannels, chan->IndexedSound, chan, &FSoundChan::NextSoundChan, &FSoundChan::PrevSoundChan);
+	}
+	if (chan->OrgID > 0)
+	{
+		chan->IndexedOrg = chan->OrgID;
+		AddToIndex(OrgChannels, chan->IndexedOrg, chan, &FSoundChan::NextOrgChan, &FSoundChan::PrevOrgChan);
+	}
+}
+
+void SoundEngine::UnindexChannel(FSoundChan *chan)
+{
+	if (chan->IndexedSource != nullptr)
+	{
+		RemoveFromIndex(SourceChannels, chan->IndexedSource, chan, &FSoundChan::NextSourceChan, &FSoundChan::PrevSourceChan);
+		chan->IndexedSource = nullptr;
+	}
+	if (chan->IndexedSound > 0)
+	{
+		RemoveFromIndex(SoundChannels, chan->IndexedSound, chan, &FSoundChan::NextSoundChan, &FSoundChan::PrevSoundChan);
+		chan->IndexedSound = 0;
+	}
+	if (chan->IndexedOrg > 0)
+	{
+		RemoveFromIndex(OrgChannels, chan->IndexedOrg, chan, &FSoundChan::NextOrgChan, &FSoundChan::PrevOrgChan);
+		chan->IndexedOrg = 0;
+	}
+}
+
+//==========================================================================
+//
+// S_CollectSourceChannels
+//
+// Gets the channels that may belong to a source, so that the caller can
+// stop them without invalidating the list it is walking. Without a source
+// this has to return all channels.
+//
+//==========================================================================
+
+void SoundEngine::CollectSourceChannels(const void *source, TArray<FSoundChan*> &list)
+{
+	if (source == nullptr)
+	{
+		for (FSoundChan *chan = Channels; chan != nullptr; chan = chan->NextChan)
+		{
+			list.Push(chan);
+		}
+	}
+	else if (FSoundChan **head = SourceChannels.CheckKey(source))
+	{
+		for (FSoundChan *chan = *head; chan != nullptr; chan = chan->NextSourceChan)
+		{
+			list.Push(chan);
+		}
+	}
+}
+
 //==========================================================================
 //
 //
@@ -317,6 +558,7 @@ FString SoundEngine::ListSoundChannels()
 		}
 	}
 	output.AppendFormat("%d sounds playing\n", count);
+	output.AppendFormat("%d 3D sounds updated, %d unchanged\n", Updated3D, Unchanged3D);
 	return output;
 }
 
@@ -487,7 +729,15 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 	}
 
 	// Make sure the sound is loaded.
-	sfx = LoadSound(sfx);
+	if (!sfx->data.isValid() && !sfx->bLoading && sfx->lumpnum != sfx_empty && !GSnd->IsNull())
+	{
+		double start = I_msTimeF();
+		sfx = LoadSound(sfx, snd_asyncload);
+		double time = I_msTimeF() - start;
+		PlayLoads++;
+		PlayLoadTime += time;
+		PlayLoadMax = max(PlayLoadMax, time);
+	}
 
 	// The empty sound never plays.
 	if (sfx->lumpnum == sfx_empty)
@@ -495,6 +745,12 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		return NULL;
 	}
 
+	// If the sound is still being decoded, its channel will be started once it is done.
+	if (sfx->bLoading)
+	{
+		chanflags |= CHANF_EVICTED;
+	}
+
 	// Select priority.
 	if (type == SOURCE_None || source == listener.ListenerObject)
 	{
@@ -516,17 +772,19 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 	// If this actor is already playing something on the selected channel, stop it.
 	if (!(chanflags & CHANF_OVERLAP) && type != SOURCE_None && ((source == NULL && channel != CHAN_AUTO) || (source != NULL && IsChannelUsed(type, source, channel, &seen))))
 	{
-		for (chan = Channels; chan != NULL; chan = chan->NextChan)
+		TArray<FSoundChan*> chans;
+		CollectSourceChannels(type == SOURCE_Unattached ? nullptr : source, chans);
+		for (auto ochan : chans)
 		{
-			if (chan->SourceType == type && chan->EntChannel == channel)
+			if (ochan->SourceType == type && ochan->EntChannel == channel)
 			{
 				const bool foundit = (type == SOURCE_Unattached)
-					? (chan->Point[0] == pt->X && chan->Point[2] == pt->Z && chan->Point[1] == pt->Y)
-					: (chan->Source == source);
+					? (ochan->Point[0] == pt->X && ochan->Point[2] == pt->Z && ochan->Point[1] == pt->Y)
+					: (ochan->Source == source);
 
 				if (foundit)
 				{
-					StopChannel(chan);
+					StopChannel(ochan);
 				}
 			}
 		}
@@ -581,6 +839,11 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		GSnd->MarkStartTime(chan);
 		chanflags |= CHANF_EVICTED;
 	}
+	else if (chan == NULL && sfx->bLoading)
+	{
+		// Without a start time this plays from the beginning once restarted.
+		chan = (FSoundChan*)GetChannel(NULL);
+	}
 	if (attenuation > 0 && type != SOURCE_None)
 	{
 		chanflags |= CHANF_IS3D | CHANF_JUSTSTARTED;
@@ -611,6 +874,7 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		{
 			chan->Source = source;
 		}
+		IndexChannel(chan);
 
 		if (spitch > 0.0)				// A_StartSound has top priority over all others.
 			SetPitch(chan, spitch);
@@ -714,10 +978,16 @@ void SoundEngine::RestartChannel(FSoundChan *chan)
 //
 //==========================================================================
 
-sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
+sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx, bool async)
 {
 	if (GSnd->IsNull()) return sfx;
 
+	if (sfx->bLoading)
+	{
+		if (async) return sfx;
+		FinishSoundLoads(true);
+	}
+
 	while (!sfx->data.isValid())
 	{
 		unsigned int i;
@@ -768,6 +1038,24 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 				if (frequency == 0) frequency = 11025;
 				sfx->data = GSnd->LoadSoundRaw(sfxdata.Data()+8, dmxlen, frequency, 1, 8, sfx->LoopStart);
 			}
+			// Compressed formats are expensive to decode so leave that to the loader thread if allowed.
+			else if (async)
+			{
+				if (Loader == nullptr)
+				{
+					Loader = new FSoundLoader;
+				}
+				auto job = new FSoundLoader::Job;
+				job->SoundID = int(sfx - &S_sfx[0]);
+				job->Lump = std::move(sfxdata);
+				sfx->bLoading = true;
+				{
+					std::unique_lock<std::mutex> lock(Loader->Lock);
+					Loader->Queue.Push(job);
+				}
+				Loader->Wake.notify_one();
+				return sfx;
+			}
 			// If that fails, let the sound system try and figure it out.
 			else
 			{
@@ -790,22 +1078,106 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 
 //==========================================================================
 //
-// S_CheckSingular
+// S_FinishSoundLoads
 //
-// Returns true if a copy of this sound is already playing.
+// Hands the sounds the loader thread has decoded to the sound device.
+// Channels waiting for them get started by RestoreEvictedChannels.
 //
 //==========================================================================
 
-bool SoundEngine::CheckSingular(int sound_id)
+void SoundEngine::FinishSoundLoads(bool wait)
 {
-	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+	if (Loader == nullptr)
+	{
+		return;
+	}
+
+	TArray<FSoundLoader::Job*> done;
 	{
-		if (chan->OrgID == sound_id)
+		std::unique_lock<std::mutex> lock(Loader->Lock);
+		if (wait)
 		{
-			return true;
+			Loader->Idle.wait(lock, [this] { return Loader->Queue.Size() == 0 && Loader->Busy == 0; });
 		}
+		done = std::move(Loader->Done);
 	}
-	return false;
+	for (auto job : done)
+	{
+		sfxinfo_t *sfx = &S_sfx[job->SoundID];
+		auto &decoded = job->Decoded;
+
+		sfx->bLoading = false;
+		if (job->Success)
+		{
+			sfx->data = GSnd->LoadSoundRaw(decoded.Data.Data(), decoded.Data.Size(), decoded.Frequency, decoded.Channels, decoded.Bits, decoded.LoopStart, decoded.LoopEnd);
+		}
+		else if (decoded.Error.IsNotEmpty())
+		{
+			Printf("%s", decoded.Error.GetChars());
+		}
+		if (!sfx->data.isValid())
+		{
+			sfx->lumpnum = sfx_empty;
+		}
+		delete job;
+	}
+}
+
+//==========================================================================
+//
+// S_StopSoundLoads
+//
+// Throws away all pending loads, for when the sound list is about to go away.
+//
+//==========================================================================
+
+void SoundEngine::StopSoundLoads()
+{
+	if (Loader == nullptr)
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(Loader->Lock);
+	Loader->Idle.wait(lock, [this] { return Loader->Busy == 0; });
+	for (auto job : Loader->Queue)
+	{
+		S_sfx[job->SoundID].bLoading = false;
+		delete job;
+	}
+	for (auto job : Loader->Done)
+	{
+		S_sfx[job->SoundID].bLoading = false;
+		delete job;
+	}
+	Loader->Queue.Clear();
+	Loader->Done.Clear();
+}
+
+//==========================================================================
+//
+// S_GetLoadStats
+//
+//==========================================================================
+
+FString SoundEngine::GetLoadStats()
+{
+	FString out;
+	out.Format("%d sounds loaded on demand, %.2f ms total, %.2f ms max\n", PlayLoads, PlayLoadTime, PlayLoadMax);
+	return out;
+}
+
+//==========================================================================
+//
+// S_CheckSingular
+//
+// Returns true if a copy of this sound is already playing.
+//
+//==========================================================================
+
+bool SoundEngine::CheckSingular(int sound_id)
+{
+	return OrgChannels.CheckKey(sound_id) != nullptr;
 }
 
 //==========================================================================
@@ -828,13 +1200,14 @@ bool SoundEngine::CheckSingular(int sound_id)
 bool SoundEngine::CheckSoundLimit(sfxinfo_t *sfx, const FVector3 &pos, int near_limit, float limit_range,
 	int sourcetype, const void *actor, int channel, float attenuation)
 {
+	FSoundChan **head = SoundChannels.CheckKey(int(sfx - S_sfx.Data()));
 	FSoundChan *chan;
 	int count;
 
-	for (chan = Channels, count = 0; chan != NULL && count < near_limit; chan = chan->NextChan)
+	for (chan = head != nullptr ? *head : nullptr, count = 0; chan != NULL && count < near_limit; chan = chan->NextSoundChan)
 	{
 		if (chan->ChanFlags & CHANF_FORGETTABLE) continue;
-		if (!(chan->ChanFlags & CHANF_EVICTED) && &S_sfx[chan->SoundID] == sfx)
+		if (!(chan->ChanFlags & CHANF_EVICTED))
 		{
 			FVector3 chanorigin;
 
@@ -866,10 +1239,11 @@ bool SoundEngine::CheckSoundLimit(sfxinfo_t *sfx, const FVector3 &pos, int near_
 
 void SoundEngine::StopSoundID(int sound_id)
 {
-	FSoundChan* chan = Channels;
+	FSoundChan** head = OrgChannels.CheckKey(sound_id);
+	FSoundChan* chan = head != nullptr ? *head : nullptr;
 	while (chan != NULL)
 	{
-		FSoundChan* next = chan->NextChan;
+		FSoundChan* next = chan->NextOrgChan;
 		if (sound_id == chan->OrgID)
 		{
 			StopChannel(chan);
@@ -910,17 +1284,16 @@ void SoundEngine::StopSound (int channel, int sound_id)
 
 void SoundEngine::StopSound(int sourcetype, const void* actor, int channel, int sound_id)
 {
-	FSoundChan* chan = Channels;
-	while (chan != NULL)
+	TArray<FSoundChan*> chans;
+	CollectSourceChannels(actor, chans);
+	for (auto chan : chans)
 	{
-		FSoundChan* next = chan->NextChan;
 		if (chan->SourceType == sourcetype &&
 			chan->Source == actor &&
 			(sound_id == -1? (chan->EntChannel == channel || channel < 0) : (chan->OrgID == sound_id)))
 		{
 			StopChannel(chan);
 		}
-		chan = next;
 	}
 }
 
@@ -937,17 +1310,16 @@ void SoundEngine::StopActorSounds(int sourcetype, const void* actor, int chanmin
 	const bool all = (chanmin == 0 && chanmax == 0);
 	if (chanmax < chanmin) std::swap(chanmin, chanmax);
 
-	FSoundChan* chan = Channels;
-	while (chan != nullptr)
+	TArray<FSoundChan*> chans;
+	CollectSourceChannels(actor, chans);
+	for (auto chan : chans)
 	{
-		FSoundChan* next = chan->NextChan;
 		if (chan->SourceType == sourcetype &&
 			chan->Source == actor &&
 			(all || (chan->EntChannel >= chanmin && chan->EntChannel <= chanmax)))
 		{
 			StopChannel(chan);
 		}
-		chan = next;
 	}
 }
 
@@ -984,15 +1356,16 @@ void SoundEngine::RelinkSound (int sourcetype, const void *from, const void *to,
 	if (from == NULL)
 		return;
 
-	FSoundChan *chan = Channels;
-	while (chan != NULL)
+	TArray<FSoundChan*> chans;
+	CollectSourceChannels(from, chans);
+	for (auto chan : chans)
 	{
-		FSoundChan *next = chan->NextChan;
 		if (chan->SourceType == sourcetype && chan->Source == from)
 		{
 			if (to != NULL)
 			{
 				chan->Source = to;
+				IndexChannel(chan);
 			}
 			else if (!(chan->ChanFlags & CHANF_LOOP) && optpos)
 			{
@@ -1001,13 +1374,13 @@ void SoundEngine::RelinkSound (int sourcetype, const void *from, const void *to,
 				chan->Point[0] = optpos->X;
 				chan->Point[1] = optpos->Y;
 				chan->Point[2] = optpos->Z;
+				IndexChannel(chan);
 			}
 			else
 			{
 				StopChannel(chan);
 			}
 		}
-		chan = next;
 	}
 }
 
@@ -1027,7 +1400,9 @@ void SoundEngine::ChangeSoundVolume(int sourcetype, const void *source, int chan
 	else if (volume > 1.0)
 		volume = 1.0;
 
-	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+	TArray<FSoundChan*> chans;
+	CollectSourceChannels(source, chans);
+	for (auto chan : chans)
 	{
 		if (chan->SourceType == sourcetype &&
 			chan->Source == source &&
@@ -1058,7 +1433,9 @@ void SoundEngine::SetVolume(FSoundChan* chan, float volume)
 
 void SoundEngine::ChangeSoundPitch(int sourcetype, const void *source, int channel, double pitch, int sound_id)
 {
-	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+	TArray<FSoundChan*> chans;
+	CollectSourceChannels(source, chans);
+	for (auto chan : chans)
 	{
 		if (chan->SourceType == sourcetype &&
 			chan->Source == source &&
@@ -1089,7 +1466,8 @@ int SoundEngine::GetSoundPlayingInfo (int sourcetype, const void *source, int so
 	int count = 0;
 	if (sound_id > 0)
 	{
-		for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+		FSoundChan **head = OrgChannels.CheckKey(sound_id);
+		for (FSoundChan *chan = head != nullptr ? *head : nullptr; chan != NULL; chan = chan->NextOrgChan)
 		{
 			if (chann != -1 && chann != chan->EntChannel) continue;
 			if (chan->OrgID == sound_id && (sourcetype == SOURCE_Any ||
@@ -1100,6 +1478,18 @@ int SoundEngine::GetSoundPlayingInfo (int sourcetype, const void *source, int so
 			}
 		}
 	}
+	else if (sourcetype != SOURCE_Any && source != nullptr)
+	{
+		FSoundChan** head = SourceChannels.CheckKey(source);
+		for (FSoundChan* chan = head != nullptr ? *head : nullptr; chan != NULL; chan = chan->NextSourceChan)
+		{
+			if (chann != -1 && chann != chan->EntChannel) continue;
+			if (chan->SourceType == sourcetype && chan->Source == source)
+			{
+				count++;
+			}
+		}
+	}
 	else
 	{
 		for (FSoundChan* chan = Channels; chan != NULL; chan = chan->NextChan)
@@ -1130,7 +1520,8 @@ bool SoundEngine::IsChannelUsed(int sourcetype, const void *actor, int channel,
 	{
 		return true;
 	}
-	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+	FSoundChan **head = SourceChannels.CheckKey(actor);
+	for (FSoundChan *chan = head != nullptr ? *head : nullptr; chan != NULL; chan = chan->NextSourceChan)
 	{
 		if (chan->SourceType == sourcetype && chan->Source == actor)
 		{
@@ -1152,7 +1543,27 @@ bool SoundEngine::IsChannelUsed(int sourcetype, const void *actor, int channel,
 
 bool SoundEngine::IsSourcePlayingSomething (int sourcetype, const void *actor, int channel, int sound_id)
 {
-	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+	FSoundChan *chan;
+	FSoundChan *FSoundChan::*next;
+
+	if (sound_id > 0)
+	{
+		FSoundChan **head = OrgChannels.CheckKey(sound_id);
+		chan = head != nullptr ? *head : nullptr;
+		next = &FSoundChan::NextOrgChan;
+	}
+	else if (sourcetype != SOURCE_None && sourcetype != SOURCE_Unattached && actor != nullptr)
+	{
+		FSoundChan **head = SourceChannels.CheckKey(actor);
+		chan = head != nullptr ? *head : nullptr;
+		next = &FSoundChan::NextSourceChan;
+	}
+	else
+	{
+		chan = Channels;
+		next = &FSoundChan::NextChan;
+	}
+	for (; chan != NULL; chan = chan->*next)
 	{
 		if (chan->SourceType == sourcetype && (sourcetype == SOURCE_None || sourcetype == SOURCE_Unattached || chan->Source == actor))
 		{
@@ -1214,7 +1625,11 @@ void SoundEngine::RestoreEvictedChannel(FSoundChan *chan)
 		return;
 	}
 	RestoreEvictedChannel(chan->NextChan);
-	if (chan->ChanFlags & CHANF_EVICTED)
+	if ((chan->ChanFlags & CHANF_EVICTED) && S_sfx[chan->SoundID].bLoading)
+	{
+		// The data is not there yet.
+	}
+	else if (chan->ChanFlags & CHANF_EVICTED)
 	{
 		RestartChannel(chan);
 		if (!(chan->ChanFlags & CHANF_LOOP))
@@ -1261,15 +1676,30 @@ void SoundEngine::UpdateSounds(int time)
 {
 	FVector3 pos, vel;
 
+	// The backend's parameters only depend on the source's position and
+	// velocity and the listener's position, so if none of them changed,
+	// there is nothing to tell it. This matters with many sources that
+	// stand still, because every update is a driver call.
+	bool listenermoved = listener.position != LastListenerPos;
+	LastListenerPos = listener.position;
+	Updated3D = Unchanged3D = 0;
+
 	for (FSoundChan* chan = Channels; chan != NULL; chan = chan->NextChan)
 	{
 		if ((chan->ChanFlags & (CHANF_EVICTED | CHANF_IS3D)) == CHANF_IS3D)
 		{
 			CalcPosVel(chan, &pos, &vel);
 
-			if (ValidatePosVel(chan, pos, vel))
+			if (!listenermoved && !(chan->ChanFlags & CHANF_JUSTSTARTED) && pos == chan->LastPos && vel == chan->LastVel)
+			{
+				Unchanged3D++;
+			}
+			else if (ValidatePosVel(chan, pos, vel))
 			{
 				GSnd->UpdateSoundParams3D(&listener, chan, !!(chan->ChanFlags & CHANF_AREA), pos, vel);
+				chan->LastPos = pos;
+				chan->LastVel = vel;
+				Updated3D++;
 			}
 		}
 		chan->ChanFlags &= ~CHANF_JUSTSTARTED;
@@ -1278,6 +1708,7 @@ void SoundEngine::UpdateSounds(int time)
 	GSnd->UpdateListener(&listener);
 	GSnd->UpdateSounds();
 
+	FinishSoundLoads(false);
 	if (time >= RestartEvictionsAt)
 	{
 		RestartEvictionsAt = 0;
@@ -43,6 +43,7 @@ struct sfxinfo_t
 	bool		bUsed = false;
 	bool		bSingular = false;
 	bool		bTentative = true;
+	bool		bLoading = false;					// Being decoded in the background.
 
 	TArray<int> UserData;
 
@@ -146,6 +147,22 @@ struct FSoundChan : public FISoundChannel
 	float		LimitRange;
 	const void *Source;
 	float Point[3];	// Sound is not attached to any source.
+
+	// Links for the engine's lookup tables, which file each channel by source and sound.
+	FSoundChan	*NextSourceChan, *PrevSourceChan;
+	FSoundChan	*NextSoundChan, *PrevSoundChan;
+	FSoundChan	*NextOrgChan, *PrevOrgChan;
+	const void	*IndexedSource;		// The keys this channel is filed under. Source may have been
+	int			IndexedSound;		// changed by the client since, so they are stored separately.
+	int			IndexedOrg;
+	FVector3	LastPos, LastVel;	// What was last passed to the backend.
+};
+
+struct FSoundSourceHashTraits
+{
+	// Sources are objects and usually 16 byte aligned so the low bits are useless.
+	hash_t Hash(const void *key) { uintptr_t v = (uintptr_t)key; return hash_t(v >> 4) ^ hash_t(v >> 20); }
+	int Compare(const void *left, const void *right) { return left != right; }
 };
 
 
@@ -197,16 +214,26 @@ ReverbContainer *S_FindEnvironment (const char *name);
 ReverbContainer *S_FindEnvironment (int id);
 void S_AddEnvironment (ReverbContainer *settings);
 
+struct FSoundLoader;
+
 class SoundEngine
 {
 protected:
 	bool SoundPaused = false;		// whether sound is paused
 	int RestartEvictionsAt = 0;	// do not restart evicted channels before this time
 	SoundListener listener{};
+	FVector3 LastListenerPos{};
+	int Updated3D = 0, Unchanged3D = 0;	// channel counts of the last update
 
 	FSoundChan* Channels = nullptr;
 	FSoundChan* FreeChannels = nullptr;
 
+	// Heads of the per-source and per-sound channel lists, so that looking up
+	// what a source or sound is playing does not have to scan all channels.
+	TMap<const void*, FSoundChan*, FSoundSourceHashTraits> SourceChannels;
+	TMap<int, FSoundChan*> SoundChannels;	// by SoundID
+	TMap<int, FSoundChan*> OrgChannels;		// by OrgID
+
 	// the complete set of sound effects
 	TArray<sfxinfo_t> S_sfx;
 	FRolloffInfo S_Rolloff{};
@@ -215,12 +242,19 @@ protected:
 	TArray<FRandomSoundList> S_rnd;
 	bool blockNewSounds = false;
 
+	FSoundLoader* Loader = nullptr;		// Decodes sounds in the background.
+	bool PreloadMarked = false;		// MarkUsed starts loading the sound.
+	int PlayLoads = 0;				// Loads done by StartSound and how long they blocked.
+	double PlayLoadTime = 0, PlayLoadMax = 0;
+
 private:
 	void LinkChannel(FSoundChan* chan, FSoundChan** head);
 	void UnlinkChannel(FSoundChan* chan);
 	void ReturnChannel(FSoundChan* chan);
 	void RestartChannel(FSoundChan* chan);
 	void RestoreEvictedChannel(FSoundChan* chan);
+	void UnindexChannel(FSoundChan* chan);
+	void CollectSourceChannels(const void* source, TArray<FSoundChan*>& list);
 
 	bool IsChannelUsed(int sourcetype, const void* actor, int channel, int* seen);
 	// This is the actual sound positioning logic which needs to be provided by the client.
@@ -250,7 +284,20 @@ public:
 	}
 
 	virtual void StopChannel(FSoundChan* chan);
-	sfxinfo_t* LoadSound(sfxinfo_t* sfx);
+	sfxinfo_t* LoadSound(sfxinfo_t* sfx, bool async = false);
+	void FinishSoundLoads(bool wait);
+	void StopSoundLoads();
+	void PreloadSound(sfxinfo_t* sfx);
+	void SetPreloadMarked(bool on)
+	{
+		PreloadMarked = on;
+	}
+	FString GetLoadStats();
+	void ResetLoadStats()
+	{
+		PlayLoads = 0;
+		PlayLoadTime = PlayLoadMax = 0;
+	}
 	const sfxinfo_t* GetSfx(unsigned snd)
 	{
 		if (snd >= S_sfx.Size()) return nullptr;
@@ -271,6 +318,7 @@ public:
 	void SetVolume(FSoundChan* chan, float vol);
 
 	FSoundChan* GetChannel(void* syschan);
+	void IndexChannel(FSoundChan* chan);
 	void RestoreEvictedChannels();
 	void CalcPosVel(FSoundChan* chan, FVector3* pos, FVector3* vel);
 
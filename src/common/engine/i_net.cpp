@@ -75,6 +75,7 @@
 #include "cmdlib.h"
 #include "printf.h"
 #include "i_interface.h"
+#include "c_cvars.h"
 
 
 #include "i_net.h"
@@ -160,6 +161,122 @@ struct PreGamePacket
 
 uint8_t TransmitBuffer[TRANSMIT_SIZE];
 
+// Compressed packets carry a sequence number and an acknowledgement of the
+// newest packet received from the other side. Since consecutive packets
+// mostly contain the same tics, a packet can be compressed with an earlier
+// one as the zlib dictionary. Only packets the other node has acknowledged
+// are used for that, so lost packets never make later ones unreadable.
+//
+// Compressed packet:
+//  One byte with flags, including NCMD_COMPRESSED
+//  One byte with the sequence number
+//  One byte with the newest sequence number received from this node
+//  zlib stream, possibly using a preset dictionary
+//
+// NCMD_SETUP packets keep the old format, a flags byte followed by a plain
+// zlib stream, so that the version check still works between builds that
+// use different packet formats.
+
+CVARD(Bool, net_packetdictionary, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "Compress network packets against packets the other side has already received")
+
+struct FPacketHistory
+{
+	enum
+	{
+		Size = 16,
+		NumSeq = 240,	// sequence numbers wrap at a multiple of the history size
+		NoSeq = 255
+	};
+
+	struct Entry
+	{
+		uint8_t Seq = NoSeq;
+		uint32_t Adler = 0;
+		TArray<uint8_t> Data;
+
+		void Set(uint8_t seq, const uint8_t *data, unsigned len)
+		{
+			Seq = seq;
+			Data.Resize(len);
+			memcpy(Data.Data(), data, len);
+			Adler = adler32(adler32(0, nullptr, 0), data, len);
+		}
+	};
+
+	uint8_t NextSeq = 0;
+	uint8_t LastReceived = NoSeq;
+	uint8_t Acked = NoSeq;
+	Entry Sent[Size];
+	Entry Received[Size];
+
+	// Returns the newest packet that is known to be in the other node's history.
+	const Entry *GetDictionary() const
+	{
+		if (Acked == NoSeq) return nullptr;
+		const Entry &entry = Sent[Acked % Size];
+		unsigned age = (NextSeq + NumSeq - 1 - Acked) % NumSeq;
+		return entry.Seq == Acked && age < Size ? &entry : nullptr;
+	}
+
+	const Entry *FindReceived(uint32_t adler) const
+	{
+		for (auto &entry : Received)
+		{
+			if (entry.Seq != NoSeq && entry.Adler == adler) return &entry;
+		}
+		return nullptr;
+	}
+};
+
+static FPacketHistory PacketHistory[MAXNETNODES];
+
+static int CompressPacket(uint8_t *dest, uLong *destlen, const uint8_t *src, uLong srclen, const FPacketHistory::Entry *dict)
+{
+	z_stream stream = {};
+	int err = deflateInit(&stream, 9);
+	if (err != Z_OK) return err;
+
+	if (dict != nullptr)
+	{
+		err = deflateSetDictionary(&stream, dict->Data.Data(), dict->Data.Size());
+	}
+	if (err == Z_OK)
+	{
+		stream.next_in = (Bytef *)src;
+		stream.avail_in = srclen;
+		stream.next_out = dest;
+		stream.avail_out = *destlen;
+		err = deflate(&stream, Z_FINISH);
+		err = err == Z_STREAM_END ? Z_OK : err == Z_OK ? Z_BUF_ERROR : err;
+	}
+	*destlen = stream.total_out;
+	deflateEnd(&stream);
+	return err;
+}
+
+static int UncompressPacket(uint8_t *dest, uLongf *destlen, const uint8_t *src, uLong srclen, const FPacketHistory &history)
+{
+	z_stream stream = {};
+	int err = inflateInit(&stream);
+	if (err != Z_OK) return err;
+
+	stream.next_in = (Bytef *)src;
+	stream.avail_in = srclen;
+	stream.next_out = dest;
+	stream.avail_out = *destlen;
+	err = inflate(&stream, Z_FINISH);
+	if (err == Z_NEED_DICT)
+	{
+		auto dict = history.FindReceived(stream.adler);
+		err = dict == nullptr ? Z_DATA_ERROR : inflateSetDictionary(&stream, dict->Data.Data(), dict->Data.Size());
+		if (err == Z_OK) err = inflate(&stream, Z_FINISH);
+	}
+	err = err == Z_STREAM_END ? Z_OK : err == Z_OK ? Z_BUF_ERROR : err;
+	*destlen = stream.total_out;
+	inflateEnd(&stream);
+	return err;
+}
+
 FString GetPlayerName(int num)
 {
 	if (sysCallbacks.GetPlayerName) return sysCallbacks.GetPlayerName(sendplayer[num]);
@@ -233,20 +350,36 @@ void PacketSend (void)
 	}
 	assert(!(doomcom.data[0] & NCMD_COMPRESSED));
 
-	uLong size = TRANSMIT_SIZE - 1;
-	if (doomcom.datalength >= 10)
+	auto &history = PacketHistory[doomcom.remotenode];
+	bool legacy = !!(doomcom.data[0] & NCMD_SETUP);
+	uLong size = TRANSMIT_SIZE - 3;
+	if (doomcom.datalength < 10)
 	{
+		c = -1;	// Just some random error code to avoid sending the compressed buffer.
+	}
+	else if (legacy)
+	{
+		size = TRANSMIT_SIZE - 1;
 		TransmitBuffer[0] = doomcom.data[0] | NCMD_COMPRESSED;
 		c = compress2(TransmitBuffer + 1, &size, doomcom.data + 1, doomcom.datalength - 1, 9);
 		size += 1;
 	}
 	else
 	{
-		c = -1;	// Just some random error code to avoid sending the compressed buffer.
+		TransmitBuffer[0] = doomcom.data[0] | NCMD_COMPRESSED;
+		TransmitBuffer[1] = history.NextSeq;
+		TransmitBuffer[2] = history.LastReceived;
+		c = CompressPacket(TransmitBuffer + 3, &size, doomcom.data + 1, doomcom.datalength - 1, net_packetdictionary ? history.GetDictionary() : nullptr);
+		size += 3;
 	}
 	if (c == Z_OK && size < (uLong)doomcom.datalength)
 	{
 //		Printf("send %lu/%d\n", size, doomcom.datalength);
+		if (!legacy)
+		{
+			history.Sent[history.NextSeq % FPacketHistory::Size].Set(history.NextSeq, doomcom.data + 1, doomcom.datalength - 1);
+			history.NextSeq = (history.NextSeq + 1) % FPacketHistory::NumSeq;
+		}
 		c = sendto(mysocket, (char *)TransmitBuffer, size,
 			0, (sockaddr *)&sendaddress[doomcom.remotenode],
 			sizeof(sendaddress[doomcom.remotenode]));
@@ -319,10 +452,25 @@ void PacketGet (void)
 	else if (node >= 0 && c > 0)
 	{
 		doomcom.data[0] = TransmitBuffer[0] & ~NCMD_COMPRESSED;
-		if (TransmitBuffer[0] & NCMD_COMPRESSED)
+		if ((TransmitBuffer[0] & (NCMD_COMPRESSED | NCMD_SETUP)) == (NCMD_COMPRESSED | NCMD_SETUP))
 		{
 			uLongf msgsize = MAX_MSGLEN - 1;
 			int err = uncompress(doomcom.data + 1, &msgsize, TransmitBuffer + 1, c - 1);
+			if (err != Z_OK)
+			{
+				Printf("Net decompression failed (zlib error %s)\n", M_ZLibError(err).GetChars());
+				// Pretend no packet
+				doomcom.remotenode = -1;
+				return;
+			}
+			c = msgsize + 1;
+		}
+		else if (TransmitBuffer[0] & NCMD_COMPRESSED)
+		{
+			auto &history = PacketHistory[node];
+			uLongf msgsize = MAX_MSGLEN - 1;
+			int err = c < 3 || TransmitBuffer[1] >= FPacketHistory::NumSeq ? Z_DATA_ERROR :
+				UncompressPacket(doomcom.data + 1, &msgsize, TransmitBuffer + 3, c - 3, history);
 //			Printf("recv %d/%lu\n", c, msgsize + 1);
 			if (err != Z_OK)
 			{
@@ -331,6 +479,13 @@ void PacketGet (void)
 				doomcom.remotenode = -1;
 				return;
 			}
+			uint8_t seq = TransmitBuffer[1];
+			history.Received[seq % FPacketHistory::Size].Set(seq, doomcom.data + 1, msgsize);
+			history.LastReceived = seq;
+			if (TransmitBuffer[2] < FPacketHistory::NumSeq)
+			{
+				history.Acked = TransmitBuffer[2];
+			}
 			c = msgsize + 1;
 		}
 		else
@@ -460,6 +615,11 @@ void StartNetwork (bool autoPort)
 	netgame = true;
 	multiplayer = true;
 
+	for (auto &history : PacketHistory)
+	{
+		history = {};
+	}
+
 	// create communication socket
 	mysocket = UDPsocket ();
 	BindToLocalPort (mysocket, autoPort ? 0 : DOOMPORT);
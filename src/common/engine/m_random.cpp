@@ -372,6 +372,28 @@ FRandom *FRandom::StaticFindRNG (const char *name)
 	return probe;
 }
 
+//==========================================================================
+//
+// FRandom :: StaticListSeeds
+//
+// Stores the name CRC and seed of every named RNG as pairs. Used by the
+// sync log to find RNGs that went out of sync.
+//
+//==========================================================================
+
+void FRandom::StaticListSeeds(TArray<uint32_t> &out)
+{
+	out.Clear();
+	for (FRandom *rng = RNGList; rng != NULL; rng = rng->Next)
+	{
+		if (rng->NameCRC != 0)
+		{
+			out.Push(rng->NameCRC);
+			out.Push(rng->Seed());
+		}
+	}
+}
+
 //==========================================================================
 //
 // FRandom :: StaticPrintSeeds
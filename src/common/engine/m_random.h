@@ -37,6 +37,7 @@
 
 #include <stdio.h>
 #include "basics.h"
+#include "tarray.h"
 #include "sfmt/SFMTObj.h"
 
 class FSerializer;
@@ -171,6 +172,7 @@ public:
 	static void StaticReadRNGState (FSerializer &arc);
 	static void StaticWriteRNGState (FSerializer &file);
 	static FRandom *StaticFindRNG(const char *name);
+	static void StaticListSeeds(TArray<uint32_t> &out);
 
 #ifndef NDEBUG
 	static void StaticPrintSeeds ();
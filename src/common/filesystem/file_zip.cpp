@@ -661,7 +661,16 @@ int AppendCentralDirectory(FileWriter *zip_file, const char *filename, FCompress
 	return 0;
 }
 
-bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content)
+//==========================================================================
+//
+// WriteZip
+//
+// Writes a zip with the given contents to an already opened file, which
+// may also be a BufferWriter.
+//
+//==========================================================================
+
+bool WriteZip(FileWriter *f, TArray<FString> &filenames, TArray<FCompressedBuffer> &content)
 {
 	// try to determine local time
 	struct tm *ltime;
@@ -674,49 +683,49 @@ bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompress
 
 	if (filenames.Size() != content.Size()) return false;
 
-	auto f = FileWriter::Open(filename);
-	if (f != nullptr)
+	for (unsigned i = 0; i < filenames.Size(); i++)
 	{
-		for (unsigned i = 0; i < filenames.Size(); i++)
+		int pos = AppendToZip(f, filenames[i], content[i], dostime);
+		if (pos == -1)
 		{
-			int pos = AppendToZip(f, filenames[i], content[i], dostime);
-			if (pos == -1)
-			{
-				delete f;
-				remove(filename);
-				return false;
-			}
-			positions.Push(pos);
+			return false;
 		}
+		positions.Push(pos);
+	}
 
-		int dirofs = (int)f->Tell();
-		for (unsigned i = 0; i < filenames.Size(); i++)
+	int dirofs = (int)f->Tell();
+	for (unsigned i = 0; i < filenames.Size(); i++)
+	{
+		if (AppendCentralDirectory(f, filenames[i], content[i], dostime, positions[i]) < 0)
 		{
-			if (AppendCentralDirectory(f, filenames[i], content[i], dostime, positions[i]) < 0)
-			{
-				delete f;
-				remove(filename);
-				return false;
-			}
+			return false;
 		}
+	}
 
-		// Write the directory terminator.
-		FZipEndOfCentralDirectory dirend;
-		dirend.Magic = ZIP_ENDOFDIR;
-		dirend.DiskNumber = 0;
-		dirend.FirstDisk = 0;
-		dirend.NumEntriesOnAllDisks = dirend.NumEntries = LittleShort((uint16_t)filenames.Size());
-		dirend.DirectoryOffset = LittleLong(dirofs);
-		dirend.DirectorySize = LittleLong((uint32_t)(f->Tell() - dirofs));
-		dirend.ZipCommentLength = 0;
-		if (f->Write(&dirend, sizeof(dirend)) != sizeof(dirend))
+	// Write the directory terminator.
+	FZipEndOfCentralDirectory dirend;
+	dirend.Magic = ZIP_ENDOFDIR;
+	dirend.DiskNumber = 0;
+	dirend.FirstDisk = 0;
+	dirend.NumEntriesOnAllDisks = dirend.NumEntries = LittleShort((uint16_t)filenames.Size());
+	dirend.DirectoryOffset = LittleLong(dirofs);
+	dirend.DirectorySize = LittleLong((uint32_t)(f->Tell() - dirofs));
+	dirend.ZipCommentLength = 0;
+	return f->Write(&dirend, sizeof(dirend)) == sizeof(dirend);
+}
+
+bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content)
+{
+	auto f = FileWriter::Open(filename);
+	if (f != nullptr)
+	{
+		bool succeeded = WriteZip(f, filenames, content);
+		delete f;
+		if (!succeeded)
 		{
-			delete f;
 			remove(filename);
-			return false;
 		}
-		delete f;
-		return true;
+		return succeeded;
 	}
 	return false;
 }
@@ -56,12 +56,18 @@
 
 // HEADER FILES ------------------------------------------------------------
 
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
 #include "dobject.h"
 
 #include "c_dispatch.h"
 #include "menu.h"
 #include "stats.h"
 #include "printf.h"
+#include "c_cvars.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -97,6 +103,12 @@
 // Cost of calling of one destructor
 #define GCFINALIZECOST	100
 
+// Full collections with fewer objects than this are marked serially
+#define GCPARALLELMIN	10000
+
+// Gray stack size at which a mark thread starts sharing work
+#define GCMARKSHARE		64
+
 // TYPES -------------------------------------------------------------------
 
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
@@ -111,6 +123,9 @@ static size_t CalcStepSize();
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+// Number of threads that mark objects in full collections. 0 uses one per core.
+CVAR(Int, gc_markthreads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 namespace GC
 {
 size_t AllocBytes;
@@ -127,6 +142,7 @@ int StepMul = DEFAULT_GCMUL;
 int StepCount;
 uint64_t CheckTime;
 bool FinalGC;
+bool ParallelMark;
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
@@ -134,6 +150,23 @@ static int LastCollectTime;		// Time last time collector finished
 static size_t LastCollectAlloc;	// Memory allocation when collector finished
 static size_t MinStepSize;		// Cover at least this much memory per step
 
+static cycle_t MarkClock, SweepClock;	// Time spent in the current collection
+static double LastMarkTime, LastSweepTime;
+static double LastStepTime, MaxStepTime;
+
+// Per-thread state of the parallel marker
+struct FMarkWorker
+{
+	TArray<DObject *> Stack;	// Only accessed by the owning thread
+	TArray<DObject *> Shared;	// Work that other threads may steal
+	std::mutex SharedLock;
+};
+
+static FMarkWorker *MarkWorkers;
+static int NumMarkWorkers;
+static std::atomic<int> IdleMarkWorkers;
+static thread_local FMarkWorker *MarkWorker;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -221,6 +254,61 @@ static DObject **SweepList(DObject **p, size_t count, size_t *finalize_count)
 	return p;
 }
 
+//==========================================================================
+//
+// AtomicClearFlags
+//
+// Clears object flags for the parallel marker and returns the old ones.
+//
+//==========================================================================
+
+static inline uint32_t AtomicClearFlags(DObject *obj, uint32_t flags)
+{
+#ifdef _MSC_VER
+	return (uint32_t)_InterlockedAnd((volatile long *)&obj->ObjectFlags, ~(long)flags);
+#else
+	return __atomic_fetch_and(&obj->ObjectFlags, ~flags, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void AtomicSetFlags(DObject *obj, uint32_t flags)
+{
+#ifdef _MSC_VER
+	_InterlockedOr((volatile long *)&obj->ObjectFlags, (long)flags);
+#else
+	__atomic_fetch_or(&obj->ObjectFlags, flags, __ATOMIC_RELAXED);
+#endif
+}
+
+// Returns true if this thread is the one that turned the object gray.
+static inline bool AtomicWhite2Gray(DObject *obj)
+{
+	return !!(AtomicClearFlags(obj, OF_WhiteBits) & OF_WhiteBits);
+}
+
+//==========================================================================
+//
+// PushMarkWork
+//
+// Adds a gray object to a mark thread's stack. If the stack gets large
+// while other threads are out of work, the oldest part of it is shared.
+//
+//==========================================================================
+
+static void PushMarkWork(FMarkWorker *worker, DObject *obj)
+{
+	worker->Stack.Push(obj);
+	if (worker->Stack.Size() >= GCMARKSHARE * 2 && IdleMarkWorkers.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(worker->SharedLock);
+		for (unsigned i = 0; i < GCMARKSHARE; i++)
+		{
+			worker->Shared.Push(worker->Stack[i]);
+		}
+		worker->Stack.Delete(0, GCMARKSHARE);
+	}
+}
+
 //==========================================================================
 //
 // Mark
@@ -240,6 +328,13 @@ void Mark(DObject **obj)
 		{
 			*obj = (DObject *)NULL;
 		}
+		else if (MarkWorker != nullptr)
+		{
+			if (lobj->IsWhite() && AtomicWhite2Gray(lobj))
+			{
+				PushMarkWork(MarkWorker, lobj);
+			}
+		}
 		else if (lobj->IsWhite())
 		{
 			lobj->White2Gray();
@@ -249,6 +344,30 @@ void Mark(DObject **obj)
 	}
 }
 
+//==========================================================================
+//
+// Regray
+//
+// Puts an object that has only been partially propagated back into the
+// gray list.
+//
+//==========================================================================
+
+void Regray(DObject *obj)
+{
+	if (MarkWorker != nullptr)
+	{
+		AtomicClearFlags(obj, OF_Black);
+		PushMarkWork(MarkWorker, obj);
+	}
+	else
+	{
+		obj->Black2Gray();
+		obj->GCNext = Gray;
+		Gray = obj;
+	}
+}
+
 //==========================================================================
 //
 // MarkArray
@@ -285,6 +404,143 @@ static size_t CalcStepSize()
 		: std::numeric_limits<size_t>::max() / 2;		// no limit
 }
 
+//==========================================================================
+//
+// MarkThread
+//
+// Propagates marks until no thread has any gray objects left. A thread
+// that runs out of work steals half of another thread's shared work.
+// A thread may only go idle while holding the lock on its own shared
+// work, and it may only leave the idle state while holding the lock of
+// the thread it stole from. This way the idle count can't reach the
+// number of threads while any work is left.
+//
+//==========================================================================
+
+static void MarkThread(FMarkWorker *self)
+{
+	MarkWorker = self;
+	bool idle = false;
+	for (;;)
+	{
+		DObject *obj;
+		while (self->Stack.Pop(obj))
+		{
+			AtomicSetFlags(obj, OF_Black);
+			if (!(obj->ObjectFlags & OF_EuthanizeMe))
+			{
+				obj->PropagateMark();
+			}
+		}
+
+		if (!idle)
+		{
+			std::lock_guard<std::mutex> lock(self->SharedLock);
+			if (self->Shared.Size() > 0)
+			{
+				self->Stack.Append(self->Shared);
+				self->Shared.Clear();
+				continue;
+			}
+			IdleMarkWorkers++;
+			idle = true;
+		}
+		if (IdleMarkWorkers == NumMarkWorkers)
+		{
+			break;
+		}
+
+		for (int i = 1; i < NumMarkWorkers && idle; i++)
+		{
+			FMarkWorker *victim = &MarkWorkers[(self - MarkWorkers + i) % NumMarkWorkers];
+			std::lock_guard<std::mutex> lock(victim->SharedLock);
+			unsigned count = victim->Shared.Size();
+			if (count > 0)
+			{
+				unsigned take = (count + 1) / 2;
+				for (unsigned j = count - take; j < count; j++)
+				{
+					self->Stack.Push(victim->Shared[j]);
+				}
+				victim->Shared.Resize(count - take);
+				IdleMarkWorkers--;
+				idle = false;
+			}
+		}
+		if (idle)
+		{
+			std::this_thread::yield();
+		}
+	}
+	MarkWorker = nullptr;
+}
+
+//==========================================================================
+//
+// ParallelPropagate
+//
+// Propagates all marks of the gray list with several threads.
+//
+//==========================================================================
+
+static void ParallelPropagate(int numthreads)
+{
+	MarkWorkers = new FMarkWorker[numthreads];
+	NumMarkWorkers = numthreads;
+	IdleMarkWorkers = 0;
+
+	for (int i = 0; Gray != NULL; i++)
+	{
+		DObject *obj = Gray;
+		Gray = obj->GCNext;
+		MarkWorkers[i % numthreads].Shared.Push(obj);
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numthreads; i++)
+	{
+		threads.emplace_back(MarkThread, &MarkWorkers[i]);
+	}
+	MarkThread(&MarkWorkers[0]);
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	delete[] MarkWorkers;
+	MarkWorkers = nullptr;
+	NumMarkWorkers = 0;
+}
+
+//==========================================================================
+//
+// PrepareParallelMark
+//
+// Returns the number of threads to mark with. PropagateMark builds the
+// pointer tables of a class on first use, which isn't thread safe, so
+// this is done in advance for all classes with live objects.
+//
+//==========================================================================
+
+static int PrepareParallelMark(bool force)
+{
+	int numthreads = gc_markthreads > 0 ? *gc_markthreads : (int)std::thread::hardware_concurrency();
+	numthreads = clamp(numthreads, force ? 2 : 1, 16);
+	if (numthreads < 2 || PClass::bShutdown)
+	{
+		return 1;
+	}
+
+	int count = 0;
+	for (DObject *obj = Root; obj != NULL; obj = obj->ObjNext, count++)
+	{
+		PClass *cls = obj->GetClass();
+		if (cls->FlatPointers == nullptr) cls->BuildFlatPointers();
+		if (cls->ArrayPointers == nullptr) cls->BuildArrayPointers();
+	}
+	return count >= GCPARALLELMIN || force ? numthreads : 1;
+}
+
 //==========================================================================
 //
 // MarkRoot
@@ -399,6 +655,19 @@ static size_t SingleStep()
 	}
 }
 
+//==========================================================================
+//
+// PhaseClock
+//
+// Returns the timer that the given collector state is accounted to.
+//
+//==========================================================================
+
+static cycle_t *PhaseClock(EGCState state)
+{
+	return state == GCS_Sweep || state == GCS_Finalize ? &SweepClock : &MarkClock;
+}
+
 //==========================================================================
 //
 // Step
@@ -410,14 +679,38 @@ static size_t SingleStep()
 
 void Step()
 {
+	cycle_t steptime;
+	steptime.Reset();
+	steptime.Clock();
+
 	// We recalculate a step size in case the rate of allocation went up
 	// since we started sweeping because we don't want to fall behind.
 	// However, we also don't want to go slower than what was decided upon
 	// when the sweep began if the rate of allocation has slowed.
 	size_t lim = max(CalcStepSize(), MinStepSize);
+	cycle_t *clock = PhaseClock(State);
+	clock->Clock();
 	do
 	{
+		EGCState oldstate = State;
 		size_t done = SingleStep();
+		if (State == GCS_Pause)
+		{
+			// The collection is complete.
+			clock->Unclock();
+			clock = nullptr;
+			LastMarkTime = MarkClock.TimeMS();
+			LastSweepTime = SweepClock.TimeMS();
+			MarkClock.Reset();
+			SweepClock.Reset();
+			MaxStepTime = 0;
+		}
+		else if (State != oldstate && PhaseClock(State) != clock)
+		{
+			clock->Unclock();
+			clock = PhaseClock(State);
+			clock->Clock();
+		}
 		if (done < lim)
 		{
 			lim -= done;
@@ -427,6 +720,10 @@ void Step()
 			lim = 0;
 		}
 	} while (lim && State != GCS_Pause);
+	if (clock != nullptr)
+	{
+		clock->Unclock();
+	}
 	if (State != GCS_Pause)
 	{
 		Threshold = AllocBytes;
@@ -436,6 +733,10 @@ void Step()
 		assert(AllocBytes >= Estimate);
 		SetThreshold();
 	}
+
+	steptime.Unclock();
+	LastStepTime = steptime.TimeMS();
+	MaxStepTime = max(MaxStepTime, LastStepTime);
 	StepCount++;
 }
 
@@ -462,14 +763,86 @@ void FullGC()
 	{
 		SingleStep();
 	}
+	int numthreads = PrepareParallelMark(false);
+	ParallelMark = numthreads > 1;
 	MarkRoot();
+	if (ParallelMark)
+	{
+		ParallelPropagate(numthreads);
+		ParallelMark = false;
+	}
 	while (State != GCS_Pause)
 	{
 		SingleStep();
 	}
+	MarkClock.Reset();
+	SweepClock.Reset();
 	SetThreshold();
 }
 
+//==========================================================================
+//
+// VerifyParallelMark
+//
+// Marks everything serially and in parallel and checks that both find
+// the same live objects. This does not free anything and finishes with a
+// full collection to get back into a consistent state.
+//
+//==========================================================================
+
+static void GetMarkedObjects(TArray<DObject *> &marked)
+{
+	for (DObject *obj = Root; obj != NULL; obj = obj->ObjNext)
+	{
+		if (obj->IsBlack()) marked.Push(obj);
+		obj->MakeWhite();
+	}
+	Gray = NULL;
+}
+
+void VerifyParallelMark(int passes)
+{
+	while (State != GCS_Pause)
+	{
+		SingleStep();
+	}
+	int numthreads = PrepareParallelMark(true);
+	int failed = 0;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		TArray<DObject *> serial, parallel;
+
+		MarkRoot();
+		while (Gray != NULL)
+		{
+			PropagateMark();
+		}
+		GetMarkedObjects(serial);
+
+		ParallelMark = true;
+		MarkRoot();
+		ParallelPropagate(numthreads);
+		ParallelMark = false;
+		GetMarkedObjects(parallel);
+
+		// Both lists are in the order of the object list, which marking doesn't change.
+		bool same = serial.Size() == parallel.Size();
+		for (unsigned i = 0; same && i < serial.Size(); i++)
+		{
+			same = serial[i] == parallel[i];
+		}
+		if (!same)
+		{
+			Printf(TEXTCOLOR_RED "Pass %d: serial mark found %u objects, parallel mark with %d threads found %u\n",
+				pass + 1, serial.Size(), numthreads, parallel.Size());
+			failed++;
+		}
+	}
+	Printf("%d of %d passes found the same live objects\n", passes - failed, passes);
+	State = GCS_Pause;
+	FullGC();
+}
+
 //==========================================================================
 //
 // Barrier
@@ -604,13 +977,15 @@ ADD_STAT(gc)
 		"  Sweep  ",
 		"Finalize " };
 	FString out;
-	out.Format("[%s] Alloc:%6zuK  Thresh:%6zuK  Est:%6zuK  Steps: %d  %zuK",
+	out.Format("[%s] Alloc:%6zuK  Thresh:%6zuK  Est:%6zuK  Steps: %d  %zuK\n",
 		StateStrings[GC::State],
 		(GC::AllocBytes + 1023) >> 10,
 		(GC::Threshold + 1023) >> 10,
 		(GC::Estimate + 1023) >> 10,
 		GC::StepCount,
 		(GC::MinStepSize + 1023) >> 10);
+	out.AppendFormat("Mark: %.2f ms  Sweep: %.2f ms  Pause: %.2f ms (peak %.2f ms)",
+		GC::LastMarkTime, GC::LastSweepTime, GC::LastStepTime, GC::MaxStepTime);
 	return out;
 }
 
@@ -626,7 +1001,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|count|verify [passes]|pause [size]|stepmul [size]\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -641,6 +1016,10 @@ CCMD(gc)
 	{
 		GC::FullGC();
 	}
+	else if (stricmp(argv[1], "verify") == 0)
+	{
+		GC::VerifyParallelMark(argv.argc() > 2 ? max(1, atoi(argv[2])) : 1);
+	}
 	else if (stricmp(argv[1], "count") == 0)
 	{
 		int cnt = 0;
@@ -67,6 +67,9 @@ namespace GC
 	// Size of GC steps.
 	extern int StepMul;
 
+	// Is the current full collection marking with multiple threads?
+	extern bool ParallelMark;
+
 	// Is this the final collection just before exit?
 	extern bool FinalGC;
 
@@ -88,6 +91,9 @@ namespace GC
 	// Does a complete collection.
 	void FullGC();
 
+	// Checks that the parallel marker finds the same objects as the serial one.
+	void VerifyParallelMark(int passes);
+
 	// Handles the grunt work for a write barrier.
 	void Barrier(DObject *pointing, DObject *pointed);
 
@@ -128,6 +134,9 @@ namespace GC
 	// Marks an array of objects.
 	void MarkArray(DObject **objs, size_t count);
 
+	// Returns a partially propagated object to the gray list.
+	void Regray(DObject *obj);
+
 	// For cleanup
 	void DelSoftRootHead();
 
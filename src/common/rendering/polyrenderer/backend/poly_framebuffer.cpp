@@ -468,6 +468,29 @@ TArray<uint8_t> PolyFrameBuffer::GetScreenshotBuffer(int &pitch, ESSType &color_
 	return ScreenshotBuffer;
 }
 
+void PolyFrameBuffer::CopyScreenToBuffer(int width, int height, uint8_t *scr)
+{
+	FlushDrawCommands();
+	DrawerThreads::WaitForWorkers();
+
+	// The scene was rendered into the top left corner of the canvas. Convert that area from BGRA to RGB.
+	width = min(width, mCanvas->GetWidth());
+	height = min(height, mCanvas->GetHeight());
+	const uint32_t *pixels = (const uint32_t *)mCanvas->GetPixels();
+	int pitch = mCanvas->GetPitch();
+	for (int y = 0; y < height; y++)
+	{
+		const uint32_t *src = pixels + y * pitch;
+		for (int x = 0; x < width; x++)
+		{
+			PalEntry color = src[x];
+			*scr++ = color.r;
+			*scr++ = color.g;
+			*scr++ = color.b;
+		}
+	}
+}
+
 void PolyFrameBuffer::BeginFrame()
 {
 	SetViewportRects(nullptr);
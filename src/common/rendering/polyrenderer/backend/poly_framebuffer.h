@@ -53,6 +53,7 @@ public:
 	FTexture *WipeEndScreen() override;
 
 	TArray<uint8_t> GetScreenshotBuffer(int &pitch, ESSType &color_type, float &gamma) override;
+	void CopyScreenToBuffer(int width, int height, uint8_t *scr) override;
 
 	void SetVSync(bool vsync) override;
 	void Draw2D(bool outside2D = false) override;
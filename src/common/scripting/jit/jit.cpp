@@ -2,14 +2,26 @@
 #include "jit.h"
 #include "jitintern.h"
 #include "printf.h"
+#include "c_cvars.h"
 
 extern PString *TypeString;
 extern PStruct *TypeVector2;
 extern PStruct *TypeVector3;
 
+// Functions are first compiled as they are. Once a function has been called
+// vm_jit_hotcalls times it gets recompiled with small callees inlined and
+// monomorphic virtual calls devirtualized.
+CVAR(Bool, vm_jit_tiered, true, 0)
+CVAR(Int, vm_jit_hotcalls, 2000, 0)
+CVAR(Int, vm_jit_inlinesize, 48, 0)
+
+// Calls natives with a direct entry point without going through the VM calling convention.
+// Only meant to be switched off for comparing the call overhead of both paths.
+CVAR(Bool, vm_jit_directnative, true, 0)
+
 static void OutputJitLog(const asmjit::StringLogger &logger);
 
-JitFuncPtr JitCompile(VMScriptFunction *sfunc)
+JitFuncPtr JitCompile(VMScriptFunction *sfunc, int tier)
 {
 #if 0
 	if (strcmp(sfunc->PrintableName.GetChars(), "StatusScreen.drawNum") != 0)
@@ -26,7 +38,7 @@ JitFuncPtr JitCompile(VMScriptFunction *sfunc)
 		code.setErrorHandler(&errorHandler);
 		code.setLogger(&logger);
 
-		JitCompiler compiler(&code, sfunc);
+		JitCompiler compiler(&code, sfunc, tier);
 		return reinterpret_cast<JitFuncPtr>(AddJitFunction(&code, &compiler));
 	}
 	catch (const CRecoverableError &e)
@@ -418,6 +430,12 @@ void JitCompiler::EmitPopFrame()
 	}
 }
 
+static void JitTierUp(VMScriptFunction *sfunc)
+{
+	JitFuncPtr code = JitCompile(sfunc, 2);
+	if (code) sfunc->ScriptCall = code;
+}
+
 void JitCompiler::IncrementVMCalls()
 {
 	// VMCalls[0]++
@@ -427,6 +445,21 @@ void JitCompiler::IncrementVMCalls()
 	cc.mov(vmcalls, asmjit::x86::dword_ptr(vmcallsptr));
 	cc.add(vmcalls, (int)1);
 	cc.mov(asmjit::x86::dword_ptr(vmcallsptr), vmcalls);
+
+	if (tier == 1 && vm_jit_tiered && vm_jit_hotcalls > 0)
+	{
+		// if (++sfunc->JitCallCount == vm_jit_hotcalls) JitTierUp(sfunc)
+		auto skip = cc.newLabel();
+		cc.mov(vmcallsptr, asmjit::imm_ptr(&sfunc->JitCallCount));
+		cc.mov(vmcalls, asmjit::x86::dword_ptr(vmcallsptr));
+		cc.add(vmcalls, (int)1);
+		cc.mov(asmjit::x86::dword_ptr(vmcallsptr), vmcalls);
+		cc.cmp(vmcalls, (int)vm_jit_hotcalls);
+		cc.jne(skip);
+		auto call = CreateCall<void, VMScriptFunction *>(JitTierUp);
+		call->setArg(0, asmjit::imm_ptr(sfunc));
+		cc.bind(skip);
+	}
 }
 
 void JitCompiler::CreateRegisters()
@@ -489,12 +522,18 @@ asmjit::Label JitCompiler::EmitThrowExceptionLabel(EVMAbortException reason)
 
 	JitLineInfo info;
 	info.Label = label;
-	info.LineNumber = sfunc->PCToLine(pc);
+	info.LineNumber = CurrentLine();
 	LineInfo.Push(info);
 
 	return label;
 }
 
+int JitCompiler::CurrentLine()
+{
+	// Inlined code is reported at the line of the call.
+	return inlineFrame ? inlineFrame->lineNumber : sfunc->PCToLine(pc);
+}
+
 asmjit::X86Gp JitCompiler::CheckRegD(int r0, int r1)
 {
 	if (r0 != r1)
@@ -1,8 +1,29 @@
 
 #include "jitintern.h"
+#include "c_cvars.h"
 #include <map>
 #include <memory>
 
+EXTERN_CVAR(Bool, vm_jit_tiered)
+EXTERN_CVAR(Int, vm_jit_inlinesize)
+EXTERN_CVAR(Bool, vm_jit_directnative)
+
+// The profiles are allocated individually because the generated code keeps pointers to them.
+static TMap<const VMOP *, JitCallSiteProfile *> CallSiteProfiles;
+
+// The profiled code and the functions it points to are gone after a VM shutdown,
+// and a new VMOP could get the address of an old one.
+void JitClearCallSiteProfiles()
+{
+	TMap<const VMOP *, JitCallSiteProfile *>::Iterator it(CallSiteProfiles);
+	TMap<const VMOP *, JitCallSiteProfile *>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		delete pair->Value;
+	}
+	CallSiteProfiles.Clear();
+}
+
 void JitCompiler::EmitPARAM()
 {
 	ParamOpcodes.Push(pc);
@@ -42,7 +63,10 @@ void JitCompiler::EmitVtbl(const VMOP *op)
 
 void JitCompiler::EmitCALL()
 {
-	EmitVMCall(regA[A], nullptr);
+	if (!EmitDevirtualizedCall())
+	{
+		EmitVMCall(regA[A], nullptr);
+	}
 	pc += C; // Skip RESULTs
 }
 
@@ -54,10 +78,14 @@ void JitCompiler::EmitCALL_K()
 	if (target && (target->VarFlags & VARF_Native))
 		ntarget = static_cast<VMNativeFunction *>(target);
 
-	if (ntarget && ntarget->DirectNativeCall)
+	if (ntarget && ntarget->DirectNativeCall && vm_jit_directnative)
 	{
 		EmitNativeCall(ntarget);
 	}
+	else if (CanInlineCall(target))
+	{
+		EmitInlineCall(static_cast<VMScriptFunction*>(target));
+	}
 	else
 	{
 		auto ptr = newTempIntPtr();
@@ -79,7 +107,11 @@ void JitCompiler::EmitVMCall(asmjit::X86Gp vmfunc, VMFunction *target)
 		I_Error("OP_CALL parameter count does not match the number of preceding OP_PARAM instructions");
 
 	if (pc > sfunc->Code && (pc - 1)->op == OP_VTBL)
+	{
 		EmitVtbl(pc - 1);
+		if (tier == 1 && vm_jit_tiered)
+			EmitProfileVirtualCall(vmfunc);
+	}
 
 	FillReturns(pc + 1, C);
 
@@ -105,6 +137,424 @@ void JitCompiler::EmitVMCall(asmjit::X86Gp vmfunc, VMFunction *target)
 	ParamOpcodes.Clear();
 }
 
+static void ProfileVirtualCall(JitCallSiteProfile *site, VMFunction *target)
+{
+	if (site->Target == nullptr && site->Misses == 0)
+		site->Target = target;
+	else
+		site->Misses++;
+}
+
+void JitCompiler::EmitProfileVirtualCall(asmjit::X86Gp vmfunc)
+{
+	using namespace asmjit;
+
+	// if (site->Target != vmfunc) ProfileVirtualCall(site, vmfunc)
+	JitCallSiteProfile *site;
+	if (auto known = CallSiteProfiles.CheckKey(pc))
+	{
+		site = *known;
+	}
+	else
+	{
+		site = new JitCallSiteProfile;
+		CallSiteProfiles.Insert(pc, site);
+	}
+	auto siteptr = newTempIntPtr();
+	auto hit = cc.newLabel();
+	cc.mov(siteptr, imm_ptr(site));
+	cc.cmp(x86::ptr(siteptr, myoffsetof(JitCallSiteProfile, Target)), vmfunc);
+	cc.je(hit);
+	auto call = CreateCall<void, JitCallSiteProfile *, VMFunction *>(ProfileVirtualCall);
+	call->setArg(0, siteptr);
+	call->setArg(1, vmfunc);
+	cc.bind(hit);
+}
+
+bool JitCompiler::EmitDevirtualizedCall()
+{
+	using namespace asmjit;
+
+	if (tier < 2 || inlineFrame || pc == sfunc->Code || (pc - 1)->op != OP_VTBL)
+		return false;
+
+	// Only sites which never saw a second target during profiling are worth it.
+	auto profile = CallSiteProfiles.CheckKey(pc);
+	if (profile == nullptr || (*profile)->Target == nullptr || (*profile)->Misses > 0)
+		return false;
+
+	VMFunction *target = (*profile)->Target;
+	VMNativeFunction *ntarget = nullptr;
+	if (target->VarFlags & VARF_Native)
+	{
+		ntarget = static_cast<VMNativeFunction *>(target);
+		if (!ntarget->DirectNativeCall || !vm_jit_directnative)
+			return false;
+
+		for (auto param : ParamOpcodes)
+		{
+			if (param->op == OP_PARAM && (param->a & REGT_ADDROF) && (param->a & REGT_TYPE) != REGT_STRING)
+				return false;
+		}
+	}
+	else if (!CanInlineCall(target))
+	{
+		return false;
+	}
+
+	// if (vmfunc == target) <inline or direct call> else <virtual call>
+	auto slowpath = cc.newLabel();
+	auto done = cc.newLabel();
+
+	const VMOP *vtbl = pc - 1;
+	EmitVtbl(vtbl);
+	auto expected = newTempIntPtr();
+	cc.mov(expected, imm_ptr(target));
+	cc.cmp(regA[vtbl->a], expected);
+	cc.jne(slowpath);
+
+	TArray<const VMOP *> params = ParamOpcodes;
+	if (ntarget)
+		EmitNativeCall(ntarget, true);
+	else
+		EmitInlineCall(static_cast<VMScriptFunction *>(target));
+	cc.jmp(done);
+
+	cc.bind(slowpath);
+	ParamOpcodes = std::move(params);
+	EmitVMCall(regA[A], nullptr);
+	cc.bind(done);
+	return true;
+}
+
+bool JitCompiler::GetInlineArgs(VMScriptFunction *callee, TArray<InlineArg> &inlineargs)
+{
+	if (callee->Proto == nullptr)
+		return false;
+
+	// Split the parameters into register sized slots
+	TArray<InlineArg> slots;
+	for (auto param : ParamOpcodes)
+	{
+		int count = 1;
+		if (param->op == OP_PARAM)
+		{
+			if ((param->a & REGT_ADDROF) || (param->a & REGT_TYPE) == REGT_STRING)
+				return false;
+			if (param->a == (REGT_FLOAT | REGT_MULTIREG2))
+				count = 2;
+			else if (param->a == (REGT_FLOAT | REGT_MULTIREG3))
+				count = 3;
+		}
+		for (int j = 0; j < count; j++)
+			slots.Push({ REGT_NIL, 0, param, j });
+	}
+	if ((int)slots.Size() != callee->NumArgs)
+		return false;
+
+	// Assign them to the callee's registers the same way SetupSimpleFrame does
+	unsigned int slot = 0;
+	int regd = 0, regf = 0, rega = 0;
+	for (unsigned int i = 0; i < callee->Proto->ArgumentTypes.Size(); i++)
+	{
+		const PType *type = callee->Proto->ArgumentTypes[i];
+		int regtype = REGT_POINTER;
+		int count = 1;
+		if (type == nullptr || type == TypeString)
+			return false;
+		else if (callee->ArgFlags.Size() && callee->ArgFlags[i] & (VARF_Out | VARF_Ref))
+			return false;
+		else if (type == TypeVector2 || type == TypeFVector2)
+		{
+			regtype = REGT_FLOAT;
+			count = 2;
+		}
+		else if (type == TypeVector3 || type == TypeFVector3)
+		{
+			regtype = REGT_FLOAT;
+			count = 3;
+		}
+		else if (type == TypeFloat64)
+			regtype = REGT_FLOAT;
+		else if (type->isIntCompatible())
+			regtype = REGT_INT;
+
+		for (int j = 0; j < count; j++)
+		{
+			if (slot == slots.Size())
+				return false;
+
+			InlineArg arg = slots[slot++];
+			const VMOP *param = arg.param;
+			bool matches = false;
+			arg.regtype = regtype;
+			switch (regtype)
+			{
+			case REGT_INT:
+				matches = param->op == OP_PARAMI || param->a == REGT_INT || param->a == (REGT_INT | REGT_KONST);
+				arg.regnum = regd++;
+				break;
+			case REGT_FLOAT:
+				matches = param->op == OP_PARAM && (param->a & REGT_TYPE) == REGT_FLOAT;
+				arg.regnum = regf++;
+				break;
+			case REGT_POINTER:
+				matches = param->op == OP_PARAM && (param->a == REGT_NIL || param->a == REGT_POINTER || param->a == (REGT_POINTER | REGT_KONST));
+				arg.regnum = rega++;
+				break;
+			}
+			if (!matches)
+				return false;
+			inlineargs.Push(arg);
+		}
+	}
+
+	return slot == slots.Size() && regd <= callee->NumRegD && regf <= callee->NumRegF && rega <= callee->NumRegA;
+}
+
+bool JitCompiler::CanInlineCall(VMFunction *target)
+{
+	if (tier < 2 || inlineFrame || target == nullptr || (target->VarFlags & (VARF_Native | VARF_Abstract)))
+		return false;
+
+	auto callee = static_cast<VMScriptFunction *>(target);
+	if (callee == sfunc || callee->Code == nullptr || callee->CodeSize > vm_jit_inlinesize)
+		return false;
+
+	// The callee must be able to live entirely in virtual registers of the caller.
+	if (callee->NumRegS != 0 || callee->SpecialInits.Size() != 0 || callee->ExtraSpace != 0)
+		return false;
+
+	// Stay away from the asmjit register limit, see CanJit.
+	int maxregs = 200;
+	int numregs = sfunc->NumRegA + sfunc->NumRegD + sfunc->NumRegF + sfunc->NumRegS + inlineRegs;
+	if (numregs + callee->NumRegA + callee->NumRegD + callee->NumRegF >= maxregs)
+		return false;
+
+	// Leaf functions only.
+	for (int i = 0; i < callee->CodeSize; i++)
+	{
+		const VMOP &calleeop = callee->Code[i];
+		switch (calleeop.op)
+		{
+		case OP_CALL:
+		case OP_CALL_K:
+		case OP_VTBL:
+		case OP_PARAM:
+		case OP_PARAMI:
+		case OP_RESULT:
+		case OP_LFP:
+			return false;
+		case OP_RET:
+			if ((calleeop.b & REGT_TYPE) == REGT_STRING)
+				return false;
+			break;
+		}
+	}
+
+	TArray<InlineArg> inlineargs;
+	return GetInlineArgs(callee, inlineargs);
+}
+
+void JitCompiler::EmitInlineCall(VMScriptFunction *callee)
+{
+	using namespace asmjit;
+
+	TArray<InlineArg> inlineargs;
+	GetInlineArgs(callee, inlineargs);
+
+	FString comment;
+	comment.Format("; inlined %s", callee->PrintableName.GetChars());
+	cc.comment(comment.GetChars(), comment.Len());
+
+	TArray<X86Gp> calleeD, calleeA, calleeS;
+	TArray<X86Xmm> calleeF;
+	for (int i = 0; i < callee->NumRegD; i++)
+	{
+		regname.Format("inlineD%d", i);
+		calleeD.Push(cc.newInt32(regname.GetChars()));
+	}
+	for (int i = 0; i < callee->NumRegF; i++)
+	{
+		regname.Format("inlineF%d", i);
+		calleeF.Push(cc.newXmmSd(regname.GetChars()));
+	}
+	for (int i = 0; i < callee->NumRegA; i++)
+	{
+		regname.Format("inlineA%d", i);
+		calleeA.Push(cc.newIntPtr(regname.GetChars()));
+	}
+	inlineRegs += callee->NumRegD + callee->NumRegF + callee->NumRegA;
+
+	// Copy the arguments and clear all other registers, like SetupSimpleFrame does
+	int regd = 0, regf = 0, rega = 0;
+	for (auto &arg : inlineargs)
+	{
+		const VMOP *param = arg.param;
+		int bc = param->i16u;
+		switch (arg.regtype)
+		{
+		case REGT_INT:
+			if (param->op == OP_PARAMI)
+				cc.mov(calleeD[arg.regnum], param->i24);
+			else if (param->a & REGT_KONST)
+				cc.mov(calleeD[arg.regnum], konstd[bc]);
+			else
+				cc.mov(calleeD[arg.regnum], regD[bc]);
+			regd++;
+			break;
+		case REGT_FLOAT:
+			if (param->a & REGT_KONST)
+			{
+				auto tmp = newTempIntPtr();
+				cc.mov(tmp, imm_ptr(konstf + bc));
+				cc.movsd(calleeF[arg.regnum], x86::qword_ptr(tmp));
+			}
+			else
+			{
+				cc.movsd(calleeF[arg.regnum], regF[bc + arg.sub]);
+			}
+			regf++;
+			break;
+		case REGT_POINTER:
+			if (param->a == REGT_NIL)
+				cc.xor_(calleeA[arg.regnum], calleeA[arg.regnum]);
+			else if (param->a & REGT_KONST)
+				cc.mov(calleeA[arg.regnum], imm_ptr(konsta[bc].v));
+			else
+				cc.mov(calleeA[arg.regnum], regA[bc]);
+			rega++;
+			break;
+		}
+	}
+
+	for (int i = regd; i < callee->NumRegD; i++)
+		cc.xor_(calleeD[i], calleeD[i]);
+
+	for (int i = regf; i < callee->NumRegF; i++)
+		cc.xorpd(calleeF[i], calleeF[i]);
+
+	for (int i = rega; i < callee->NumRegA; i++)
+		cc.xor_(calleeA[i], calleeA[i]);
+
+	// Switch over to the callee and emit its code
+	InlineFrame frame;
+	frame.sfunc = sfunc;
+	frame.pc = pc;
+	frame.konstd = konstd;
+	frame.konstf = konstf;
+	frame.konsts = konsts;
+	frame.konsta = konsta;
+	frame.regD.Swap(regD);
+	frame.regF.Swap(regF);
+	frame.regA.Swap(regA);
+	frame.regS.Swap(regS);
+	frame.labels.Swap(labels);
+	frame.lineNumber = sfunc->PCToLine(pc);
+	frame.exit = cc.newLabel();
+	VM_UBYTE callop = op;
+
+	sfunc = callee;
+	konstd = callee->KonstD;
+	konstf = callee->KonstF;
+	konsts = callee->KonstS;
+	konsta = callee->KonstA;
+	regD.Swap(calleeD);
+	regF.Swap(calleeF);
+	regA.Swap(calleeA);
+	regS.Swap(calleeS);
+	labels.Resize(callee->CodeSize);
+	inlineFrame = &frame;
+
+	pc = callee->Code;
+	auto end = pc + callee->CodeSize;
+	while (pc != end)
+	{
+		int i = (int)(ptrdiff_t)(pc - callee->Code);
+		op = pc->op;
+
+		labels[i].cursor = cc.getCursor();
+		ResetTemp();
+		EmitOpcode();
+
+		pc++;
+	}
+
+	BindLabels();
+	cc.bind(frame.exit);
+
+	// Back to the caller
+	inlineFrame = nullptr;
+	sfunc = frame.sfunc;
+	pc = frame.pc;
+	op = callop;
+	konstd = frame.konstd;
+	konstf = frame.konstf;
+	konsts = frame.konsts;
+	konsta = frame.konsta;
+	regD.Swap(frame.regD);
+	regF.Swap(frame.regF);
+	regA.Swap(frame.regA);
+	regS.Swap(frame.regS);
+	labels.Swap(frame.labels);
+
+	ParamOpcodes.Clear();
+}
+
+void JitCompiler::EmitInlineReturn(int a, int regtype, int regnum, bool immediate)
+{
+	using namespace asmjit;
+
+	// Store the value directly in the caller's OP_RESULT register
+	int retnum = a & ~RET_FINAL;
+	const VMOP *call = inlineFrame->pc;
+	if (regtype != REGT_NIL && retnum < call->c)
+	{
+		int dest = call[1 + retnum].c;
+		switch (regtype & REGT_TYPE)
+		{
+		case REGT_INT:
+			if (immediate)
+				cc.mov(inlineFrame->regD[dest], regnum);
+			else if (regtype & REGT_KONST)
+				cc.mov(inlineFrame->regD[dest], konstd[regnum]);
+			else
+				cc.mov(inlineFrame->regD[dest], regD[regnum]);
+			break;
+		case REGT_FLOAT:
+		{
+			int count = (regtype & REGT_MULTIREG3) ? 3 : (regtype & REGT_MULTIREG2) ? 2 : 1;
+			for (int j = 0; j < count; j++)
+			{
+				if (regtype & REGT_KONST)
+				{
+					auto tmp = newTempIntPtr();
+					cc.mov(tmp, imm_ptr(konstf + regnum + j));
+					cc.movsd(inlineFrame->regF[dest + j], x86::qword_ptr(tmp));
+				}
+				else
+				{
+					cc.movsd(inlineFrame->regF[dest + j], regF[regnum + j]);
+				}
+			}
+			break;
+		}
+		case REGT_POINTER:
+			if (regtype & REGT_KONST)
+				cc.mov(inlineFrame->regA[dest], imm_ptr(konsta[regnum].v));
+			else
+				cc.mov(inlineFrame->regA[dest], regA[regnum]);
+			break;
+		default:
+			I_Error("Unexpected return type in inlined function\n");
+			break;
+		}
+	}
+
+	if (regtype == REGT_NIL || (a & RET_FINAL))
+		cc.jmp(inlineFrame->exit);
+}
+
 int JitCompiler::StoreCallParams()
 {
 	using namespace asmjit;
@@ -314,11 +764,11 @@ void JitCompiler::FillReturns(const VMOP *retval, int numret)
 	}
 }
 
-void JitCompiler::EmitNativeCall(VMNativeFunction *target)
+void JitCompiler::EmitNativeCall(VMNativeFunction *target, bool devirtualized)
 {
 	using namespace asmjit;
 
-	if (pc > sfunc->Code && (pc - 1)->op == OP_VTBL)
+	if (!devirtualized && pc > sfunc->Code && (pc - 1)->op == OP_VTBL)
 	{
 		I_Error("Native direct member function calls not implemented\n");
 	}
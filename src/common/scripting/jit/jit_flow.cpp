@@ -74,6 +74,11 @@ static void SetString(VMReturn* ret, FString* str)
 void JitCompiler::EmitRET()
 {
 	using namespace asmjit;
+	if (inlineFrame)
+	{
+		EmitInlineReturn(A, B, C, false);
+		return;
+	}
 	if (B == REGT_NIL)
 	{
 		EmitPopFrame();
@@ -214,6 +219,11 @@ void JitCompiler::EmitRET()
 void JitCompiler::EmitRETI()
 {
 	using namespace asmjit;
+	if (inlineFrame)
+	{
+		EmitInlineReturn(A, REGT_INT, BCs, true);
+		return;
+	}
 
 	int a = A;
 	int retnum = a & ~RET_FINAL;
@@ -264,7 +274,7 @@ void JitCompiler::EmitBOUND()
 
 	JitLineInfo info;
 	info.Label = label;
-	info.LineNumber = sfunc->PCToLine(pc);
+	info.LineNumber = CurrentLine();
 	LineInfo.Push(info);
 }
 
@@ -283,7 +293,7 @@ void JitCompiler::EmitBOUND_K()
 
 	JitLineInfo info;
 	info.Label = label;
-	info.LineNumber = sfunc->PCToLine(pc);
+	info.LineNumber = CurrentLine();
 	LineInfo.Push(info);
 }
 
@@ -302,7 +312,7 @@ void JitCompiler::EmitBOUND_R()
 
 	JitLineInfo info;
 	info.Label = label;
-	info.LineNumber = sfunc->PCToLine(pc);
+	info.LineNumber = CurrentLine();
 	LineInfo.Push(info);
 }
 
@@ -753,6 +753,7 @@ void JitRelease()
 	{
 		asmjit::OSUtils::releaseVirtualMemory(p, 1024 * 1024);
 	}
+	JitClearCallSiteProfiles();
 	JitDebugInfo.Clear();
 	JitFrames.Clear();
 	JitBlocks.Clear();
@@ -32,10 +32,19 @@ struct JitLineInfo
 	asmjit::Label Label;
 };
 
+// Receiver profile of a virtual call site, collected by the first tier.
+struct JitCallSiteProfile
+{
+	VMFunction *Target = nullptr;	// first function called from this site
+	int Misses = 0;					// number of calls that went somewhere else
+};
+
+void JitClearCallSiteProfiles();
+
 class JitCompiler
 {
 public:
-	JitCompiler(asmjit::CodeHolder *code, VMScriptFunction *sfunc) : cc(code), sfunc(sfunc) { }
+	JitCompiler(asmjit::CodeHolder *code, VMScriptFunction *sfunc, int tier = 1) : cc(code), sfunc(sfunc), tier(tier) { }
 
 	asmjit::CCFunc *Codegen();
 	VMScriptFunction *GetScriptFunction() { return sfunc; }
@@ -60,9 +69,25 @@ private:
 	void EmitOpcode();
 	void EmitPopFrame();
 
-	void EmitNativeCall(VMNativeFunction *target);
+	void EmitNativeCall(VMNativeFunction *target, bool devirtualized = false);
 	void EmitVMCall(asmjit::X86Gp ptr, VMFunction *target);
 	void EmitVtbl(const VMOP *op);
+	void EmitProfileVirtualCall(asmjit::X86Gp vmfunc);
+	bool EmitDevirtualizedCall();
+
+	struct InlineArg
+	{
+		int regtype;			// register type in the callee
+		int regnum;
+		const VMOP *param;		// OP_PARAM or OP_PARAMI of the caller
+		int sub;				// register offset inside a vector parameter
+	};
+
+	bool GetInlineArgs(VMScriptFunction *callee, TArray<InlineArg> &inlineargs);
+	bool CanInlineCall(VMFunction *target);
+	void EmitInlineCall(VMScriptFunction *callee);
+	void EmitInlineReturn(int a, int regtype, int regnum, bool immediate);
+	int CurrentLine();
 
 	int StoreCallParams();
 	void LoadInOuts();
@@ -246,6 +271,7 @@ private:
 
 	asmjit::X86Compiler cc;
 	VMScriptFunction *sfunc;
+	int tier;
 
 	asmjit::CCFunc *func = nullptr;
 	asmjit::X86Gp args;
@@ -306,6 +332,27 @@ private:
 
 	const VMOP *pc;
 	VM_UBYTE op;
+
+	// State of the calling function while the code of a callee gets inlined into it.
+	struct InlineFrame
+	{
+		VMScriptFunction *sfunc;
+		const VMOP *pc;
+		const int *konstd;
+		const double *konstf;
+		const FString *konsts;
+		const FVoidObj *konsta;
+		TArray<asmjit::X86Gp> regD;
+		TArray<asmjit::X86Xmm> regF;
+		TArray<asmjit::X86Gp> regA;
+		TArray<asmjit::X86Gp> regS;
+		TArray<OpcodeLabel> labels;
+		int lineNumber;
+		asmjit::Label exit;
+	};
+
+	InlineFrame *inlineFrame = nullptr;
+	int inlineRegs = 0;
 };
 
 class AsmJitException : public std::exception
@@ -44,6 +44,8 @@
 #include "memarena.h"
 #include "name.h"
 #include "scopebarrier.h"
+#include <type_traits>
+#include <utility>
 
 class DObject;
 union VMOP;
@@ -661,6 +663,78 @@ struct AFuncDesc
 	MSVC_ASEG AFuncDesc const *const cls##_##name##_HookPtr GCC_ASEG = &cls##_##name##_Hook; \
 	static int AF_##cls##_##name(VM_ARGS)
 
+// Generates the VM thunk of a direct native function from the function's signature,
+// so that only the direct native needs to be written. The first argument is checked
+// for nullptr, like PARAM_SELF_PROLOGUE does, unless the _STATIC version is used.
+// Only pointers, numbers and enums can be passed this way. Everything else needs a
+// specialization that knows how the VM passes it.
+template<typename T, typename = void> struct VMAutoParam
+{
+	static_assert(std::is_pointer_v<T>, "Unsupported parameter type for a direct native function");
+	static T Get(const VMValue &v) { return (T)v.a; }
+};
+template<typename T> struct VMAutoParam<T, std::enable_if_t<std::is_enum_v<T>>> { static T Get(const VMValue &v) { return (T)v.i; } };
+template<> struct VMAutoParam<int> { static int Get(const VMValue &v) { return v.i; } };
+template<> struct VMAutoParam<unsigned int> { static unsigned int Get(const VMValue &v) { return v.i; } };
+template<> struct VMAutoParam<bool> { static bool Get(const VMValue &v) { return !!v.i; } };
+template<> struct VMAutoParam<double> { static double Get(const VMValue &v) { return v.f; } };
+template<> struct VMAutoParam<float> { static float Get(const VMValue &v) { return (float)v.f; } };
+
+template<typename T, typename = void> struct VMAutoReturn
+{
+	static_assert(std::is_pointer_v<T>, "Unsupported return type for a direct native function");
+	static void Set(VMReturn *ret, T v) { ret->SetPointer((void*)v); }
+};
+template<typename T> struct VMAutoReturn<T, std::enable_if_t<std::is_enum_v<T>>> { static void Set(VMReturn *ret, T v) { ret->SetInt((int)v); } };
+template<> struct VMAutoReturn<int> { static void Set(VMReturn *ret, int v) { ret->SetInt(v); } };
+template<> struct VMAutoReturn<unsigned int> { static void Set(VMReturn *ret, unsigned int v) { ret->SetInt(v); } };
+template<> struct VMAutoReturn<bool> { static void Set(VMReturn *ret, bool v) { ret->SetInt(v); } };
+template<> struct VMAutoReturn<double> { static void Set(VMReturn *ret, double v) { ret->SetFloat(v); } };
+template<> struct VMAutoReturn<float> { static void Set(VMReturn *ret, float v) { ret->SetFloat(v); } };
+
+template<auto Func> struct VMAutoThunk;
+template<typename Ret, typename... Args, Ret(*Func)(Args...)> struct VMAutoThunk<Func>
+{
+	template<bool CheckSelf> static int Call(VM_ARGS)
+	{
+		assert(numparam >= (int)sizeof...(Args));
+		if (CheckSelf && param[0].a == nullptr) NullParam("self");
+		return Invoke(param, ret, numret, std::index_sequence_for<Args...>());
+	}
+
+	template<size_t... I> static int Invoke(VMValue *param, VMReturn *ret, int numret, std::index_sequence<I...>)
+	{
+		if constexpr (std::is_void_v<Ret>)
+		{
+			Func(VMAutoParam<Args>::Get(param[I])...);
+			return 0;
+		}
+		else
+		{
+			Ret v = Func(VMAutoParam<Args>::Get(param[I])...);
+			if (numret > 0)
+			{
+				assert(ret != nullptr);
+				VMAutoReturn<Ret>::Set(ret, v);
+				return 1;
+			}
+			return 0;
+		}
+	}
+};
+
+#define DEFINE_ACTION_FUNCTION_AUTO(cls, name, native) \
+	DEFINE_ACTION_FUNCTION_NATIVE(cls, name, native) \
+	{ \
+		return VMAutoThunk<native>::Call<true>(VM_ARGS_NAMES); \
+	}
+
+#define DEFINE_ACTION_FUNCTION_AUTO_STATIC(cls, name, native) \
+	DEFINE_ACTION_FUNCTION_NATIVE(cls, name, native) \
+	{ \
+		return VMAutoThunk<native>::Call<false>(VM_ARGS_NAMES); \
+	}
+
 // cls is the scripted class name, icls the internal one (e.g. player_t vs. Player)
 #define DEFINE_FIELD_X(cls, icls, name) \
 	static const FieldDesc VMField_##icls##_##name = { "A" #cls, #name, (unsigned)myoffsetof(icls, name), (unsigned)sizeof(icls::name), 0 }; \
@@ -43,10 +43,14 @@
 #include "basics.h"
 #include "texturemanager.h"
 #include "palutil.h"
+#include "c_cvars.h"
 
 extern cycle_t VMCycles[10];
 extern int VMCalls[10];
 
+// Runs the interpreter on a copy of the code where common instruction sequences have been fused.
+CVAR(Bool, vm_superops, true, 0)
+
 // THe sprite ID to string cast is game specific so let's do it with a callback to remove the dependency and allow easier reuse.
 void (*VM_CastSpriteIDToString)(FString* a, unsigned int b) = [](FString* a, unsigned int b) { a->Format("%d", b); };
 
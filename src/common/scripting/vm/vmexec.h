@@ -44,6 +44,7 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 	{
 #define xx(op,sym,mode,alt,kreg,ktype) &&op,
 #include "vmops.h"
+		&&LBIT_EQ_K, &&LBU_EQ_K, &&LW_EQ_K, &&LO_EQA_K, &&LP_EQA_K, &&VTBL_CALL, &&ADDI_JMP,
 	};
 #endif
 	//const VMOP *exception_frames[MAX_TRY_DEPTH];
@@ -54,7 +55,7 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 	const double *konstf = sfunc->KonstF;
 	const FString *konsts = sfunc->KonstS;
 	const FVoidObj *konsta = sfunc->KonstA;
-	const VMOP *pc = sfunc->Code;
+	const VMOP *pc = vm_superops ? sfunc->GetThreadedCode() : sfunc->Code;
 
 	assert(!(f->Func->VarFlags & VARF_Native) && "Only script functions should ever reach VMExec");
 
@@ -1721,6 +1722,69 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 
 	OP(NOP):
 		NEXTOP;
+
+	// Superinstructions. See VMScriptFunction::BuildThreadedCode for what gets fused.
+	OP(LBIT_EQ_K):
+		ASSERTD(a); ASSERTA(B);
+		GETADDR(PB,0,X_READ_NIL);
+		b = reg.d[a] = !!(*(VM_UBYTE *)ptr & C);
+		pc++; a = pc->a;
+		ASSERTKD(C);
+		CMPJMP(b == konstd[C]);
+		NEXTOP;
+	OP(LBU_EQ_K):
+		ASSERTD(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		b = reg.d[a] = *(VM_UBYTE *)ptr;
+		pc++; a = pc->a;
+		ASSERTKD(C);
+		CMPJMP(b == konstd[C]);
+		NEXTOP;
+	OP(LW_EQ_K):
+		ASSERTD(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		b = reg.d[a] = *(VM_SWORD *)ptr;
+		pc++; a = pc->a;
+		ASSERTKD(C);
+		CMPJMP(b == konstd[C]);
+		NEXTOP;
+	OP(LO_EQA_K):
+		ASSERTA(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		ptr = reg.a[a] = GC::ReadBarrier(*(DObject **)ptr);
+		pc++; a = pc->a;
+		ASSERTKA(C);
+		CMPJMP(ptr == konsta[C].v);
+		NEXTOP;
+	OP(LP_EQA_K):
+		ASSERTA(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		ptr = reg.a[a] = *(void **)ptr;
+		pc++; a = pc->a;
+		ASSERTKA(C);
+		CMPJMP(ptr == konsta[C].v);
+		NEXTOP;
+	OP(VTBL_CALL):
+		ASSERTA(a); ASSERTA(B);
+		{
+			auto o = (DObject*)reg.a[B];
+			if (o == nullptr)
+			{
+				ThrowAbortException(X_READ_NIL, nullptr);
+				return 0;
+			}
+			auto p = o->GetClass();
+			assert(C < p->Virtuals.Size());
+			ptr = reg.a[a] = p->Virtuals[C];
+		}
+		pc++;
+		goto Do_CALL;
+	OP(ADDI_JMP):
+		ASSERTD(a); ASSERTD(B);
+		reg.d[a] = reg.d[B] + Cs;
+		pc++;
+		pc += JMPOFS(pc);
+		NEXTOP;
 	}
 	}
 #if 0
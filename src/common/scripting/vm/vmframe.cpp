@@ -33,6 +33,7 @@
 */
 
 #include <new>
+#include <algorithm>
 #include "dobject.h"
 #include "v_text.h"
 #include "stats.h"
@@ -134,6 +135,8 @@ VMScriptFunction::VMScriptFunction(FName name)
 	NumKonstA = 0;
 	MaxParam = 0;
 	NumArgs = 0;
+	JitCallCount = 0;
+	ThreadedCode = nullptr;
 	ScriptCall = &VMScriptFunction::FirstScriptCall;
 }
 
@@ -257,6 +260,10 @@ int VMScriptFunction::AllocExtraStack(PType *type)
 int VMScriptFunction::PCToLine(const VMOP *pc)
 {
 	int PCIndex = int(pc - Code);
+	if (ThreadedCode != nullptr && pc >= ThreadedCode && pc < ThreadedCode + CodeSize)
+	{
+		PCIndex = int(pc - ThreadedCode);
+	}
 	if (LineInfoCount == 1) return LineInfo[0].LineNumber;
 	for (unsigned i = 1; i < LineInfoCount; i++)
 	{
@@ -268,6 +275,53 @@ int VMScriptFunction::PCToLine(const VMOP *pc)
 	return -1;
 }
 
+//===========================================================================
+//
+// VMScriptFunction :: BuildThreadedCode
+//
+// Creates the copy of the code the interpreter runs, with the first
+// instruction of common sequences replaced by a superinstruction that
+// executes the entire sequence with a single dispatch.
+//
+//===========================================================================
+
+void VMScriptFunction::BuildThreadedCode()
+{
+	static const struct
+	{
+		VM_UBYTE First, Second, Fused;
+	} sequences[] =
+	{
+		{ OP_LBIT, OP_EQ_K, OP_LBIT_EQ_K },
+		{ OP_LBU, OP_EQ_K, OP_LBU_EQ_K },
+		{ OP_LW, OP_EQ_K, OP_LW_EQ_K },
+		{ OP_LO, OP_EQA_K, OP_LO_EQA_K },
+		{ OP_LP, OP_EQA_K, OP_LP_EQA_K },
+		{ OP_VTBL, OP_CALL, OP_VTBL_CALL },
+		{ OP_ADDI, OP_JMP, OP_ADDI_JMP },
+	};
+
+	ThreadedCode = (VMOP *)ClassDataAllocator.Alloc(CodeSize * sizeof(VMOP));
+	memcpy(ThreadedCode, Code, CodeSize * sizeof(VMOP));
+
+	for (int i = 0; i < CodeSize - 1; i++)
+	{
+		for (auto &seq : sequences)
+		{
+			if (Code[i].op != seq.First || Code[i + 1].op != seq.Second)
+				continue;
+
+			// The fused handlers pass the loaded value on directly, so the second instruction must be using it.
+			int user = seq.Second == OP_JMP ? -1 : seq.Second == OP_CALL ? Code[i + 1].a : Code[i + 1].b;
+			if (user == -1 || user == Code[i].a)
+			{
+				ThreadedCode[i].op = seq.Fused;
+				break;
+			}
+		}
+	}
+}
+
 static bool CanJit(VMScriptFunction *func)
 {
 	// Asmjit has a 256 register limit. Stay safely away from it as the jit compiler uses a few for temporaries as well.
@@ -782,3 +836,59 @@ CCMD(vmengine)
 	Printf("Usage: vmengine <default|checked|unchecked>\n");
 }
 
+
+//-----------------------------------------------------------------------------
+//
+// Lists the native functions that get called most often from scripts
+// but still go through the VM calling convention instead of being called
+// directly by the JIT. These are the candidates for conversion to
+// DEFINE_ACTION_FUNCTION_AUTO or DEFINE_ACTION_FUNCTION_NATIVE.
+//
+//-----------------------------------------------------------------------------
+
+CCMD(vmnativeaudit)
+{
+	TMap<VMFunction *, int> callsites;
+	for (auto func : VMFunction::AllFunctions)
+	{
+		if (func->VarFlags & VARF_Native)
+			continue;
+
+		auto sfunc = static_cast<VMScriptFunction *>(func);
+		for (int i = 0; i < sfunc->CodeSize; i++)
+		{
+			const VMOP &op = sfunc->Code[i];
+			if (op.op != OP_CALL_K)
+				continue;
+
+			auto target = static_cast<VMFunction *>(sfunc->KonstA[op.a].v);
+			if (target && (target->VarFlags & VARF_Native) && static_cast<VMNativeFunction *>(target)->DirectNativeCall == nullptr)
+			{
+				callsites[target]++;
+			}
+		}
+	}
+
+	struct FAuditEntry
+	{
+		VMFunction *Func;
+		int Count;
+	};
+	TArray<FAuditEntry> list;
+	int total = 0;
+	TMap<VMFunction *, int>::Iterator it(callsites);
+	TMap<VMFunction *, int>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		list.Push({ pair->Key, pair->Value });
+		total += pair->Value;
+	}
+	std::sort(list.begin(), list.end(), [](const FAuditEntry &a, const FAuditEntry &b) { return a.Count > b.Count; });
+
+	unsigned count = argv.argc() > 1 ? (unsigned)atoi(argv[1]) : 30u;
+	for (unsigned i = 0; i < list.Size() && i < count; i++)
+	{
+		Printf("%5d  %s\n", list[i].Count, list[i].Func->PrintableName.GetChars());
+	}
+	Printf("%u natives without a direct call, %d call sites\n", list.Size(), total);
+}
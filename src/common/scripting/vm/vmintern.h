@@ -57,6 +57,23 @@ enum
 NUM_OPS
 };
 
+// Superinstructions that only exist in the interpreter's pre-decoded copy of a
+// function's code. Each one replaces the opcode of the first instruction of a
+// common sequence and executes the whole sequence. The following instructions
+// are left in place so that jumps into the middle of a sequence still work.
+enum
+{
+	OP_LBIT_EQ_K = NUM_OPS,	// LBIT + EQ_K + JMP: test an actor flag and branch
+	OP_LBU_EQ_K,			// LBU + EQ_K + JMP: test a bool field and branch
+	OP_LW_EQ_K,				// LW + EQ_K + JMP: compare an int field and branch
+	OP_LO_EQA_K,			// LO + EQA_K + JMP: test an object field for null and branch
+	OP_LP_EQA_K,			// LP + EQA_K + JMP: test a pointer field for null and branch
+	OP_VTBL_CALL,			// VTBL + CALL: virtual function call
+	OP_ADDI_JMP,			// ADDI + JMP: loop counter increment and back edge
+	NUM_THREADED_OPS
+};
+static_assert(NUM_THREADED_OPS <= 256, "Opcodes must fit into a byte");
+
 // Flags for A field of CMPS
 enum
 {
@@ -471,6 +488,8 @@ public:
 	VM_UHALF NumKonstA;
 	VM_UHALF MaxParam;		// Maximum number of parameters this function has on the stack at once
 	VM_UBYTE NumArgs;		// Number of arguments this function takes
+	int JitCallCount;		// Number of calls into the first JIT tier, used to find hot functions
+	VMOP *ThreadedCode;		// Copy of Code with superinstructions for the interpreter, created on first use
 	TArray<FTypeAndOffset> SpecialInits;	// list of all contents on the extra stack which require construction and destruction
 
 	void InitExtra(void *addr);
@@ -478,6 +497,13 @@ public:
 	int AllocExtraStack(PType *type);
 	int PCToLine(const VMOP *pc);
 
+	const VMOP *GetThreadedCode()
+	{
+		if (ThreadedCode == nullptr) BuildThreadedCode();
+		return ThreadedCode;
+	}
+
 private:
+	void BuildThreadedCode();
 	static int FirstScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
 };
@@ -369,6 +369,7 @@ public:
 
 	BufferWriter() {}
 	virtual size_t Write(const void *buffer, size_t len) override;
+	virtual long Tell() override { return mBuffer.Size(); }
 	TArray<unsigned char> *GetBuffer() { return &mBuffer; }
 	TArray<unsigned char>&& TakeBuffer() { return std::move(mBuffer); }
 };
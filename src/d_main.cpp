@@ -88,11 +88,13 @@
 #include "d_net.h"
 #include "d_event.h"
 #include "d_netinf.h"
+#include "d_nettest.h"
 #include "m_cheat.h"
 #include "m_joy.h"
 #include "v_draw.h"
 #include "po_man.h"
 #include "p_local.h"
+#include "p_acs.h"
 #include "autosegs.h"
 #include "fragglescript/t_fs.h"
 #include "g_levellocals.h"
@@ -122,6 +124,7 @@
 #include "screenjob.h"
 #include "startscreen.h"
 #include "shiftstate.h"
+#include "r_renderbench.h"
 
 #ifdef __unix__
 #include "i_system.h"  // for SHARE_DIR
@@ -1224,9 +1227,17 @@ void D_DoomLoop ()
 			{
 				TryRunTics (); // will run at least one tic
 			}
+			if (G_DemoSeekPending())
+			{
+				G_RunDemoSeek();
+			}
 			// Update display, next frame, with current state.
 			I_StartTic ();
 			D_Display ();
+			if (gamestate == GS_LEVEL && gameaction == ga_nothing && R_RenderBenchPending())
+			{
+				R_RunRenderBench();
+			}
 			S_UpdateMusic();
 			if (wantToRestart)
 			{
@@ -2135,6 +2146,15 @@ static void CheckCmdLine()
 		}
 	}
 
+	// -renderbench <map> <camerapath>: render a camera path offscreen and exit.
+	p = Args->CheckParm("-renderbench");
+	if (p && p < Args->NumArgs() - 2)
+	{
+		startmap = Args->GetArg(p + 1);
+		autostart = true;
+		R_InitRenderBench(Args->GetArg(p + 2));
+	}
+
 	if (devparm)
 	{
 		Printf ("%s", GStrings("D_DEVSTR"));
@@ -3442,6 +3462,10 @@ static int D_InitGame(const FIWADInfo* iwad_info, TArray<FString>& allwads, TArr
 			}
 			else
 			{
+				// Unattended netgame tests run without drawing anything.
+				nodrawers = !!Args->CheckParm("-nodraw");
+				D_InitNetTest();
+
 				if (gameaction != ga_loadgame && gameaction != ga_loadgamehidecon)
 				{
 					if (autostart || netgame)
@@ -3782,6 +3806,7 @@ void D_Cleanup()
 	}
 	PClassActor::AllActorClasses.Clear();
 	ScriptUtil::Clear();
+	P_ClearACSCompiledFunctions();
 	PClass::StaticShutdown();
 	
 	GC::FullGC();					// perform one final garbage collection after shutdown
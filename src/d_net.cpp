@@ -162,6 +162,7 @@ CUSTOM_CVAR(Int, net_extratic, 0, CVAR_SERVERINFO | CVAR_NOSAVE)
 
 #ifdef _DEBUG
 CVAR(Int, net_fakelatency, 0, 0);
+CVARD(Int, net_fakeloss, 0, 0, "Percentage of outgoing game packets to drop for testing")
 
 struct PacketStore
 {
@@ -510,6 +511,13 @@ void HSendPacket (int node, int len)
 	}
 #endif
 
+#ifdef _DEBUG
+	if (net_fakeloss > 0 && !(netbuffer[0] & (NCMD_SETUP | NCMD_EXIT)) && rand() % 100 < net_fakeloss)
+	{
+		return;
+	}
+#endif
+
 	doomcom.command = CMD_SEND;
 	doomcom.remotenode = node;
 	doomcom.datalength = len;
@@ -0,0 +1,220 @@
+/*
+** d_nettest.cpp
+** Scripted input and statistics for automated netgame tests
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 agent
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** -ticinput <file> replaces the local player's input with a script. Every
+** line has the form
+**
+**   <tic> <buttons> <forwardmove> <sidemove> <yaw> <pitch> <upmove>
+**
+** and is used from that tic on until the next line. A line 'quit <tic>'
+** exits the game once that tic has been played. Lines starting with #
+** are ignored.
+**
+** -netstats <file> writes the game speed and how far the local input runs
+** ahead of the game once per second, and a summary at the end.
+**
+*/
+
+#include <memory>
+#include <algorithm>
+#include "d_nettest.h"
+#include "d_net.h"
+#include "d_protocol.h"
+#include "doomstat.h"
+#include "m_argv.h"
+#include "files.h"
+#include "printf.h"
+#include "i_time.h"
+#include "engineerrors.h"
+
+struct FScriptedCmd
+{
+	int tic;
+	usercmd_t ucmd;
+};
+
+static TArray<FScriptedCmd> ScriptedCmds;
+static int QuitTic = -1;
+
+static std::unique_ptr<FileWriter> NetStats;
+static uint64_t StatsStartTime, StatsIntervalTime;
+static int StatsStartTic = -1, StatsIntervalTic;
+static int64_t LagSum, TotalLagSum;
+static int LagCount, TotalLagCount, MaxLag, TotalMaxLag;
+
+//==========================================================================
+//
+// WriteSummary
+//
+//==========================================================================
+
+static void WriteSummary()
+{
+	if (NetStats == nullptr || StatsStartTic < 0) return;
+
+	double seconds = (I_msTime() - StatsStartTime) * 0.001;
+	NetStats->Printf("total tics %d seconds %.2f tps %.2f lag %.2f maxlag %d\n", gametic - StatsStartTic, seconds,
+		seconds > 0 ? (gametic - StatsStartTic) / seconds : 0., TotalLagCount ? double(TotalLagSum) / TotalLagCount : 0., TotalMaxLag);
+	NetStats.reset();
+}
+
+//==========================================================================
+//
+// D_InitNetTest
+//
+//==========================================================================
+
+void D_InitNetTest()
+{
+	const char *v = Args->CheckValue("-ticinput");
+	if (v != nullptr)
+	{
+		FileReader fr;
+		if (!fr.OpenFile(v))
+		{
+			I_FatalError("Cannot open tic input %s", v);
+		}
+		auto data = fr.Read();
+		FString text((const char *)data.Data(), data.Size());
+		for (auto &line : text.Split("\n", FString::TOK_SKIPEMPTY))
+		{
+			line.StripLeftRight();
+			if (line.IsEmpty() || line[0] == '#') continue;
+
+			FScriptedCmd cmd = {};
+			int buttons, forward, side, yaw, pitch, up;
+			if (sscanf(line.GetChars(), "quit %d", &QuitTic) == 1) continue;
+			if (sscanf(line.GetChars(), "%d %i %d %d %d %d %d", &cmd.tic, &buttons, &forward, &side, &yaw, &pitch, &up) != 7)
+			{
+				I_FatalError("Bad line in tic input %s: %s", v, line.GetChars());
+			}
+			cmd.ucmd.buttons = buttons;
+			cmd.ucmd.forwardmove = forward;
+			cmd.ucmd.sidemove = side;
+			cmd.ucmd.yaw = yaw;
+			cmd.ucmd.pitch = pitch;
+			cmd.ucmd.upmove = up;
+			ScriptedCmds.Push(cmd);
+		}
+		std::stable_sort(ScriptedCmds.begin(), ScriptedCmds.end(), [](const FScriptedCmd &a, const FScriptedCmd &b) { return a.tic < b.tic; });
+	}
+
+	v = Args->CheckValue("-netstats");
+	if (v != nullptr)
+	{
+		NetStats.reset(FileWriter::Open(v));
+		if (NetStats == nullptr)
+		{
+			Printf("Could not open net stats file %s\n", v);
+		}
+		else
+		{
+			atexit(WriteSummary);
+		}
+	}
+}
+
+//==========================================================================
+//
+// D_GetScriptedCmd
+//
+// Called by G_BuildTiccmd. Returns false if there is no input script.
+//
+//==========================================================================
+
+bool D_GetScriptedCmd(usercmd_t *ucmd, int tic)
+{
+	if (ScriptedCmds.Size() == 0) return false;
+
+	// Binary search for the last line that starts at or before this tic.
+	unsigned lo = 0, hi = ScriptedCmds.Size();
+	while (lo < hi)
+	{
+		unsigned mid = (lo + hi) / 2;
+		if (ScriptedCmds[mid].tic <= tic) lo = mid + 1;
+		else hi = mid;
+	}
+	if (lo > 0)
+	{
+		*ucmd = ScriptedCmds[lo - 1].ucmd;
+	}
+	else
+	{
+		*ucmd = {};
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// D_NetTestTicker
+//
+// Called by G_Ticker after every played tic.
+//
+//==========================================================================
+
+void D_NetTestTicker()
+{
+	if (NetStats != nullptr)
+	{
+		uint64_t now = I_msTime();
+		if (StatsStartTic < 0)
+		{
+			StatsStartTic = StatsIntervalTic = gametic;
+			StatsStartTime = StatsIntervalTime = now;
+		}
+
+		// How many tics of local input are waiting for the game to catch up.
+		int lag = (maketic - gametic) / ticdup;
+		LagSum += lag;
+		TotalLagSum += lag;
+		LagCount++;
+		TotalLagCount++;
+		MaxLag = max(MaxLag, lag);
+		TotalMaxLag = max(TotalMaxLag, lag);
+
+		if (gametic - StatsIntervalTic >= TICRATE)
+		{
+			double seconds = (now - StatsIntervalTime) * 0.001;
+			NetStats->Printf("tic %d tps %.2f lag %.2f maxlag %d\n", gametic, seconds > 0 ? (gametic - StatsIntervalTic) / seconds : 0.,
+				double(LagSum) / LagCount, MaxLag);
+			StatsIntervalTic = gametic;
+			StatsIntervalTime = now;
+			LagSum = LagCount = MaxLag = 0;
+		}
+	}
+
+	if (QuitTic >= 0 && gametic >= QuitTic)
+	{
+		throw CExitEvent(0);
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+struct usercmd_t;
+
+// Support for scripted, unattended netgames. See d_nettest.cpp.
+void D_InitNetTest();
+bool D_GetScriptedCmd(usercmd_t *ucmd, int tic);
+void D_NetTestTicker();
@@ -0,0 +1,222 @@
+/*
+** d_synclog.cpp
+** Per-tic hashes of the playsim state for tracking down desyncs
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 agent
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** When synclog is set to a file name every tic writes a line with hashes
+** of the players, actors, sectors and RNGs of all active levels. With
+** synclog_detail the individual actors (and RNGs and sectors) are listed
+** as well so that tools/synccheck/syncdiff.py can tell which one diverged
+** first when comparing the logs of two machines or two demo playbacks.
+**
+*/
+
+#include <zlib.h>
+#include <memory>
+#include "d_synclog.h"
+#include "c_cvars.h"
+#include "doomstat.h"
+#include "d_player.h"
+#include "g_levellocals.h"
+#include "m_random.h"
+#include "files.h"
+#include "printf.h"
+
+static std::unique_ptr<FileWriter> SyncLog;
+
+CUSTOM_CVARD(String, synclog, "", CVAR_NOINITCALL, "Writes per-tic hashes of the game state to this file to find desyncs")
+{
+	SyncLog.reset();
+	if (**self != 0)
+	{
+		SyncLog.reset(FileWriter::Open(self));
+		if (SyncLog == nullptr)
+		{
+			Printf("Could not open sync log %s\n", *self);
+		}
+	}
+}
+
+CVARD(Int, synclog_detail, 1, 0, "Sync log detail: 0 = hashes only, 1 = list actors, 2 = list actors, sectors and RNGs")
+
+//==========================================================================
+//
+// Every actor or sector gets hashed on its own and the subsystem hash is
+// built from those, so the listed values can be compared directly.
+//
+//==========================================================================
+
+template<class T> static uint32_t HashData(uint32_t hash, const T &data)
+{
+	return crc32(hash, (const Bytef *)&data, sizeof(data));
+}
+
+static uint32_t HashActor(AActor *actor)
+{
+	struct
+	{
+		double pos[3];
+		double vel[3];
+		double angles[2];
+		double floorz, ceilingz;
+		int32_t health, tics, flags, flags2, flags3, special1, special2;
+		int32_t reactiontime, threshold, movecount, movedir;
+		int32_t type, sprite, frame;
+	} data;
+
+	memset(&data, 0, sizeof(data));
+	data.pos[0] = actor->X();
+	data.pos[1] = actor->Y();
+	data.pos[2] = actor->Z();
+	data.vel[0] = actor->Vel.X;
+	data.vel[1] = actor->Vel.Y;
+	data.vel[2] = actor->Vel.Z;
+	data.angles[0] = actor->Angles.Yaw.Degrees;
+	data.angles[1] = actor->Angles.Pitch.Degrees;
+	data.floorz = actor->floorz;
+	data.ceilingz = actor->ceilingz;
+	data.health = actor->health;
+	data.tics = actor->tics;
+	data.flags = actor->flags;
+	data.flags2 = actor->flags2;
+	data.flags3 = actor->flags3;
+	data.special1 = actor->special1;
+	data.special2 = actor->special2;
+	data.reactiontime = actor->reactiontime;
+	data.threshold = actor->threshold;
+	data.movecount = actor->movecount;
+	data.movedir = actor->movedir;
+	data.type = actor->GetClass()->TypeName.GetIndex();
+	data.sprite = actor->state != nullptr ? actor->state->sprite : -1;
+	data.frame = actor->state != nullptr ? actor->state->Frame : -1;
+	return HashData(0, data);
+}
+
+static uint32_t HashSector(sector_t *sec)
+{
+	struct
+	{
+		double floord, ceilingd;
+		int32_t lightlevel, special, flags, damageamount;
+	} data;
+
+	memset(&data, 0, sizeof(data));
+	data.floord = sec->floorplane.fD();
+	data.ceilingd = sec->ceilingplane.fD();
+	data.lightlevel = sec->lightlevel;
+	data.special = sec->special;
+	data.flags = sec->Flags;
+	data.damageamount = sec->damageamount;
+	return HashData(0, data);
+}
+
+static uint32_t HashPlayer(player_t *player)
+{
+	struct
+	{
+		double viewz;
+		int32_t health, buttons, forwardmove, sidemove, yaw, pitch;
+		uint32_t mo;
+	} data;
+
+	memset(&data, 0, sizeof(data));
+	data.viewz = player->viewz;
+	data.health = player->health;
+	data.buttons = player->cmd.ucmd.buttons;
+	data.forwardmove = player->cmd.ucmd.forwardmove;
+	data.sidemove = player->cmd.ucmd.sidemove;
+	data.yaw = player->cmd.ucmd.yaw;
+	data.pitch = player->cmd.ucmd.pitch;
+	data.mo = player->mo != nullptr ? HashActor(player->mo) : 0;
+	return HashData(0, data);
+}
+
+//==========================================================================
+//
+// D_WriteSyncLog
+//
+// Called by G_Ticker after the playsim ran for this tic.
+//
+//==========================================================================
+
+void D_WriteSyncLog()
+{
+	if (SyncLog == nullptr) return;
+
+	int detail = synclog_detail;
+	uint32_t playerhash = 0;
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (playeringame[i]) playerhash = HashData(playerhash, HashPlayer(&players[i]));
+	}
+
+	TArray<uint32_t> seeds;
+	FRandom::StaticListSeeds(seeds);
+	uint32_t rnghash = crc32(0, (const Bytef *)seeds.Data(), seeds.Size() * sizeof(uint32_t));
+
+	SyncLog->Printf("tic %d players %08x rng %08x\n", gametic, playerhash, rnghash);
+	if (detail >= 2)
+	{
+		for (unsigned i = 0; i < seeds.Size(); i += 2)
+		{
+			SyncLog->Printf("r %08x %08x\n", seeds[i], seeds[i + 1]);
+		}
+	}
+
+	for (auto Level : AllLevels())
+	{
+		TArray<uint32_t> actorhashes;
+		uint32_t actorhash = 0;
+		auto it = Level->GetThinkerIterator<AActor>();
+		AActor *actor;
+		while ((actor = it.Next()) != nullptr)
+		{
+			actorhashes.Push(HashActor(actor));
+			actorhash = HashData(actorhash, actorhashes.Last());
+			if (detail >= 1)
+			{
+				SyncLog->Printf("a %u %s %.3f %.3f %.3f %d %08x\n", actorhashes.Size() - 1, actor->GetClass()->TypeName.GetChars(),
+					actor->X(), actor->Y(), actor->Z(), actor->health, actorhashes.Last());
+			}
+		}
+
+		uint32_t sectorhash = 0;
+		for (auto &sec : Level->sectors)
+		{
+			uint32_t hash = HashSector(&sec);
+			sectorhash = HashData(sectorhash, hash);
+			if (detail >= 2)
+			{
+				SyncLog->Printf("s %d %08x\n", sec.Index(), hash);
+			}
+		}
+		SyncLog->Printf("level %s actors %08x sectors %08x count %u\n", Level->MapName.GetChars(), actorhash, sectorhash, actorhashes.Size());
+	}
+}
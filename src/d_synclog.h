@@ -0,0 +1,4 @@
+#pragma once
+
+// Writes the per-tic state hashes if the synclog CVAR is set.
+void D_WriteSyncLog();
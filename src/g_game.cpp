@@ -60,6 +60,8 @@
 #include "a_keys.h"
 #include "cmdlib.h"
 #include "d_net.h"
+#include "d_synclog.h"
+#include "d_nettest.h"
 #include "d_event.h"
 #include "p_acs.h"
 #include "p_effect.h"
@@ -110,6 +112,9 @@ void	G_DoQuickSave ();
 
 void STAT_Serialize(FSerializer &file);
 bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content);
+bool WriteZip(FileWriter *f, TArray<FString> &filenames, TArray<FCompressedBuffer> &content);
+static void G_CaptureDemoKeyframe ();
+static void G_ResetDemoKeyframes ();
 
 FIntCVar gameskill ("skill", 2, CVAR_SERVERINFO|CVAR_LATCH);
 CVAR(Bool, save_formatted, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use formatted JSON for saves (more readable but a larger files and a bit slower.
@@ -174,6 +179,7 @@ FString			demoname;
 bool 			demorecording;
 bool 			demoplayback;
 bool			demonew;				// [RH] Only used around G_InitNew for demos
+static int		DemoTic;				// tics played since the demo started
 int				demover;
 uint8_t*			demobuffer;
 uint8_t*			demo_p;
@@ -591,6 +597,10 @@ void G_BuildTiccmd (ticcmd_t *cmd)
 
 	cmd->consistancy = consistancy[consoleplayer][(maketic/ticdup)%BACKUPTICS];
 
+	// Unattended netgame tests take their input from a script.
+	if (D_GetScriptedCmd (&cmd->ucmd, maketic/ticdup))
+		return;
+
 	strafe = buttonMap.ButtonDown(Button_Strafe);
 	speed = buttonMap.ButtonDown(Button_Speed) ^ (int)cl_run;
 
@@ -1243,6 +1253,11 @@ void G_Ticker ()
 		C_AdjustBottom ();
 	}
 
+	if (demoplayback)
+	{
+		G_CaptureDemoKeyframe ();
+	}
+
 	// get commands, check consistancy, and build new consistancy check
 	int buf = (gametic/ticdup)%BACKUPTICS;
 
@@ -1318,6 +1333,8 @@ void G_Ticker ()
 	{
 	case GS_LEVEL:
 		P_Ticker ();
+		D_WriteSyncLog ();
+		D_NetTestTicker ();
 		primaryLevel->automap->Ticker ();
 		break;
 
@@ -1352,6 +1369,11 @@ void G_Ticker ()
 
 	// [MK] Additional ticker for UI events right after all others
 	primaryLevel->localEventManager->PostUiTick();
+
+	if (demoplayback)
+	{
+		DemoTic++;
+	}
 }
 
 
@@ -1987,6 +2009,88 @@ void C_SerializeCVars(FSerializer& arc, const char* label, uint32_t filter)
 }
 
 
+//==========================================================================
+//
+// LoadSaveGlobals
+//
+// Restores the game from the globals and level snapshots of a savegame
+// that has already been validated. Demo keyframes use this as well.
+//
+//==========================================================================
+
+static bool LoadSaveGlobals (std::unique_ptr<FResourceFile> &resfile, const FString &map)
+{
+	FSerializer arc;
+	auto info = resfile->FindLump("globals.json");
+	if (info == nullptr)
+	{
+		LoadGameError("TXT_NOGLOBALSJSON");
+		return false;
+	}
+
+	void *data = info->Lock();
+	if (!arc.OpenReader((const char *)data, info->LumpSize))
+	{
+		LoadGameError("TXT_SGINFOERR");
+		return false;
+	}
+
+
+	// Read intermission data for hubs
+	G_SerializeHub(arc);
+
+	primaryLevel->BotInfo.RemoveAllBots(primaryLevel, true);
+
+	savegamerestore = true;		// Use the player actors in the savegame
+
+	FString cvar;
+	arc("importantcvars", cvar);
+	if (!cvar.IsEmpty())
+	{
+		uint8_t *vars_p = (uint8_t *)cvar.GetChars();
+		C_ReadCVars(&vars_p);
+	}
+	else
+	{
+		C_SerializeCVars(arc, "servercvars", CVAR_SERVERINFO);
+	}
+
+	uint32_t time[2] = { 1,0 };
+
+	arc("ticrate", time[0])
+		("leveltime", time[1])
+		("globalfreeze", globalfreeze);
+	// dearchive all the modifications
+	level.time = Scale(time[1], TICRATE, time[0]);
+
+	G_ReadSnapshots(resfile.get());
+	resfile.reset(nullptr);	// we no longer need the resource file below this point
+	G_ReadVisited(arc);
+
+	// load a base level
+	bool demoplaybacksave = demoplayback;
+	G_InitNew(map, false);
+	demoplayback = demoplaybacksave;
+	savegamerestore = false;
+
+	STAT_Serialize(arc);
+	FRandom::StaticReadRNGState(arc);
+	P_ReadACSDefereds(arc);
+	P_ReadACSVars(arc);
+
+	NextSkill = -1;
+	arc("nextskill", NextSkill);
+
+	if (level.info != nullptr)
+		level.info->Snapshot.Clean();
+
+	// At this point, the GC threshold is likely a lot higher than the
+	// amount of memory in use, so bring it down now by starting a
+	// collection.
+	GC::StartCollection();
+	return true;
+}
+
 void G_DoLoadGame ()
 {
 	bool hidecon;
@@ -2082,75 +2186,10 @@ void G_DoLoadGame ()
 	// we are done with info.json.
 	arc.Close();
 
-	info = resfile->FindLump("globals.json");
-	if (info == nullptr)
-	{
-		LoadGameError("TXT_NOGLOBALSJSON");
-		return;
-	}
-
-	data = info->Lock();
-	if (!arc.OpenReader((const char *)data, info->LumpSize))
-	{
-		LoadGameError("TXT_SGINFOERR");
-		return;
-	}
-
-
-	// Read intermission data for hubs
-	G_SerializeHub(arc);
-
-	primaryLevel->BotInfo.RemoveAllBots(primaryLevel, true);
-
-	savegamerestore = true;		// Use the player actors in the savegame
-
-	FString cvar;
-	arc("importantcvars", cvar);
-	if (!cvar.IsEmpty())
+	if (LoadSaveGlobals(resfile, map))
 	{
-		uint8_t *vars_p = (uint8_t *)cvar.GetChars();
-		C_ReadCVars(&vars_p);
-	}
-	else
-	{
-		C_SerializeCVars(arc, "servercvars", CVAR_SERVERINFO);
+		BackupSaveName = savename;
 	}
-
-	uint32_t time[2] = { 1,0 };
-
-	arc("ticrate", time[0])
-		("leveltime", time[1])
-		("globalfreeze", globalfreeze);
-	// dearchive all the modifications
-	level.time = Scale(time[1], TICRATE, time[0]);
-
-	G_ReadSnapshots(resfile.get());
-	resfile.reset(nullptr);	// we no longer need the resource file below this point
-	G_ReadVisited(arc);
-
-	// load a base level
-	bool demoplaybacksave = demoplayback;
-	G_InitNew(map, false);
-	demoplayback = demoplaybacksave;
-	savegamerestore = false;
-
-	STAT_Serialize(arc);
-	FRandom::StaticReadRNGState(arc);
-	P_ReadACSDefereds(arc);
-	P_ReadACSVars(arc);
-
-	NextSkill = -1;
-	arc("nextskill", NextSkill);
-
-	if (level.info != nullptr)
-		level.info->Snapshot.Clean();
-
-	BackupSaveName = savename;
-
-	// At this point, the GC threshold is likely a lot higher than the
-	// amount of memory in use, so bring it down now by starting a
-	// collection.
-	GC::StartCollection();
 }
 
 
@@ -2349,6 +2388,40 @@ static void PutSavePic (FileWriter *file, int width, int height)
 	}
 }
 
+//==========================================================================
+//
+// PutSaveGlobals
+//
+// Everything besides the level snapshots that is needed to restore
+// the game. Demo keyframes use this as well.
+//
+//==========================================================================
+
+static void PutSaveGlobals (FSerializer &arc)
+{
+	// Intermission stats for hubs
+	G_SerializeHub(arc);
+	C_SerializeCVars(arc, "servercvars", CVAR_SERVERINFO);
+
+	if (level.time != 0 || level.maptime != 0)
+	{
+		int tic = TICRATE;
+		arc("ticrate", tic);
+		arc("leveltime", level.time);
+	}
+
+	STAT_Serialize(arc);
+	FRandom::StaticWriteRNGState(arc);
+	P_WriteACSDefereds(arc);
+	P_WriteACSVars(arc);
+	G_WriteVisited(arc);
+
+	if (NextSkill != -1)
+	{
+		arc("nextskill", NextSkill);
+	}
+}
+
 void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, const char *description)
 {
 	TArray<FCompressedBuffer> savegame_content;
@@ -2423,28 +2496,7 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 	PutSaveWads (savegameinfo);
 	PutSaveComment (savegameinfo);
 
-	// Intermission stats for hubs
-	G_SerializeHub(savegameglobals);
-	C_SerializeCVars(savegameglobals, "servercvars", CVAR_SERVERINFO);
-
-	if (level.time != 0 || level.maptime != 0)
-	{
-		int tic = TICRATE;
-		savegameglobals("ticrate", tic);
-		savegameglobals("leveltime", level.time);
-	}
-
-	STAT_Serialize(savegameglobals);
-	FRandom::StaticWriteRNGState(savegameglobals);
-	P_WriteACSDefereds(savegameglobals);
-	P_WriteACSVars(savegameglobals);
-	G_WriteVisited(savegameglobals);
-
-
-	if (NextSkill != -1)
-	{
-		savegameglobals("nextskill", NextSkill);
-	}
+	PutSaveGlobals (savegameglobals);
 
 	auto picdata = savepic.GetBuffer();
 	FCompressedBuffer bufpng = { picdata->Size(), picdata->Size(), METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->Size())), (char*)&(*picdata)[0] };
@@ -2969,6 +3021,7 @@ void G_DoPlayDemo (void)
 		usergame = false;
 		demoplayback = true;
 		playedtitlemusic = false;
+		G_ResetDemoKeyframes ();
 	}
 }
 
@@ -2986,6 +3039,270 @@ void G_TimeDemo (const char* name)
 	gameaction = (gameaction == ga_loadgame) ? ga_loadgameplaydemo : ga_playdemo;
 }
 
+//==========================================================================
+//
+// Demo keyframes
+//
+// While a demo plays, the playsim is stored in memory every
+// demo_keyframeinterval seconds in the same form as a savegame, along
+// with the read position in the demo. Seeking restores the closest
+// keyframe before the target and then runs the remaining tics without
+// drawing anything. Once the keyframes use more than demo_keyframememory
+// megabytes, older ones get thinned out.
+//
+//==========================================================================
+
+CVARD(Int, demo_keyframeinterval, 30, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "seconds between the keyframes used for seeking backwards in demos, 0 disables them")
+CVARD(Int, demo_keyframememory, 64, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "maximum memory in megabytes used by demo keyframes")
+
+struct FDemoKeyframe
+{
+	int Tic;
+	ptrdiff_t DemoPos;
+	bool InGame[MAXPLAYERS];
+	ticcmd_t Cmds[MAXPLAYERS];
+	FString MapName;
+	TArray<uint8_t> Data;		// the playsim as a savegame zip
+};
+
+static TArray<FDemoKeyframe> DemoKeyframes;
+static int DemoSeekTarget = -1;
+
+static void G_ResetDemoKeyframes ()
+{
+	DemoKeyframes.Clear();
+	DemoTic = 0;
+	DemoSeekTarget = -1;
+}
+
+//==========================================================================
+//
+// G_ThinDemoKeyframes
+//
+// Removes keyframes until they fit into demo_keyframememory again. The
+// one that leaves the smallest gap between its neighbours goes first, so
+// the remaining ones stay spread over the whole demo. The first and the
+// newest keyframe are kept as long as possible.
+//
+//==========================================================================
+
+static void G_ThinDemoKeyframes ()
+{
+	size_t limit = size_t(max(0, *demo_keyframememory)) << 20;
+	size_t total = 0;
+	for (auto &kf : DemoKeyframes)
+	{
+		total += kf.Data.Size();
+	}
+	while (total > limit && DemoKeyframes.Size() > 0)
+	{
+		unsigned drop = 0;
+		if (DemoKeyframes.Size() > 2)
+		{
+			int bestgap = INT_MAX;
+			for (unsigned i = 1; i < DemoKeyframes.Size() - 1; i++)
+			{
+				int gap = DemoKeyframes[i + 1].Tic - DemoKeyframes[i - 1].Tic;
+				if (gap < bestgap)
+				{
+					bestgap = gap;
+					drop = i;
+				}
+			}
+		}
+		total -= DemoKeyframes[drop].Data.Size();
+		DemoKeyframes.Delete(drop);
+	}
+}
+
+//==========================================================================
+//
+// G_CaptureDemoKeyframe
+//
+// Called by G_Ticker at the same point at which savegames get written.
+//
+//==========================================================================
+
+static void G_CaptureDemoKeyframe ()
+{
+	// Timedemos never seek, so don't let snapshots distort the benchmark.
+	if (timingdemo || gamestate != GS_LEVEL || gameaction != ga_nothing || demo_keyframeinterval <= 0 ||
+		DemoTic % (demo_keyframeinterval * TICRATE) != 0)
+	{
+		return;
+	}
+	if (DemoKeyframes.Size() > 0 && DemoKeyframes.Last().Tic >= DemoTic)
+	{
+		return;	// already have this one from before seeking back
+	}
+
+	try
+	{
+		level.SnapshotLevel();
+	}
+	catch (CRecoverableError &err)
+	{
+		level.info->Snapshot.Clean();
+		Printf("Demo keyframe failed: %s\n", err.GetMessage());
+		return;
+	}
+
+	TArray<FCompressedBuffer> content;
+	TArray<FString> filenames;
+	FSerializer globals;
+
+	globals.OpenWriter(false);
+	PutSaveGlobals(globals);
+	content.Push(globals.GetCompressedOutput());
+	filenames.Push("globals.json");
+	G_WriteSnapshots(filenames, content);
+
+	BufferWriter zip;
+	bool succeeded = WriteZip(&zip, filenames, content);
+	content[0].Clean();
+	level.info->Snapshot.Clean();
+	if (!succeeded)
+	{
+		return;
+	}
+
+	auto &kf = DemoKeyframes[DemoKeyframes.Reserve(1)];
+	kf.Tic = DemoTic;
+	kf.DemoPos = demo_p - demobuffer;
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		kf.InGame[i] = playeringame[i];
+		kf.Cmds[i] = players[i].cmd;
+	}
+	kf.MapName = primaryLevel->MapName;
+	kf.Data = zip.TakeBuffer();
+	G_ThinDemoKeyframes ();
+}
+
+//==========================================================================
+//
+// G_RestoreDemoKeyframe
+//
+//==========================================================================
+
+static bool G_RestoreDemoKeyframe (FDemoKeyframe &kf)
+{
+	FileReader fr;
+	fr.OpenMemory(kf.Data.Data(), kf.Data.Size());
+	std::unique_ptr<FResourceFile> resfile(FResourceFile::OpenResourceFile("demokeyframe.zip", fr, true, true));
+	if (resfile == nullptr)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		playeringame[i] = kf.InGame[i];
+	}
+	if (!LoadSaveGlobals(resfile, kf.MapName))
+	{
+		return false;
+	}
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		players[i].cmd = kf.Cmds[i];
+	}
+	demo_p = demobuffer + kf.DemoPos;
+	DemoTic = kf.Tic;
+	usergame = false;
+	wipegamestate = gamestate;	// no screen wipe for seeking
+	return true;
+}
+
+//==========================================================================
+//
+// G_RunDemoSeek
+//
+// Called by the main loop between tics when a seek is pending.
+//
+//==========================================================================
+
+bool G_DemoSeekPending ()
+{
+	return DemoSeekTarget >= 0;
+}
+
+void G_RunDemoSeek ()
+{
+	int target = DemoSeekTarget;
+	DemoSeekTarget = -1;
+	if (!demoplayback || target == DemoTic)
+	{
+		return;
+	}
+
+	// Only restore a keyframe if it is closer to the target than the current tic.
+	FDemoKeyframe *kf = nullptr;
+	for (auto &k : DemoKeyframes)
+	{
+		if (k.Tic <= target) kf = &k;
+	}
+	if (kf != nullptr && (target < DemoTic || kf->Tic > DemoTic))
+	{
+		if (!G_RestoreDemoKeyframe(*kf))
+		{
+			Printf("Could not restore the demo keyframe at tic %d\n", kf->Tic);
+			return;
+		}
+	}
+	else if (target < DemoTic)
+	{
+		Printf("No demo keyframe before tic %d\n", target);
+		return;
+	}
+
+	// Simulate the rest. This may cross level exits, so let G_Ticker do
+	// everything except drawing, sound and networking.
+	uint64_t start = I_msTime();
+	int from = DemoTic;
+	while (demoplayback && DemoTic < target)
+	{
+		G_Ticker();
+		gametic++;
+		maketic++;
+		GC::CheckGC();
+		Net_NewMakeTic();
+	}
+	// Everything that started playing meanwhile would be heard at once.
+	S_StopAllChannels();
+	DPrintf(DMSG_NOTIFY, "Simulated %d demo tics in %d ms\n", DemoTic - from, int(I_msTime() - start));
+}
+
+static void G_SeekDemo (int tic)
+{
+	if (!demoplayback)
+	{
+		Printf("Not playing a demo\n");
+		return;
+	}
+	DemoSeekTarget = max(tic, 0);
+}
+
+CCMD (demoseek)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: demoseek <seconds>\nCurrently at %.1f seconds\n", double(DemoTic) / TICRATE);
+		return;
+	}
+	G_SeekDemo(int(atof(argv[1]) * TICRATE));
+}
+
+CCMD (demoskip)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: demoskip <seconds>\n");
+		return;
+	}
+	G_SeekDemo(DemoTic + int(atof(argv[1]) * TICRATE));
+}
+
 
 /*
 ===================
@@ -3015,6 +3332,7 @@ bool G_CheckDemoStatus (void)
 		C_RestoreCVars ();		// [RH] Restore cvars demo might have changed
 		M_Free (demobuffer);
 		demobuffer = NULL;
+		G_ResetDemoKeyframes ();
 
 		P_SetupWeapons_ntohton();
 		demoplayback = false;
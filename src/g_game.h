@@ -74,6 +74,8 @@ void G_BeginRecording (const char *startmap);
 void G_PlayDemo (char* name);
 void G_TimeDemo (const char* name);
 bool G_CheckDemoStatus (void);
+bool G_DemoSeekPending ();
+void G_RunDemoSeek ();
 
 void G_Ticker (void);
 bool G_Responder (event_t*	ev);
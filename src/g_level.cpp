@@ -1113,6 +1113,7 @@ void G_DoCompleted (void)
 		statusScreen = WI_Start (&staticWmInfo);
 	}
 	bool endgame = strncmp(nextlevel, "enDSeQ", 6) == 0;
+	if (!endgame) P_PreloadMapData(nextlevel);
 	intermissionScreen = primaryLevel->CreateIntermission();
 	auto nextinfo = !playinter || endgame? nullptr : FindLevelInfo(nextlevel, false);
 	RunIntermission(playinter? primaryLevel->info : nullptr, nextinfo, intermissionScreen, statusScreen, [=](bool)
@@ -2209,9 +2210,7 @@ size_t DSectorMarker::PropagateMark()
 	// If there are more items to mark, put ourself back into the gray list.
 	if (moretodo)
 	{
-		Black2Gray();
-		GCNext = GC::Gray;
-		GC::Gray = this;
+		GC::Regray(this);
 	}
 	return marked;
 }
@@ -52,6 +52,7 @@
 #include "d_player.h"
 #include "p_destructible.h"
 #include "r_data/r_sections.h"
+#include "r_data/r_pvs.h"
 #include "r_data/r_canvastexture.h"
 #include "r_data/r_interpolate.h"
 #include "doom_aabbtree.h"
@@ -474,6 +475,7 @@ public:
 	TArray<FSectorPortalGroup *> portalGroups;
 	TArray<FLinePortalSpan> linePortalSpans;
 	FSectionContainer sections;
+	FSubsectorPVS pvs;
 	FCanvasTextureInfo canvasTextureInfo;
 	EventManager *localEventManager = nullptr;
 	DoomLevelAABBTree* aabbTree = nullptr;
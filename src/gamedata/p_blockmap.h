@@ -25,7 +25,8 @@ struct FBlockNode
 // BLOCKMAP
 // Created from axis aligned bounding box
 // of the map, a rectangular array of
-// blocks of size 128x128.
+// blocks of size 128x128, or 64x64 if a
+// generated blockmap was asked to be finer.
 // Used to speed up collision detection
 // by spatial subdivision in 2D.
 //
@@ -45,17 +46,19 @@ struct FBlockmap
 	// against lines and things
 	enum
 	{
-		MAPBLOCKUNITS = 128
+		MAPBLOCKUNITS = 128,
+		FINEMAPBLOCKUNITS = 64
 	};
+	int					BlockSize = MAPBLOCKUNITS;
 
 	inline int GetBlockX(double xpos)
 	{
-		return int((xpos - bmaporgx) / MAPBLOCKUNITS);
+		return int((xpos - bmaporgx) / BlockSize);
 	}
 
 	inline int GetBlockY(double ypos)
 	{
-		return int((ypos - bmaporgy) / MAPBLOCKUNITS);
+		return int((ypos - bmaporgy) / BlockSize);
 	}
 
 	inline bool isValidBlock(int x, int y) const
@@ -26,6 +26,7 @@
 
 #include "basics.h"
 #include "zstring.h"
+#include "m_png.h"
 
 class FConfigFile;
 class FGameConfigFile;
@@ -38,6 +39,8 @@ void M_FindResponseFile (void);
 // [RH] M_ScreenShot now accepts a filename parameter.
 //		Pass a NULL to get the original behavior.
 void M_ScreenShot (const char *filename);
+void WritePNGfile (FileWriter *file, const uint8_t *buffer, const PalEntry *palette,
+				   ESSType color_type, int width, int height, int pitch, float gamma);
 
 void M_LoadDefaults ();
 
@@ -60,9 +60,16 @@
 #include "g_levellocals.h"
 #include "i_time.h"
 #include "maploader.h"
+#include "doom_aabbtree.h"
 
 EXTERN_CVAR(Bool, gl_cachenodes)
 EXTERN_CVAR(Float, gl_cachetime)
+EXTERN_CVAR(Bool, genfineblockmap)
+EXTERN_CVAR(Bool, r_pvs)
+EXTERN_CVAR(Int, r_pvs_maxbuild)
+EXTERN_CVAR(Int, r_pvs_maxbuildtime)
+
+CVARD(Int, gl_cacheleveldata, 50, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "Minimum time in ms for building a blockmap or AABB tree before it gets cached, -1 to disable")
 
 // fixed 32 bit gl_vert format v2.0+ (glBsp 1.91)
 struct mapglvertex_t
@@ -997,7 +1004,7 @@ bool MapLoader::CheckNodes(MapData * map, bool rebuilt, int buildtime)
 typedef TArray<uint8_t> MemFile;
 
 
-static FString CreateCacheName(MapData *map, bool create)
+static FString CreateCacheName(MapData *map, bool create, const char *ext = ".gzc")
 {
 	FString path = M_GetCachePath(create);
 	FString lumpname = fileSystem.GetFileFullPath(map->lumpnum);
@@ -1007,7 +1014,7 @@ static FString CreateCacheName(MapData *map, bool create)
 
 	lumpname.ReplaceChars('/', '%');
 	lumpname.ReplaceChars(':', '$');
-	path << '/' << lumpname.Right((ptrdiff_t)lumpname.Len() - separator - 1) << ".gzc";
+	path << '/' << lumpname.Right((ptrdiff_t)lumpname.Len() - separator - 1) << ext;
 	return path;
 }
 
@@ -1196,6 +1203,264 @@ bool MapLoader::CheckCachedNodes(MapData *map)
 	return true;
 }
 
+//==========================================================================
+//
+// Common code for the caches of derived level data.
+//
+// A cache file starts with a magic ID and the map's checksum, followed
+// by some header values that must match the current level and the size
+// of the zlib compressed data.
+//
+//==========================================================================
+
+static void WriteCacheFile(MapData *map, const char *ext, const char *magic, const uint32_t *header, int numheader, const MemFile &data)
+{
+	uLongf outlen = compressBound(data.Size());
+	const int offset = 4 + 16 + 4 * (numheader + 1);
+	TArray<Bytef> compressed(outlen + offset, true);
+	if (compress(compressed.Data() + offset, &outlen, data.Data(), data.Size()) != Z_OK) return;
+
+	memcpy(compressed.Data(), magic, 4);
+	map->GetChecksum(&compressed[4]);
+	for (int i = 0; i <= numheader; i++)
+	{
+		uint32_t value = LittleLong(i < numheader ? header[i] : data.Size());
+		memcpy(&compressed[20 + 4 * i], &value, 4);
+	}
+
+	FString path = CreateCacheName(map, true, ext);
+	FileWriter *fw = FileWriter::Open(path);
+
+	if (fw != nullptr)
+	{
+		const size_t length = outlen + offset;
+		if (fw->Write(compressed.Data(), length) != length)
+		{
+			Printf("Error saving cache file %s\n", path.GetChars());
+		}
+		delete fw;
+	}
+	else
+	{
+		Printf("Cannot open cache file %s for writing\n", path.GetChars());
+	}
+}
+
+static bool ReadCacheFile(MapData *map, const char *ext, const char *magic, const uint32_t *header, int numheader, MemFile &data)
+{
+	char id[4];
+	uint8_t md5[16];
+	uint8_t md5map[16];
+
+	FString path = CreateCacheName(map, false, ext);
+	FileReader fr;
+
+	if (!fr.OpenFile(path)) return false;
+
+	if (fr.Read(id, 4) != 4) return false;
+	if (memcmp(id, magic, 4))  return false;
+
+	if (fr.Read(md5, 16) != 16) return false;
+	map->GetChecksum(md5map);
+	if (memcmp(md5, md5map, 16)) return false;
+
+	for (int i = 0; i < numheader; i++)
+	{
+		uint32_t value;
+		if (fr.Read(&value, 4) != 4 || LittleLong(value) != header[i]) return false;
+	}
+	uint32_t size;
+	if (fr.Read(&size, 4) != 4) return false;
+
+	auto compressed = fr.Read();
+	size = LittleLong(size);
+	// Deflate cannot compress better than 1032:1, so anything larger comes from a damaged file.
+	if (size > uint64_t(compressed.Size()) * 1032) return false;
+	data.Resize(size);
+	uLongf outlen = data.Size();
+	return uncompress(data.Data(), &outlen, compressed.Data(), compressed.Size()) == Z_OK && outlen == data.Size();
+}
+
+//==========================================================================
+//
+// PVS caching
+//
+// The visibility data depends on the exact node set so the cache file
+// contains a hash of the subsector layout along with the map's checksum.
+//
+//==========================================================================
+
+static void CreateCachedPVS(FLevelLocals *Level, MapData *map)
+{
+	MemFile data;
+	Level->pvs.Serialize(data);
+
+	uint32_t header[2] = { Level->subsectors.Size(), FSubsectorPVS::LayoutHash(Level) };
+	WriteCacheFile(map, ".pvs", "PVS1", header, 2, data);
+}
+
+static bool CheckCachedPVS(FLevelLocals *Level, MapData *map)
+{
+	MemFile data;
+	uint32_t header[2] = { Level->subsectors.Size(), FSubsectorPVS::LayoutHash(Level) };
+	if (!ReadCacheFile(map, ".pvs", "PVS1", header, 2, data)) return false;
+
+	return Level->pvs.Deserialize(Level, data.Data(), data.Size());
+}
+
+//==========================================================================
+//
+// Blockmap caching
+//
+// Only used for generated blockmaps. They depend on all vertex positions
+// (for the map's extents) and the lines, which are hashed into the header.
+//
+//==========================================================================
+
+static uint32_t BlockmapLayoutHash(FLevelLocals *Level)
+{
+	uint32_t hash = crc32(0, nullptr, 0);
+	for (auto &vert : Level->vertexes)
+	{
+		int32_t data[2] = { LittleLong(int(vert.fX())), LittleLong(int(vert.fY())) };
+		hash = crc32(hash, (const Bytef *)data, sizeof(data));
+	}
+	for (auto &line : Level->lines)
+	{
+		uint32_t data[2] = { LittleLong(uint32_t(line.v1->Index())), LittleLong(uint32_t(line.v2->Index())) };
+		hash = crc32(hash, (const Bytef *)data, sizeof(data));
+	}
+	return hash;
+}
+
+void MapLoader::GenerateBlockMap(MapData *map)
+{
+	bool cache = Level->maptype != MAPTYPE_BUILD && gl_cachenodes && gl_cacheleveldata >= 0;
+	uint32_t header[4] = { Level->vertexes.Size(), Level->lines.Size(), BlockmapLayoutHash(Level), genfineblockmap };
+
+	if (cache)
+	{
+		MemFile data;
+		if (ReadCacheFile(map, ".bmc", "BMC1", header, 4, data) && data.Size() >= 24 && data.Size() % 4 == 0)
+		{
+			unsigned count = data.Size() / 4 - 1;
+			const uint32_t *values = (const uint32_t *)data.Data();
+			uint32_t blocksize = LittleLong(values[0]);
+			// Anything else can only come from a damaged file and would break the block coordinate math.
+			if (blocksize == 1u << BLOCKBITS || blocksize == 1u << FINEBLOCKBITS)
+			{
+				Level->blockmap.BlockSize = blocksize;
+				Level->blockmap.blockmaplump = new int[count];
+				for (unsigned i = 0; i < count; i++)
+				{
+					Level->blockmap.blockmaplump[i] = LittleLong(values[i + 1]);
+				}
+				if (Level->blockmap.VerifyBlockMap(count, Level->lines.Size()))
+				{
+					return;
+				}
+				delete[] Level->blockmap.blockmaplump;
+				Level->blockmap.blockmaplump = nullptr;
+			}
+		}
+	}
+
+	DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
+	uint64_t startTime = I_msTime();
+	unsigned count = CreateBlockMap();
+	uint64_t buildTime = I_msTime() - startTime;
+
+	if (cache && count > 0 && buildTime >= (unsigned)gl_cacheleveldata)
+	{
+		MemFile data;
+		data.Resize((count + 1) * 4);
+		uint32_t *values = (uint32_t *)data.Data();
+		values[0] = LittleLong(Level->blockmap.BlockSize);
+		for (unsigned i = 0; i < count; i++)
+		{
+			values[i + 1] = LittleLong(Level->blockmap.blockmaplump[i]);
+		}
+		WriteCacheFile(map, ".bmc", "BMC1", header, 4, data);
+	}
+}
+
+//==========================================================================
+//
+// AABB tree caching
+//
+//==========================================================================
+
+void MapLoader::LoadAABBTree(MapData *map)
+{
+	bool cache = Level->maptype != MAPTYPE_BUILD && gl_cachenodes && gl_cacheleveldata >= 0;
+	uint32_t header[2] = { Level->lines.Size(), DoomLevelAABBTree::LayoutHash(Level) };
+
+	if (cache)
+	{
+		MemFile data;
+		if (ReadCacheFile(map, ".aab", "AAB1", header, 2, data))
+		{
+			Level->aabbTree = DoomLevelAABBTree::Deserialize(Level, data.Data(), data.Size());
+			if (Level->aabbTree != nullptr) return;
+		}
+	}
+
+	uint64_t startTime = I_msTime();
+	auto tree = new DoomLevelAABBTree(Level);
+	Level->aabbTree = tree;
+
+	if (cache && I_msTime() - startTime >= (unsigned)gl_cacheleveldata)
+	{
+		MemFile data;
+		tree->Serialize(data);
+		WriteCacheFile(map, ".aab", "AAB1", header, 2, data);
+	}
+}
+
+//==========================================================================
+//
+// Loads the PVS from the cache or builds it if the map is small enough.
+// The build gives up after r_pvs_maxbuildtime milliseconds so that large
+// maps don't stall the load. Those can be processed offline with the
+// 'buildpvs' command.
+//
+//==========================================================================
+
+void MapLoader::LoadPVS(MapData *map)
+{
+	Level->pvs.Clear();
+	if (!r_pvs || Level->maptype == MAPTYPE_BUILD || Level->nodes.Size() == 0 || Level->linePortals.Size() > 0) return;
+
+	if (CheckCachedPVS(Level, map)) return;
+
+	if ((int)Level->subsectors.Size() <= r_pvs_maxbuild && Level->pvs.Build(Level, r_pvs_maxbuildtime) && gl_cachenodes)
+	{
+		CreateCachedPVS(Level, map);
+	}
+}
+
+CCMD(buildpvs)
+{
+	auto Level = primaryLevel;
+	if (gamestate != GS_LEVEL || Level->nodes.Size() == 0)
+	{
+		Printf("No level loaded\n");
+		return;
+	}
+	if (!Level->pvs.Build(Level))
+	{
+		Printf("Unable to build the PVS for %s\n", Level->MapName.GetChars());
+		return;
+	}
+	MapData *map = P_OpenMapData(Level->MapName, true);
+	if (map != nullptr)
+	{
+		CreateCachedPVS(Level, map);
+		delete map;
+	}
+	Printf("PVS for %s built\n", Level->MapName.GetChars());
+}
+
 UNSAFE_CCMD(clearnodecache)
 {
 	TArray<FFileList> list;
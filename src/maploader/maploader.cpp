@@ -92,6 +92,7 @@ enum
 
 CVAR (Bool, genblockmap, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, gennodes, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
+CVARD (Bool, genfineblockmap, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG, "Build the blockmap with 64 unit blocks on maps with many lines per block")
 
 inline bool P_LoadBuildMap(uint8_t *mapdata, size_t len, FMapThing **things, int *numthings)
 {
@@ -2235,65 +2236,47 @@ void MapLoader::LoadSideDefs2 (MapData *map, FMissingTextureTracker &missingtex)
 //
 //===========================================================================
 
-static unsigned int BlockHash (TArray<int> *block)
+static unsigned int BlockHash (const int *block, int count)
 {
 	int hash = 0;
-	int *ar = &(*block)[0];
-	for (size_t i = 0; i < block->Size(); ++i)
+	for (int i = 0; i < count; ++i)
 	{
-		hash = hash * 12235 + ar[i];
+		hash = hash * 12235 + block[i];
 	}
 	return hash & 0x7fffffff;
 }
 
-static bool BlockCompare (TArray<int> *block1, TArray<int> *block2)
+static bool BlockCompare (const int *block1, int count1, const int *block2, int count2)
 {
-	size_t size = block1->Size();
-
-	if (size != block2->Size())
-	{
-		return false;
-	}
-	if (size == 0)
-	{
-		return true;
-	}
-	int *ar1 = &(*block1)[0];
-	int *ar2 = &(*block2)[0];
-	for (size_t i = 0; i < size; ++i)
-	{
-		if (ar1[i] != ar2[i])
-		{
-			return false;
-		}
-	}
-	return true;
+	return count1 == count2 && (count1 == 0 || memcmp (block1, block2, count1 * sizeof(int)) == 0);
 }
 
-static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, int bmapwidth, int bmapheight)
+// The lines of block i are lines[offsets[i]] to lines[offsets[i+1]-1].
+static void CreatePackedBlockmap (TArray<int> &BlockMap, const int *lines, const int *offsets, int bmapwidth, int bmapheight)
 {
-	int buckets[4096];
 	int hashblock;
-	TArray<int> *block;
 	int zero = 0;
 	int terminator = -1;
-	int *array;
 	int i, hash;
-	int hashed = 0, nothashed = 0;
+	int numbuckets = 4096;
 
+	// Every distinct block is only stored once, so the bucket count does not affect the result.
+	while (numbuckets < bmapwidth * bmapheight) numbuckets <<= 1;
+	TArray<int> buckets(numbuckets, true);
 	TArray<int> hashes(bmapwidth * bmapheight, true);
 
 	memset (hashes.Data(), 0xff, sizeof(int)*bmapwidth*bmapheight);
-	memset (buckets, 0xff, sizeof(buckets));
+	memset (buckets.Data(), 0xff, sizeof(int)*numbuckets);
 
 	for (i = 0; i < bmapwidth * bmapheight; ++i)
 	{
-		block = &blocks[i];
-		hash = BlockHash (block) % 4096;
+		const int *block = lines + offsets[i];
+		int count = offsets[i + 1] - offsets[i];
+		hash = BlockHash (block, count) & (numbuckets - 1);
 		hashblock = buckets[hash];
 		while (hashblock != -1)
 		{
-			if (BlockCompare (block, &blocks[hashblock]))
+			if (BlockCompare (block, count, lines + offsets[hashblock], offsets[hashblock + 1] - offsets[hashblock]))
 			{
 				break;
 			}
@@ -2302,7 +2285,6 @@ static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, in
 		if (hashblock != -1)
 		{
 			BlockMap[4+i] = BlockMap[4+hashblock];
-			hashed++;
 		}
 		else
 		{
@@ -2310,36 +2292,165 @@ static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, in
 			buckets[hash] = i;
 			BlockMap[4+i] = BlockMap.Size ();
 			BlockMap.Push (zero);
-			array = &(*block)[0];
-			for (size_t j = 0; j < block->Size(); ++j)
+			unsigned start = BlockMap.Reserve (count);
+			if (count > 0) memcpy (&BlockMap[start], block, count * sizeof(int));
+			BlockMap.Push (terminator);
+		}
+	}
+}
+
+//===========================================================================
+//
+// Calls func for every block the line passes through, in the same order
+// the original list based builder added them.
+//
+//===========================================================================
+
+template<class Func>
+static void TraceBlockmapLine (int x1, int y1, int x2, int y2, int bmapwidth, int blockbits, Func func)
+{
+	const int blocksize = 1 << blockbits;
+	int dx = x2 - x1;
+	int dy = y2 - y1;
+	int bx = x1 >> blockbits;
+	int by = y1 >> blockbits;
+	int bx2 = x2 >> blockbits;
+	int by2 = y2 >> blockbits;
+
+	int block = bx + by * bmapwidth;
+	int endblock = bx2 + by2 * bmapwidth;
+
+	if (block == endblock)	// Single block
+	{
+		func (block);
+	}
+	else if (by == by2)		// Horizontal line
+	{
+		if (bx > bx2)
+		{
+			std::swap (block, endblock);
+		}
+		do
+		{
+			func (block);
+			block += 1;
+		} while (block <= endblock);
+	}
+	else if (bx == bx2)	// Vertical line
+	{
+		if (by > by2)
+		{
+			std::swap (block, endblock);
+		}
+		do
+		{
+			func (block);
+			block += bmapwidth;
+		} while (block <= endblock);
+	}
+	else				// Diagonal line
+	{
+		int xchange = (dx < 0) ? -1 : 1;
+		int ychange = (dy < 0) ? -1 : 1;
+		int ymove = ychange * bmapwidth;
+		int adx = abs (dx);
+		int ady = abs (dy);
+
+		if (adx == ady)		// 45 degrees
+		{
+			int xb = x1 & (blocksize-1);
+			int yb = y1 & (blocksize-1);
+			if (dx < 0)
 			{
-				BlockMap.Push (array[j]);
+				xb = blocksize-xb;
 			}
-			BlockMap.Push (terminator);
-			nothashed++;
+			if (dy < 0)
+			{
+				yb = blocksize-yb;
+			}
+			if (xb < yb)
+				adx--;
+		}
+		if (adx >= ady)		// X-major
+		{
+			int yadd = dy < 0 ? -1 : blocksize;
+			do
+			{
+				int stop = (Scale ((by << blockbits) + yadd - y1, dx, dy) + x1) >> blockbits;
+				while (bx != stop)
+				{
+					func (block);
+					block += xchange;
+					bx += xchange;
+				}
+				func (block);
+				block += ymove;
+				by += ychange;
+			} while (by != by2);
+			while (block != endblock)
+			{
+				func (block);
+				block += xchange;
+			}
+			func (block);
+		}
+		else					// Y-major
+		{
+			int xadd = dx < 0 ? -1 : blocksize;
+			do
+			{
+				int stop = (Scale ((bx << blockbits) + xadd - x1, dy, dx) + y1) >> blockbits;
+				while (by != stop)
+				{
+					func (block);
+					block += ymove;
+					by += ychange;
+				}
+				func (block);
+				block += xchange;
+				bx += xchange;
+			} while (bx != bx2);
+			while (block != endblock)
+			{
+				func (block);
+				block += ymove;
+			}
+			func (block);
 		}
 	}
 }
 
+//===========================================================================
+//
+// The blockmap is built in two passes over the lines. The first one counts
+// the lines per block, the second one writes them into one flat array at
+// offsets taken from the counts, so no per-block lists are needed.
+//
+// With genfineblockmap the block size is halved on maps whose non-empty
+// blocks contain many lines, which reduces the number of lines every
+// position check has to look at.
+//
+//===========================================================================
 
-void MapLoader::CreateBlockMap ()
+unsigned MapLoader::CreateBlockMap ()
 {
 	enum
 	{
-		BLOCKBITS = 7,
-		BLOCKSIZE = 128
+		FINEDENSITY = 8		// average lines per used block to switch to fine blocks
 	};
 
-	TArray<int> *block, *endblock;
-	TArray<TArray<int>> BlockLists;
+	TArray<int> Offsets;
+	TArray<int> Lines;
 	int adder;
 	int bmapwidth, bmapheight;
 	double dminx, dmaxx, dminy, dmaxy;
 	int minx, maxx, miny, maxy;
-	int line;
+	int blockbits = BLOCKBITS;
+	unsigned numlines = Level->lines.Size();
+	uint64_t startTime = I_msTime();
 
 	if (Level->vertexes.Size() == 0)
-		return;
+		return 0;
 
 	// Find map extents for the blockmap
 	dminx = dmaxx = Level->vertexes[0].fX();
@@ -2358,145 +2469,83 @@ void MapLoader::CreateBlockMap ()
 	maxx = int(dmaxx);
 	maxy = int(dmaxy);
 
-	bmapwidth =	 ((maxx - minx) >> BLOCKBITS) + 1;
-	bmapheight = ((maxy - miny) >> BLOCKBITS) + 1;
-
-	TArray<int> BlockMap (bmapwidth * bmapheight * 3 + 4);
-
-	adder = minx;			BlockMap.Push (adder);
-	adder = miny;			BlockMap.Push (adder);
-	adder = bmapwidth;		BlockMap.Push (adder);
-	adder = bmapheight;		BlockMap.Push (adder);
-
-	BlockLists.Resize(bmapwidth * bmapheight);
-
-	for (line = 0; line < (int)Level->lines.Size(); ++line)
+	// Line coordinates relative to the blockmap origin
+	TArray<int> coords(numlines * 4, true);
+	for (unsigned line = 0; line < numlines; ++line)
 	{
-		int x1 = int(Level->lines[line].v1->fX());
-		int y1 = int(Level->lines[line].v1->fY());
-		int x2 = int(Level->lines[line].v2->fX());
-		int y2 = int(Level->lines[line].v2->fY());
-		int dx = x2 - x1;
-		int dy = y2 - y1;
-		int bx = (x1 - minx) >> BLOCKBITS;
-		int by = (y1 - miny) >> BLOCKBITS;
-		int bx2 = (x2 - minx) >> BLOCKBITS;
-		int by2 = (y2 - miny) >> BLOCKBITS;
-
-		block = &BlockLists[bx + by * bmapwidth];
-		endblock = &BlockLists[bx2 + by2 * bmapwidth];
+		coords[line*4+0] = int(Level->lines[line].v1->fX()) - minx;
+		coords[line*4+1] = int(Level->lines[line].v1->fY()) - miny;
+		coords[line*4+2] = int(Level->lines[line].v2->fX()) - minx;
+		coords[line*4+3] = int(Level->lines[line].v2->fY()) - miny;
+	}
 
-		if (block == endblock)	// Single block
+	// Pass 1: Count the lines in every block.
+	auto countLines = [&]()
+	{
+		bmapwidth =	 ((maxx - minx) >> blockbits) + 1;
+		bmapheight = ((maxy - miny) >> blockbits) + 1;
+		Offsets.Resize(bmapwidth * bmapheight + 1);
+		memset (Offsets.Data(), 0, Offsets.Size() * sizeof(int));
+		for (unsigned line = 0; line < numlines; ++line)
 		{
-			block->Push (line);
+			const int *c = &coords[line*4];
+			TraceBlockmapLine (c[0], c[1], c[2], c[3], bmapwidth, blockbits, [&](int block) { Offsets[block]++; });
 		}
-		else if (by == by2)		// Horizontal line
+	};
+	countLines();
+
+	if (genfineblockmap)
+	{
+		int used = 0, entries = 0;
+		for (int i = 0; i < bmapwidth * bmapheight; i++)
 		{
-			if (bx > bx2)
-			{
-				std::swap (block, endblock);
-			}
-			do
-			{
-				block->Push (line);
-				block += 1;
-			} while (block <= endblock);
+			if (Offsets[i] > 0) used++;
+			entries += Offsets[i];
 		}
-		else if (bx == bx2)	// Vertical line
+		if (used > 0 && entries >= used * FINEDENSITY)
 		{
-			if (by > by2)
-			{
-				std::swap (block, endblock);
-			}
-			do
-			{
-				block->Push (line);
-				block += bmapwidth;
-			} while (block <= endblock);
-		}
-		else				// Diagonal line
-		{
-			int xchange = (dx < 0) ? -1 : 1;
-			int ychange = (dy < 0) ? -1 : 1;
-			int ymove = ychange * bmapwidth;
-			int adx = abs (dx);
-			int ady = abs (dy);
-
-			if (adx == ady)		// 45 degrees
-			{
-				int xb = (x1 - minx) & (BLOCKSIZE-1);
-				int yb = (y1 - miny) & (BLOCKSIZE-1);
-				if (dx < 0)
-				{
-					xb = BLOCKSIZE-xb;
-				}
-				if (dy < 0)
-				{
-					yb = BLOCKSIZE-yb;
-				}
-				if (xb < yb)
-					adx--;
-			}
-			if (adx >= ady)		// X-major
-			{
-				int yadd = dy < 0 ? -1 : BLOCKSIZE;
-				do
-				{
-					int stop = (Scale ((by << BLOCKBITS) + yadd - (y1 - miny), dx, dy) + (x1 - minx)) >> BLOCKBITS;
-					while (bx != stop)
-					{
-						block->Push (line);
-						block += xchange;
-						bx += xchange;
-					}
-					block->Push (line);
-					block += ymove;
-					by += ychange;
-				} while (by != by2);
-				while (block != endblock)
-				{
-					block->Push (line);
-					block += xchange;
-				}
-				block->Push (line);
-			}
-			else					// Y-major
-			{
-				int xadd = dx < 0 ? -1 : BLOCKSIZE;
-				do
-				{
-					int stop = (Scale ((bx << BLOCKBITS) + xadd - (x1 - minx), dy, dx) + (y1 - miny)) >> BLOCKBITS;
-					while (by != stop)
-					{
-						block->Push (line);
-						block += ymove;
-						by += ychange;
-					}
-					block->Push (line);
-					block += xchange;
-					bx += xchange;
-				} while (bx != bx2);
-				while (block != endblock)
-				{
-					block->Push (line);
-					block += ymove;
-				}
-				block->Push (line);
-			}
+			blockbits = FINEBLOCKBITS;
+			countLines();
 		}
 	}
 
-	BlockMap.Reserve (bmapwidth * bmapheight);
-	CreatePackedBlockmap (BlockMap, BlockLists.Data(), bmapwidth, bmapheight);
+	// Turn the counts into start offsets.
+	int total = 0;
+	for (unsigned i = 0; i < Offsets.Size(); i++)
+	{
+		int count = Offsets[i];
+		Offsets[i] = total;
+		total += count;
+	}
 
-	Level->blockmap.blockmaplump = new int[BlockMap.Size()];
-	for (unsigned int ii = 0; ii < BlockMap.Size(); ++ii)
+	// Pass 2: Fill in the lines. Lines are visited in order so every block stays sorted.
+	Lines.Resize(total);
+	TArray<int> fill(bmapwidth * bmapheight, true);
+	memcpy (fill.Data(), Offsets.Data(), fill.Size() * sizeof(int));
+	for (unsigned line = 0; line < numlines; ++line)
 	{
-		Level->blockmap.blockmaplump[ii] = BlockMap[ii];
+		const int *c = &coords[line*4];
+		TraceBlockmapLine (c[0], c[1], c[2], c[3], bmapwidth, blockbits, [&](int block) { Lines[fill[block]++] = line; });
 	}
-}
 
+	TArray<int> BlockMap (bmapwidth * bmapheight * 3 + 4);
 
+	adder = minx;			BlockMap.Push (adder);
+	adder = miny;			BlockMap.Push (adder);
+	adder = bmapwidth;		BlockMap.Push (adder);
+	adder = bmapheight;		BlockMap.Push (adder);
+
+	BlockMap.Reserve (bmapwidth * bmapheight);
+	CreatePackedBlockmap (BlockMap, Lines.Data(), Offsets.Data(), bmapwidth, bmapheight);
+
+	Level->blockmap.blockmaplump = new int[BlockMap.Size()];
+	memcpy (Level->blockmap.blockmaplump, BlockMap.Data(), BlockMap.Size() * sizeof(int));
+	Level->blockmap.BlockSize = 1 << blockbits;
+
+	DPrintf (DMSG_NOTIFY, "BLOCKMAP generation took %.3f sec (%dx%d blocks of %d units)\n",
+		(I_msTime() - startTime) * 0.001, bmapwidth, bmapheight, 1 << blockbits);
+	return BlockMap.Size();
+}
 
 //===========================================================================
 //
@@ -2596,13 +2645,13 @@ void MapLoader::LoadBlockMap (MapData * map)
 {
 	int count = map->Size(ML_BLOCKMAP);
 
-	if (ForceNodeBuild || genblockmap ||
+	Level->blockmap.BlockSize = FBlockmap::MAPBLOCKUNITS;
+	if (ForceNodeBuild || genblockmap || genfineblockmap ||
 		count/2 >= 0x10000 || count == 0 ||
 		Args->CheckParm("-blockmap")
 		)
 	{
-		DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-		CreateBlockMap ();
+		GenerateBlockMap(map);
 	}
 	else
 	{
@@ -2631,8 +2680,9 @@ void MapLoader::LoadBlockMap (MapData * map)
 
 		if (!Level->blockmap.VerifyBlockMap(count, Level->lines.Size()))
 		{
-			DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-			CreateBlockMap();
+			delete[] Level->blockmap.blockmaplump;
+			Level->blockmap.blockmaplump = nullptr;
+			GenerateBlockMap(map);
 		}
 
 	}
@@ -3265,8 +3315,9 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	if (!Level->IsReentering())
 		Level->FinalizePortals();	// finalize line portals after polyobjects have been initialized. This info is needed for properly flagging them.
 
-	Level->aabbTree = new DoomLevelAABBTree(Level);
+	LoadAABBTree(map);
 	Level->levelMesh = new DoomLevelMesh(*Level);
+	LoadPVS(map);
 }
 
 //==========================================================================
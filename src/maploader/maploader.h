@@ -107,6 +107,12 @@ public:
 	FLevelLocals *Level;
 private:
 
+	enum
+	{
+		BLOCKBITS = 7,		// block sizes that CreateBlockMap can produce
+		FINEBLOCKBITS = 6,
+	};
+
 	int firstglvertex;	// helpers for loading GL nodes from GWA files.
 	bool format5;
 
@@ -228,7 +234,8 @@ private:
 	void AllocateSideDefs(MapData *map, int count);
 	void ProcessSideTextures(bool checktranmap, side_t *sd, sector_t *sec, intmapsidedef_t *msd, int special, int tag, short *alpha, FMissingTextureTracker &missingtex);
 	void SetMapThingUserData(AActor *actor, unsigned udi);
-	void CreateBlockMap();
+	unsigned CreateBlockMap();
+	void GenerateBlockMap(MapData *map);
 	void PO_Init(void);
 
 	// During map init the items' own Index functions should not be used.
@@ -279,6 +286,8 @@ public:
 	template<class nodetype, class subsectortype> bool LoadNodes(MapData * map);
 	bool LoadGLNodes(MapData * map);
 	bool CheckCachedNodes(MapData *map);
+	void LoadPVS(MapData *map);
+	void LoadAABBTree(MapData *map);
 	bool CheckNodes(MapData * map, bool rebuilt, int buildtime);
 	bool CheckForGLNodes();
 
@@ -52,6 +52,8 @@
 #include "xlat/xlat.h"
 #include "maploader.h"
 #include "texturemanager.h"
+#include "i_time.h"
+#include "ctpl.h"
 
 //===========================================================================
 //
@@ -127,6 +129,321 @@ namespace
 }
 #define CHECK_N(f) if (!(namespace_bits&(f))) break;
 
+//===========================================================================
+//
+// Threaded TEXTMAP tokenizing
+//
+//===========================================================================
+
+CVARD(Bool, udmf_threadedscan, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "Tokenize large UDMF maps on worker threads")
+
+// Lumps smaller than this are not worth the setup.
+static const size_t MinThreadedTextMap = 2 << 20;
+static const size_t TextMapChunkSize = 256 << 10;
+
+FUDMFScanner::~FUDMFScanner()
+{
+	// The pool finishes all queued chunks before it goes away.
+	delete Pool;
+}
+
+//===========================================================================
+//
+// Opens a TEXTMAP lump, either normally or as a token stream
+//
+//===========================================================================
+
+void FUDMFScanner::OpenTextMap(const char *name, TArray<uint8_t> &&buffer)
+{
+	unsigned numthreads = std::thread::hardware_concurrency();
+
+	if (!udmf_threadedscan || numthreads < 2 || buffer.Size() < MinThreadedTextMap)
+	{
+		OpenMem(name, buffer);
+		return;
+	}
+
+	Text = std::move(buffer);
+	ScriptName = name;
+	LumpNum = -1;
+	SplitText(TextMapChunkSize);
+
+	Pool = new ctpl::thread_pool(numthreads - 1);
+	for (unsigned i = 0; i < numthreads * 2 && i < Chunks.Size(); i++)
+	{
+		QueueChunk();
+	}
+	Replaying = true;
+	CurChunk = 0;
+	CurToken = 0;
+	AlreadyGot = false;
+	End = false;
+	Chunks[0].Done.get();
+}
+
+//===========================================================================
+//
+// Splits the text after top-level blocks. This only needs to know about
+// strings and comments, which is far less work than tokenizing.
+//
+//===========================================================================
+
+void FUDMFScanner::SplitText(size_t chunksize)
+{
+	struct Range
+	{
+		size_t Start;
+		int Line;
+	};
+	TArray<Range> ranges;
+	const char *text = (const char *)Text.Data();
+	size_t size = Text.Size();
+	size_t start = 0;
+	int line = 1, startline = 1;
+	int depth = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		char c = text[i];
+		if (c == '\n')
+		{
+			line++;
+		}
+		else if (c == '"')
+		{
+			for (i++; i < size && text[i] != '"'; i++)
+			{
+				if (text[i] == '\\' && i + 1 < size) i++;
+				if (text[i] == '\n') line++;
+			}
+		}
+		else if (c == '/' && i + 1 < size && text[i + 1] == '/')
+		{
+			while (i + 1 < size && text[i + 1] != '\n') i++;
+		}
+		else if (c == '/' && i + 1 < size && text[i + 1] == '*')
+		{
+			for (i += 2; i + 1 < size && !(text[i] == '*' && text[i + 1] == '/'); i++)
+			{
+				if (text[i] == '\n') line++;
+			}
+			i++;
+		}
+		else if (c == '{')
+		{
+			depth++;
+		}
+		else if (c == '}' && --depth <= 0)
+		{
+			depth = 0;
+			if (i + 1 - start >= chunksize && i + 1 < size)
+			{
+				ranges.Push({ start, startline });
+				start = i + 1;
+				startline = line;
+			}
+		}
+	}
+	ranges.Push({ start, startline });
+
+	Chunks.Resize(ranges.Size());
+	for (unsigned i = 0; i < ranges.Size(); i++)
+	{
+		size_t end = i + 1 < ranges.Size() ? ranges[i + 1].Start : size;
+		Chunks[i].Start = text + ranges[i].Start;
+		Chunks[i].Size = end - ranges[i].Start;
+		Chunks[i].Line = ranges[i].Line;
+	}
+}
+
+//===========================================================================
+//
+// Hands the next chunk to the thread pool
+//
+//===========================================================================
+
+void FUDMFScanner::QueueChunk()
+{
+	if (QueuedChunks < Chunks.Size())
+	{
+		Chunk *chunk = &Chunks[QueuedChunks++];
+		const char *name = ScriptName.GetChars();
+		chunk->Done = Pool->push([=](int) { Tokenize(*chunk, name); });
+	}
+}
+
+//===========================================================================
+//
+// Runs on a worker thread. FScanner does not touch any global state as
+// long as symbol evaluation is off.
+//
+// A syntax error is kept with the chunk, so that the main thread can report
+// it with the line in the whole lump once the parser gets there.
+//
+//===========================================================================
+
+void FUDMFScanner::Tokenize(Chunk &chunk, const char *name)
+{
+	FScanner sc;
+	sc.OpenMem(name, chunk.Start, (int)chunk.Size);
+	sc.SetCMode(true);
+	chunk.Tokens.Grow(unsigned(chunk.Size / 4));
+	try
+	{
+		while (sc.GetToken())
+		{
+			Token &tok = chunk.Tokens[chunk.Tokens.Reserve(1)];
+			tok.TokenType = sc.TokenType;
+			tok.Line = sc.Line + chunk.Line - 1;
+			tok.StringLen = sc.StringLen;
+			tok.StringOfs = chunk.Strings.Reserve(sc.StringLen + 1);
+			memcpy(&chunk.Strings[tok.StringOfs], sc.String, sc.StringLen);
+			chunk.Strings[tok.StringOfs + sc.StringLen] = 0;
+			tok.BigNumber = sc.BigNumber;
+			tok.Float = sc.Float;
+		}
+	}
+	catch (CRecoverableError &err)
+	{
+		// Only keep the message itself. The first line names the script and the chunk relative line.
+		const char *msg = err.GetMessage();
+		const char *text = strchr(msg, '\n');
+		chunk.Error = text != nullptr ? text + 1 : msg;
+		chunk.Error.StripRight();
+		chunk.ErrorLine = sc.Line + chunk.Line - 1;
+	}
+}
+
+//===========================================================================
+//
+// Reads the next token from the stream. Only the fields FScanner::GetToken
+// would set for this token type are changed.
+//
+//===========================================================================
+
+bool FUDMFScanner::NextToken()
+{
+	if (AlreadyGot)
+	{
+		AlreadyGot = false;
+		return true;
+	}
+	while (CurToken >= Chunks[CurChunk].Tokens.Size())
+	{
+		if (Chunks[CurChunk].Error.IsNotEmpty())
+		{
+			Line = Chunks[CurChunk].ErrorLine;
+			ScriptError("%s", Chunks[CurChunk].Error.GetChars());
+		}
+		if (CurChunk + 1 >= Chunks.Size())
+		{
+			End = true;
+			return false;
+		}
+		// The previous chunk's strings may still be referenced by the parser.
+		if (CurChunk > 0)
+		{
+			Chunks[CurChunk - 1].Tokens.Reset();
+			Chunks[CurChunk - 1].Strings.Reset();
+		}
+		CurChunk++;
+		CurToken = 0;
+		Chunks[CurChunk].Done.get();
+		QueueChunk();
+	}
+
+	auto &chunk = Chunks[CurChunk];
+	auto &tok = chunk.Tokens[CurToken++];
+	TokenType = tok.TokenType;
+	Line = LastGotLine = tok.Line;
+	String = &chunk.Strings[tok.StringOfs];
+	StringLen = tok.StringLen;
+	if (TokenType == TK_IntConst || TokenType == TK_UIntConst)
+	{
+		BigNumber = tok.BigNumber;
+		Number = (int)tok.BigNumber;
+		Float = tok.Float;
+	}
+	else if (TokenType == TK_FloatConst)
+	{
+		Float = tok.Float;
+	}
+	return true;
+}
+
+//===========================================================================
+//
+// In the token stream a string is simply the next token's text.
+//
+//===========================================================================
+
+bool FUDMFScanner::GetString()
+{
+	return Replaying ? NextToken() : FScanner::GetString();
+}
+
+bool FUDMFScanner::GetToken(bool evaluate)
+{
+	return Replaying ? NextToken() : FScanner::GetToken(evaluate);
+}
+
+void FUDMFScanner::MustGetString()
+{
+	if (!GetString())
+	{
+		ScriptError("Missing string (unexpected end of file).");
+	}
+}
+
+void FUDMFScanner::MustGetStringName(const char *name)
+{
+	MustGetString();
+	if (!Compare(name))
+	{
+		ScriptError("Expected '%s', got '%s'.", name, String);
+	}
+}
+
+bool FUDMFScanner::CheckString(const char *name)
+{
+	if (GetString())
+	{
+		if (Compare(name))
+		{
+			return true;
+		}
+		UnGet();
+	}
+	return false;
+}
+
+void FUDMFScanner::MustGetAnyToken(bool evaluate)
+{
+	if (!GetToken(evaluate))
+	{
+		ScriptError("Missing token (unexpected end of file).");
+	}
+}
+
+void FUDMFScanner::MustGetToken(int token, bool evaluate)
+{
+	MustGetAnyToken(evaluate);
+	TokenMustBe(token);
+}
+
+bool FUDMFScanner::CheckToken(int token, bool evaluate)
+{
+	if (GetToken(evaluate))
+	{
+		if (TokenType == token)
+		{
+			return true;
+		}
+		UnGet();
+	}
+	return false;
+}
+
 //===========================================================================
 //
 // Common parsing routines
@@ -2243,7 +2560,7 @@ public:
 		isExtended = false;
 		floordrop = false;
 
-		sc.OpenMem(fileSystem.GetFileFullName(map->lumpnum), map->Read(ML_TEXTMAP));
+		sc.OpenTextMap(fileSystem.GetFileFullName(map->lumpnum), map->Read(ML_TEXTMAP));
 		sc.SetCMode(true);
 		if (sc.CheckString("namespace"))
 		{
@@ -2413,6 +2730,8 @@ public:
 void MapLoader::ParseTextMap(MapData *map, FMissingTextureTracker &missingtex)
 {
 	UDMFParser parse(this, missingtex);
+	uint64_t startTime = I_msTime();
 
 	parse.ParseTextMap(map);
+	DPrintf(DMSG_NOTIFY, "TEXTMAP parsing took %.3f sec (%u bytes)\n", (I_msTime() - startTime) * 0.001, map->Size(ML_TEXTMAP));
 }
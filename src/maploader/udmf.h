@@ -1,13 +1,80 @@
 #ifndef __P_UDMF_H
 #define __P_UDMF_H
 
+#include <future>
 #include "sc_man.h"
 #include "m_fixed.h"
 
+namespace ctpl { class thread_pool; }
+
+//==========================================================================
+//
+// FUDMFScanner
+//
+// Large TEXTMAP lumps are split at the end of top-level blocks and the
+// pieces are tokenized on worker threads a few pieces ahead of the parser.
+// The parser reads the tokens back in file order and sees the same
+// sequence a plain FScanner would give it. Small lumps and all other
+// users are passed straight through to FScanner.
+//
+//==========================================================================
+
+class FUDMFScanner : public FScanner
+{
+	struct Token
+	{
+		int TokenType;
+		int Line;
+		int StringLen;
+		unsigned StringOfs;
+		int64_t BigNumber;
+		double Float;
+	};
+
+	struct Chunk
+	{
+		const char *Start;
+		size_t Size;
+		int Line;
+		TArray<Token> Tokens;
+		TArray<char> Strings;
+		std::future<void> Done;
+		FString Error;		// reported once the tokens in front of it have been read
+		int ErrorLine = 0;
+	};
+
+	TArray<uint8_t> Text;
+	TArray<Chunk> Chunks;
+	ctpl::thread_pool *Pool = nullptr;
+	unsigned QueuedChunks = 0;
+	unsigned CurChunk = 0;
+	unsigned CurToken = 0;
+	bool Replaying = false;
+
+	void SplitText(size_t chunksize);
+	void QueueChunk();
+	bool NextToken();
+	static void Tokenize(Chunk &chunk, const char *name);
+
+public:
+	~FUDMFScanner();
+	void OpenTextMap(const char *name, TArray<uint8_t> &&buffer);
+
+	// These hide the FScanner versions so that they can read the token stream.
+	bool GetString();
+	void MustGetString();
+	void MustGetStringName(const char *name);
+	bool CheckString(const char *name);
+	bool GetToken(bool evaluate = false);
+	void MustGetAnyToken(bool evaluate = false);
+	void MustGetToken(int token, bool evaluate = false);
+	bool CheckToken(int token, bool evaluate = false);
+};
+
 class UDMFParserBase
 {
 protected:
-	FScanner sc;
+	FUDMFScanner sc;
 	FName namespc = NAME_None;
 	int namespace_bits;
 	FString parsedString;
@@ -34,6 +34,8 @@
 **
 */
 
+#include <thread>
+
 #include "p_setup.h"
 
 #include "cmdlib.h"
@@ -41,6 +43,10 @@
 #include "md5.h"
 #include "g_levellocals.h"
 #include "cmdlib.h"
+#include "c_cvars.h"
+#include "printf.h"
+
+CVARD(Bool, map_preload, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "Read the next map's lumps in the background during the intermission")
 
 #define IWAD_ID		MAKE_ID('I','W','A','D')
 #define PWAD_ID		MAKE_ID('P','W','A','D')
@@ -396,6 +402,12 @@ void MapData::GetChecksum(uint8_t cksum[16])
 {
 	MD5Context md5;
 
+	if (HasChecksum)
+	{
+		memcpy(cksum, Checksum, 16);
+		return;
+	}
+
 	if (isText)
 	{
 		md5Update(Reader(ML_TEXTMAP), md5, Size(ML_TEXTMAP));
@@ -412,5 +424,108 @@ void MapData::GetChecksum(uint8_t cksum[16])
 	{
 		md5Update(Reader(ML_BEHAVIOR), md5, Size(ML_BEHAVIOR));
 	}
-	md5.Final(cksum);
+	md5.Final(Checksum);
+	HasChecksum = true;
+	memcpy(cksum, Checksum, 16);
+}
+
+//===========================================================================
+//
+// MapData :: Preload
+//
+// Replaces all lumps that are still read from disk with memory copies and
+// calculates the checksum. P_OpenMapData gives every lump its own file
+// handle or a locked cache buffer, so this can run on another thread as
+// long as nothing else touches this MapData in the meantime.
+//
+//===========================================================================
+
+void MapData::Preload()
+{
+	for (auto &lump : MapLumps)
+	{
+		if (lump.Reader.isOpen() && lump.Reader.GetBuffer() == nullptr && lump.Reader.GetLength() > 0)
+		{
+			lump.Reader.OpenMemoryArray([&](TArray<uint8_t> &buffer)
+			{
+				lump.Reader.Seek(0, FileReader::SeekSet);
+				buffer = lump.Reader.Read();
+				return buffer.Size() > 0;
+			});
+		}
+	}
+	uint8_t cksum[16];
+	GetChecksum(cksum);
+}
+
+//===========================================================================
+//
+// Map preloading
+//
+// As soon as a level is exited the next map is opened and its lumps are
+// read on a worker thread, so that P_SetupLevel finds everything in memory
+// when the intermission is over.
+//
+//===========================================================================
+
+static struct FMapPreload
+{
+	std::thread Thread;
+	FString MapName;
+	MapData *Map = nullptr;
+
+	void Wait()
+	{
+		if (Thread.joinable()) Thread.join();
+	}
+
+	~FMapPreload()
+	{
+		// The map data is left alone here because the file system may already be gone.
+		Wait();
+	}
+} MapPreload;
+
+void P_PreloadMapData(const char *mapname)
+{
+	P_CancelMapPreload();
+	if (!map_preload) return;
+
+	MapData *map = nullptr;
+	try
+	{
+		map = P_OpenMapData(mapname, true);
+	}
+	catch (CRecoverableError &)
+	{
+		// Let P_SetupLevel report the problem when the map is really loaded.
+	}
+	if (map == nullptr) return;
+
+	MapPreload.MapName = mapname;
+	MapPreload.Map = map;
+	MapPreload.Thread = std::thread([=] { map->Preload(); });
+	DPrintf(DMSG_NOTIFY, "Preloading map %s\n", mapname);
+}
+
+MapData *P_TakePreloadedMapData(const char *mapname)
+{
+	MapPreload.Wait();
+	MapData *map = MapPreload.Map;
+	if (map != nullptr && MapPreload.MapName.CompareNoCase(mapname) != 0)
+	{
+		delete map;
+		map = nullptr;
+	}
+	MapPreload.Map = nullptr;
+	MapPreload.MapName = "";
+	return map;
+}
+
+void P_CancelMapPreload()
+{
+	MapPreload.Wait();
+	delete MapPreload.Map;
+	MapPreload.Map = nullptr;
+	MapPreload.MapName = "";
 }
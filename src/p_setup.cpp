@@ -331,6 +331,7 @@ void FLevelLocals::ClearLevelData()
 	CorpseQueue.Clear();
 	canvasTextureInfo.EmptyList();
 	sections.Clear();
+	pvs.Clear();
 	segs.Clear();
 	extsectors.Clear();
 	sectors.Clear();
@@ -449,7 +450,8 @@ void P_SetupLevel(FLevelLocals *Level, int position, bool newGame)
 	// Free all level data from the previous map
 	P_FreeLevelData();
 
-	MapData *map = P_OpenMapData(Level->MapName, true);
+	MapData *map = P_TakePreloadedMapData(Level->MapName);
+	if (map == nullptr) map = P_OpenMapData(Level->MapName, true);
 	if (map == nullptr)
 	{
 		I_Error("Unable to open map '%s'\n", Level->MapName.GetChars());
@@ -621,6 +623,7 @@ void P_Init ()
 
 void P_Shutdown ()
 {
+	P_CancelMapPreload();
 	for (auto Level : AllLevels())
 	{
 		Level->Thinkers.DestroyThinkersInList(STAT_STATIC);
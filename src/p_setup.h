@@ -67,7 +67,9 @@ public:
 	bool HasBehavior = false;
 	bool isText = false;
 	bool InWad = false;
+	bool HasChecksum = false;
 	int lumpnum = -1;
+	uint8_t Checksum[16];
 
 	/*
 	void Seek(unsigned int lumpindex)
@@ -131,6 +133,7 @@ public:
 	}
 
 	void GetChecksum(uint8_t cksum[16]);
+	void Preload();
 
 	friend class MapLoader;
 	friend MapData *P_OpenMapData(const char * mapname, bool justcheck);
@@ -138,6 +141,9 @@ public:
 };
 
 MapData * P_OpenMapData(const char * mapname, bool justcheck);
+void P_PreloadMapData(const char *mapname);
+MapData *P_TakePreloadedMapData(const char *mapname);
+void P_CancelMapPreload();
 bool P_CheckMapData(const char * mapname);
 
 void P_SetupLevel (FLevelLocals *Level, int position, bool newGame);
@@ -442,6 +442,26 @@ void FThinkerCollection::MarkRoots()
 		GC::Mark(FreshThinkers[i].Sentinel);
 	}
 	GC::Mark(Thinkers[MAX_STATNUM + 1].Sentinel);
+
+	if (GC::ParallelMark)
+	{
+		// Following the lists one thinker at a time would serialize the mark threads.
+		auto markall = [](FThinkerList &list)
+		{
+			if (list.Sentinel == nullptr) return;
+			for (DThinker *thinker = list.Sentinel->NextThinker; thinker != list.Sentinel; thinker = thinker->NextThinker)
+			{
+				DThinker *mark = thinker;
+				GC::Mark(mark);
+			}
+		};
+		for (int i = 0; i <= MAX_STATNUM; ++i)
+		{
+			markall(Thinkers[i]);
+			markall(FreshThinkers[i]);
+		}
+		markall(Thinkers[MAX_STATNUM + 1]);
+	}
 }
 
 //==========================================================================
@@ -36,6 +36,7 @@
 */
 
 #include <assert.h>
+#include <algorithm>
 
 #include "templates.h"
 #include "doomdef.h"
@@ -78,6 +79,8 @@
 #include "s_music.h"
 #include "v_video.h"
 #include "texturemanager.h"
+#include "vmbuilder.h"
+#include "m_crc32.h"
 
 	// P-codes for ACS scripts
 	enum
@@ -2677,10 +2680,1344 @@ bool FBehavior::Init(FLevelLocals *Level, int lumpnum, FileReader * fr, int len,
 		}
 	}
 
+	DecodeCode ();
+
 	DPrintf (DMSG_NOTIFY, "Loaded %d scripts, %d functions\n", NumScripts, NumFunctions);
 	return true;
 }
 
+//==========================================================================
+//
+// FPcodeReader
+//
+// Reads operands from the raw p-code while decoding it. Anything that
+// would read past the end of the code sets Overrun.
+//
+//==========================================================================
+
+struct FPcodeReader
+{
+	const uint8_t *Data;
+	uint32_t Size;
+	uint32_t Pos;
+	bool Overrun;
+
+	bool Has (uint32_t bytes)
+	{
+		if (Pos > Size || Size - Pos < bytes)
+		{
+			Overrun = true;
+			return false;
+		}
+		return true;
+	}
+
+	int Byte ()
+	{
+		return Has(1) ? Data[Pos++] : 0;
+	}
+
+	int Short ()
+	{
+		if (!Has(2)) return 0;
+		int res = LittleShort(*(const int16_t *)(Data + Pos));
+		Pos += 2;
+		return res;
+	}
+
+	int Word ()
+	{
+		if (!Has(4)) return 0;
+		int res = LittleLong(uallong(*(const int *)(Data + Pos)));
+		Pos += 4;
+		return res;
+	}
+};
+
+//==========================================================================
+//
+// GetPcodeOperands
+//
+// Returns the operands of a p-code, one character each:
+//   b = byte in every format
+//   B = byte in ACS_LittleEnhanced, word otherwise
+//   S = short in ACS_LittleEnhanced, word otherwise
+//   W = word
+//   J = word holding a jump target
+// PCD_PUSHBYTES and PCD_CASEGOTOSORTED have variable length and are
+// handled by DecodeCode itself.
+//
+//==========================================================================
+
+static const char *GetPcodeOperands (int pcd)
+{
+	switch (pcd)
+	{
+	case PCD_PUSHBYTE:
+	case PCD_DELAYDIRECTB:
+		return "b";
+
+	case PCD_PUSH2BYTES:
+	case PCD_RANDOMDIRECTB:
+	case PCD_LSPEC1DIRECTB:
+		return "bb";
+
+	case PCD_PUSH3BYTES:
+	case PCD_LSPEC2DIRECTB:
+		return "bbb";
+
+	case PCD_PUSH4BYTES:
+	case PCD_LSPEC3DIRECTB:
+		return "bbbb";
+
+	case PCD_PUSH5BYTES:
+	case PCD_LSPEC4DIRECTB:
+		return "bbbbb";
+
+	case PCD_LSPEC5DIRECTB:
+		return "bbbbbb";
+
+	case PCD_LSPEC1:
+	case PCD_LSPEC2:
+	case PCD_LSPEC3:
+	case PCD_LSPEC4:
+	case PCD_LSPEC5:
+	case PCD_LSPEC5RESULT:
+	case PCD_CALL:
+	case PCD_CALLDISCARD:
+	case PCD_PUSHFUNCTION:
+	case PCD_ASSIGNSCRIPTVAR:	case PCD_ASSIGNMAPVAR:	case PCD_ASSIGNWORLDVAR:	case PCD_ASSIGNGLOBALVAR:
+	case PCD_ASSIGNSCRIPTARRAY:	case PCD_ASSIGNMAPARRAY:	case PCD_ASSIGNWORLDARRAY:	case PCD_ASSIGNGLOBALARRAY:
+	case PCD_PUSHSCRIPTVAR:		case PCD_PUSHMAPVAR:	case PCD_PUSHWORLDVAR:		case PCD_PUSHGLOBALVAR:
+	case PCD_PUSHSCRIPTARRAY:	case PCD_PUSHMAPARRAY:	case PCD_PUSHWORLDARRAY:	case PCD_PUSHGLOBALARRAY:
+	case PCD_ADDSCRIPTVAR:		case PCD_ADDMAPVAR:		case PCD_ADDWORLDVAR:		case PCD_ADDGLOBALVAR:
+	case PCD_ADDSCRIPTARRAY:	case PCD_ADDMAPARRAY:	case PCD_ADDWORLDARRAY:		case PCD_ADDGLOBALARRAY:
+	case PCD_SUBSCRIPTVAR:		case PCD_SUBMAPVAR:		case PCD_SUBWORLDVAR:		case PCD_SUBGLOBALVAR:
+	case PCD_SUBSCRIPTARRAY:	case PCD_SUBMAPARRAY:	case PCD_SUBWORLDARRAY:		case PCD_SUBGLOBALARRAY:
+	case PCD_MULSCRIPTVAR:		case PCD_MULMAPVAR:		case PCD_MULWORLDVAR:		case PCD_MULGLOBALVAR:
+	case PCD_MULSCRIPTARRAY:	case PCD_MULMAPARRAY:	case PCD_MULWORLDARRAY:		case PCD_MULGLOBALARRAY:
+	case PCD_DIVSCRIPTVAR:		case PCD_DIVMAPVAR:		case PCD_DIVWORLDVAR:		case PCD_DIVGLOBALVAR:
+	case PCD_DIVSCRIPTARRAY:	case PCD_DIVMAPARRAY:	case PCD_DIVWORLDARRAY:		case PCD_DIVGLOBALARRAY:
+	case PCD_MODSCRIPTVAR:		case PCD_MODMAPVAR:		case PCD_MODWORLDVAR:		case PCD_MODGLOBALVAR:
+	case PCD_MODSCRIPTARRAY:	case PCD_MODMAPARRAY:	case PCD_MODWORLDARRAY:		case PCD_MODGLOBALARRAY:
+	case PCD_ANDSCRIPTVAR:		case PCD_ANDMAPVAR:		case PCD_ANDWORLDVAR:		case PCD_ANDGLOBALVAR:
+	case PCD_ANDSCRIPTARRAY:	case PCD_ANDMAPARRAY:	case PCD_ANDWORLDARRAY:		case PCD_ANDGLOBALARRAY:
+	case PCD_EORSCRIPTVAR:		case PCD_EORMAPVAR:		case PCD_EORWORLDVAR:		case PCD_EORGLOBALVAR:
+	case PCD_EORSCRIPTARRAY:	case PCD_EORMAPARRAY:	case PCD_EORWORLDARRAY:		case PCD_EORGLOBALARRAY:
+	case PCD_ORSCRIPTVAR:		case PCD_ORMAPVAR:		case PCD_ORWORLDVAR:		case PCD_ORGLOBALVAR:
+	case PCD_ORSCRIPTARRAY:		case PCD_ORMAPARRAY:	case PCD_ORWORLDARRAY:		case PCD_ORGLOBALARRAY:
+	case PCD_LSSCRIPTVAR:		case PCD_LSMAPVAR:		case PCD_LSWORLDVAR:		case PCD_LSGLOBALVAR:
+	case PCD_LSSCRIPTARRAY:		case PCD_LSMAPARRAY:	case PCD_LSWORLDARRAY:		case PCD_LSGLOBALARRAY:
+	case PCD_RSSCRIPTVAR:		case PCD_RSMAPVAR:		case PCD_RSWORLDVAR:		case PCD_RSGLOBALVAR:
+	case PCD_RSSCRIPTARRAY:		case PCD_RSMAPARRAY:	case PCD_RSWORLDARRAY:		case PCD_RSGLOBALARRAY:
+	case PCD_INCSCRIPTVAR:		case PCD_INCMAPVAR:		case PCD_INCWORLDVAR:		case PCD_INCGLOBALVAR:
+	case PCD_INCSCRIPTARRAY:	case PCD_INCMAPARRAY:	case PCD_INCWORLDARRAY:		case PCD_INCGLOBALARRAY:
+	case PCD_DECSCRIPTVAR:		case PCD_DECMAPVAR:		case PCD_DECWORLDVAR:		case PCD_DECGLOBALVAR:
+	case PCD_DECSCRIPTARRAY:	case PCD_DECMAPARRAY:	case PCD_DECWORLDARRAY:		case PCD_DECGLOBALARRAY:
+		return "B";
+
+	case PCD_CALLFUNC:
+		return "BS";
+
+	case PCD_LSPEC1DIRECT:
+		return "BW";
+
+	case PCD_LSPEC2DIRECT:
+		return "BWW";
+
+	case PCD_LSPEC3DIRECT:
+		return "BWWW";
+
+	case PCD_LSPEC4DIRECT:
+		return "BWWWW";
+
+	case PCD_LSPEC5DIRECT:
+		return "BWWWWW";
+
+	case PCD_PUSHNUMBER:
+	case PCD_LSPEC5EX:
+	case PCD_LSPEC5EXRESULT:
+	case PCD_DELAYDIRECT:
+	case PCD_TAGWAITDIRECT:
+	case PCD_POLYWAITDIRECT:
+	case PCD_SCRIPTWAITDIRECT:
+	case PCD_SETFONTDIRECT:
+	case PCD_SETGRAVITYDIRECT:
+	case PCD_SETAIRCONTROLDIRECT:
+	case PCD_CHECKINVENTORYDIRECT:
+		return "W";
+
+	case PCD_RANDOMDIRECT:
+	case PCD_THINGCOUNTDIRECT:
+	case PCD_CHANGEFLOORDIRECT:
+	case PCD_CHANGECEILINGDIRECT:
+	case PCD_GIVEINVENTORYDIRECT:
+	case PCD_TAKEINVENTORYDIRECT:
+		return "WW";
+
+	case PCD_SETMUSICDIRECT:
+	case PCD_LOCALSETMUSICDIRECT:
+	case PCD_CONSOLECOMMANDDIRECT:
+		return "WWW";
+
+	case PCD_SPAWNSPOTDIRECT:
+		return "WWWW";
+
+	case PCD_SPAWNDIRECT:
+		return "WWWWWW";
+
+	case PCD_GOTO:
+	case PCD_IFGOTO:
+	case PCD_IFNOTGOTO:
+		return "J";
+
+	case PCD_CASEGOTO:
+		return "WJ";
+
+	default:
+		return "";
+	}
+}
+
+//==========================================================================
+//
+// FBehavior :: DecodeCode
+//
+// Expands the module's p-code into one native endian word for the opcode
+// and each of its operands, so the interpreter no longer has to care about
+// the format it was compiled to. Jump targets are resolved to indices into
+// the decoded code. Only code reachable from a script, a function or a jump
+// point is decoded. Code[0] is a PCD_TERMINATE that every offset without
+// decoded code maps to.
+//
+//==========================================================================
+
+void FBehavior::DecodeCode ()
+{
+	FPcodeReader reader = { Data, (uint32_t)DataSize, 0, false };
+	TArray<uint32_t> entries;
+	TArray<unsigned> jumps;
+	int i;
+
+	Code.Clear();
+	CodeOffsets.Clear();
+	Code.Push(PCD_TERMINATE);
+	CodeOffsets.Push(0);
+	CodeIndex.Resize(DataSize);
+	memset(CodeIndex.Data(), 0, DataSize * sizeof(int));
+
+	if (Format == ACS_Unknown)
+	{
+		return;
+	}
+
+	for (i = 0; i < NumScripts; ++i)
+	{
+		entries.Push(Scripts[i].Address);
+	}
+	for (i = 0; i < NumFunctions; ++i)
+	{
+		if (Functions[i].ImportNum == 0 && Functions[i].Address != 0)
+		{
+			entries.Push(Functions[i].Address);
+		}
+	}
+	for (auto jp : JumpPoints)
+	{
+		entries.Push(jp);
+	}
+
+	// entries grows while decoding because every jump target gets appended to it.
+	for (unsigned e = 0; e < entries.Size(); ++e)
+	{
+		uint32_t ofs = entries[e];
+		bool fallthrough = false;
+
+		while (ofs < (uint32_t)DataSize && CodeIndex[ofs] == 0)
+		{
+			unsigned start = Code.Size();
+			unsigned firstjump = jumps.Size();
+			int pcd;
+
+			CodeIndex[ofs] = start;
+			reader.Pos = ofs;
+			reader.Overrun = false;
+
+			if (Format == ACS_LittleEnhanced)
+			{
+				pcd = reader.Byte();
+				if (pcd >= 256-16)
+				{
+					pcd = (256-16) + ((pcd - (256-16)) << 8) + reader.Byte();
+				}
+			}
+			else
+			{
+				pcd = reader.Word();
+			}
+			Code.Push(pcd);
+
+			if (pcd == PCD_PUSHBYTES)
+			{
+				int count = reader.Byte();
+				Code.Push(count);
+				for (int j = 0; j < count; ++j)
+				{
+					Code.Push(reader.Byte());
+				}
+			}
+			else if (pcd == PCD_CASEGOTOSORTED)
+			{
+				// The count and jump table are 4-byte aligned
+				reader.Pos = (reader.Pos + 3) & ~3;
+				int count = reader.Word();
+				Code.Push(count);
+				for (int j = 0; j < count && !reader.Overrun; ++j)
+				{
+					Code.Push(reader.Word());
+					jumps.Push(Code.Push(reader.Word()));
+				}
+			}
+			else
+			{
+				for (const char *op = GetPcodeOperands(pcd); *op != 0; ++op)
+				{
+					int val;
+					switch (*op)
+					{
+					case 'b':	val = reader.Byte();	break;
+					case 'B':	val = Format == ACS_LittleEnhanced ? reader.Byte() : reader.Word();		break;
+					case 'S':	val = Format == ACS_LittleEnhanced ? reader.Short() : reader.Word();	break;
+					default:	val = reader.Word();	break;
+					}
+					unsigned index = Code.Push(val);
+					if (*op == 'J')
+					{
+						jumps.Push(index);
+					}
+				}
+			}
+
+			if (reader.Overrun)
+			{
+				// The instruction does not fit, so don't run any of it.
+				Code.Resize(start);
+				jumps.Resize(firstjump);
+				Code.Push(PCD_TERMINATE);
+				pcd = PCD_TERMINATE;
+			}
+			for (unsigned j = firstjump; j < jumps.Size(); ++j)
+			{
+				entries.Push(Code[jumps[j]]);
+			}
+			while (CodeOffsets.Size() < Code.Size())
+			{
+				CodeOffsets.Push(ofs);
+			}
+
+			ofs = reader.Pos;
+			fallthrough = true;
+			if (pcd < 0 || pcd >= PCODE_COMMAND_COUNT || pcd == PCD_TERMINATE || pcd == PCD_RESTART ||
+				pcd == PCD_GOTO || pcd == PCD_GOTOSTACK || pcd == PCD_RETURNVOID || pcd == PCD_RETURNVAL)
+			{
+				fallthrough = false;
+				break;
+			}
+		}
+
+		if (fallthrough)
+		{
+			// Execution continues at code that has already been decoded (or at the end of the lump).
+			Code.Push(PCD_GOTO);
+			Code.Push(ofs < (uint32_t)DataSize ? CodeIndex[ofs] : 0);
+			CodeOffsets.Push(ofs);
+			CodeOffsets.Push(ofs);
+		}
+	}
+
+	for (auto j : jumps)
+	{
+		uint32_t target = Code[j];
+		Code[j] = target < (uint32_t)DataSize ? CodeIndex[target] : 0;
+	}
+	Code.ShrinkToFit();
+	CodeOffsets.ShrinkToFit();
+}
+
+//==========================================================================
+//
+// ACS function compiler
+//
+// Functions that do nothing but arithmetic on their locals and on map,
+// world and global variables are translated to VM code once they have
+// been called often enough, so the JIT can turn them into native code.
+// Such a function can never suspend, so the calling script keeps all of
+// its state in its DLevelScript as before. Anything else, like calling
+// another function or a line special, makes the compiler give up and the
+// function stays with the interpreter.
+//
+// The compiled function takes a pointer to its module's map variable
+// table, its arguments and the number of instructions the calling script
+// may still execute before it counts as runaway. It returns the function's
+// result, one of the ACSCOMPILE_ status codes and what is left of the
+// instruction budget, so the caller can charge the difference to the
+// script's runaway counter and to acsprofile.
+//
+//==========================================================================
+
+CVAR(Bool, acs_compile, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+enum
+{
+	ACSCOMPILE_THRESHOLD = 32,		// calls before a function gets compiled
+	ACSCOMPILE_MAXARGS = 16,
+	ACSCOMPILE_RUNAWAY = 2000000,	// instructions per script and tic, same as the interpreter's limit
+
+	ACSCOMPILE_Ok = 0,
+	ACSCOMPILE_Runaway,
+	ACSCOMPILE_DivideBy0,
+	ACSCOMPILE_ModulusBy0,
+};
+
+enum EACSVarClass
+{
+	ACSVAR_Script,
+	ACSVAR_Map,
+	ACSVAR_World,
+	ACSVAR_Global,
+};
+
+enum EACSVarOp
+{
+	ACSVAROP_Assign,
+	ACSVAROP_Push,
+	ACSVAROP_Inc,
+	ACSVAROP_Dec,
+	ACSVAROP_Math,
+};
+
+//==========================================================================
+//
+// GetDecodedLength
+//
+// Returns the number of words an instruction takes up in FBehavior::Code.
+//
+//==========================================================================
+
+static int GetDecodedLength (const int *pc)
+{
+	switch (pc[0])
+	{
+	case PCD_PUSHBYTES:
+		return 2 + pc[1];
+
+	case PCD_CASEGOTOSORTED:
+		return 2 + 2 * pc[1];
+
+	default:
+		return 1 + (int)strlen(GetPcodeOperands(pc[0]));
+	}
+}
+
+//==========================================================================
+//
+// GetVarAccess
+//
+// Classifies the p-codes that operate on a single script, map, world or
+// global variable. For ACSVAROP_Math, mathop receives the VM opcode.
+//
+//==========================================================================
+
+static bool GetVarAccess (int pcd, EACSVarClass &cls, EACSVarOp &op, int &mathop)
+{
+#define VARACCESS(name, vop, vmop) \
+	case PCD_##name##SCRIPTVAR:	cls = ACSVAR_Script;	op = vop; mathop = vmop; return true; \
+	case PCD_##name##MAPVAR:	cls = ACSVAR_Map;		op = vop; mathop = vmop; return true; \
+	case PCD_##name##WORLDVAR:	cls = ACSVAR_World;		op = vop; mathop = vmop; return true; \
+	case PCD_##name##GLOBALVAR:	cls = ACSVAR_Global;	op = vop; mathop = vmop; return true;
+
+	switch (pcd)
+	{
+	VARACCESS(ASSIGN,	ACSVAROP_Assign,	OP_NOP)
+	VARACCESS(PUSH,		ACSVAROP_Push,		OP_NOP)
+	VARACCESS(INC,		ACSVAROP_Inc,		OP_NOP)
+	VARACCESS(DEC,		ACSVAROP_Dec,		OP_NOP)
+	VARACCESS(ADD,		ACSVAROP_Math,		OP_ADD_RR)
+	VARACCESS(SUB,		ACSVAROP_Math,		OP_SUB_RR)
+	VARACCESS(MUL,		ACSVAROP_Math,		OP_MUL_RR)
+	VARACCESS(DIV,		ACSVAROP_Math,		OP_DIV_RR)
+	VARACCESS(MOD,		ACSVAROP_Math,		OP_MOD_RR)
+	VARACCESS(AND,		ACSVAROP_Math,		OP_AND_RR)
+	VARACCESS(EOR,		ACSVAROP_Math,		OP_XOR_RR)
+	VARACCESS(OR,		ACSVAROP_Math,		OP_OR_RR)
+	VARACCESS(LS,		ACSVAROP_Math,		OP_SLL_RR)
+	VARACCESS(RS,		ACSVAROP_Math,		OP_SRA_RR)
+	default:
+		return false;
+	}
+#undef VARACCESS
+}
+
+//==========================================================================
+//
+// GetStackEffect
+//
+// Returns how many values an instruction pops and pushes, or false if
+// the compiler does not support it. For the case jumps this is the
+// effect when no case matches.
+//
+//==========================================================================
+
+static bool GetStackEffect (const int *pc, int &pop, int &push)
+{
+	EACSVarClass cls;
+	EACSVarOp op;
+	int mathop;
+
+	pop = push = 0;
+	if (GetVarAccess(pc[0], cls, op, mathop))
+	{
+		pop = (op == ACSVAROP_Assign || op == ACSVAROP_Math);
+		push = (op == ACSVAROP_Push);
+		return true;
+	}
+	switch (pc[0])
+	{
+	case PCD_NOP:
+	case PCD_GOTO:
+	case PCD_RETURNVOID:
+		return true;
+
+	case PCD_PUSHNUMBER:
+	case PCD_PUSHBYTE:
+		push = 1;
+		return true;
+
+	case PCD_PUSH2BYTES:	push = 2;		return true;
+	case PCD_PUSH3BYTES:	push = 3;		return true;
+	case PCD_PUSH4BYTES:	push = 4;		return true;
+	case PCD_PUSH5BYTES:	push = 5;		return true;
+	case PCD_PUSHBYTES:		push = pc[1];	return true;
+
+	case PCD_ADD:
+	case PCD_SUBTRACT:
+	case PCD_MULTIPLY:
+	case PCD_DIVIDE:
+	case PCD_MODULUS:
+	case PCD_EQ:
+	case PCD_NE:
+	case PCD_LT:
+	case PCD_GT:
+	case PCD_LE:
+	case PCD_GE:
+	case PCD_ANDLOGICAL:
+	case PCD_ORLOGICAL:
+	case PCD_ANDBITWISE:
+	case PCD_ORBITWISE:
+	case PCD_EORBITWISE:
+	case PCD_LSHIFT:
+	case PCD_RSHIFT:
+		pop = 2;
+		push = 1;
+		return true;
+
+	case PCD_NEGATELOGICAL:
+	case PCD_NEGATEBINARY:
+	case PCD_UNARYMINUS:
+	case PCD_CASEGOTO:
+	case PCD_CASEGOTOSORTED:
+		pop = push = 1;
+		return true;
+
+	case PCD_DUP:
+		pop = 1;
+		push = 2;
+		return true;
+
+	case PCD_SWAP:
+		pop = push = 2;
+		return true;
+
+	case PCD_DROP:
+	case PCD_IFGOTO:
+	case PCD_IFNOTGOTO:
+	case PCD_RETURNVAL:
+		pop = 1;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// Compiled functions are kept for as long as the VM exists, like all other
+// VM functions, and are shared by every module that contains the same code.
+// So loading a map again does not compile anything new. The cache is
+// emptied by P_ClearACSCompiledFunctions when the VM shuts down.
+//
+//==========================================================================
+
+struct FACSCompiledFunction
+{
+	TArray<int> Key;
+	VMFunction *Func;
+};
+
+static TMap<uint32_t, TArray<FACSCompiledFunction *>> ACSCompiledFunctions;
+
+//==========================================================================
+//
+// P_ClearACSCompiledFunctions
+//
+// The functions themselves are deleted along with all other VM functions.
+//
+//==========================================================================
+
+void P_ClearACSCompiledFunctions()
+{
+	decltype(ACSCompiledFunctions)::Iterator it(ACSCompiledFunctions);
+	decltype(ACSCompiledFunctions)::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		for (auto compiled : pair->Value)
+		{
+			delete compiled;
+		}
+	}
+	ACSCompiledFunctions.Clear();
+}
+
+//==========================================================================
+//
+// FACSCompiler
+//
+// Keeps the ACS stack in registers. This works because ACC always leaves
+// the stack at the same depth whichever way an instruction is reached, so
+// every stack slot can be given a fixed register.
+//
+//==========================================================================
+
+class FACSCompiler
+{
+public:
+	FACSCompiler (const int *code, int numargs, int numlocals)
+		: Code(code), NumArgs(numargs), NumLocals(numlocals), Build(0)
+	{
+	}
+
+	VMScriptFunction *Compile (int entry, const FString &name);
+
+private:
+	bool Analyze (int entry);
+	bool AddSuccessor (int from, int to, int depth);
+	bool EmitInstruction (int index, int depth);
+	bool EmitVarAccess (int index, int depth);
+	void EmitZeroCheck (int reg, TArray<size_t> &exits);
+	void EmitCondition (int opcode, int check, int b, int c, int dest);
+	void EmitJump (int target);
+	void EmitReturn (int value, int status);
+	void EmitExit (TArray<size_t> &jumps, int status);
+	uint32_t MakeKey (int entry, const FString &name, TArray<int> &key) const;
+	int StackReg (int slot) const { return StackBase + slot; }
+
+	const int *Code;
+	int NumArgs;
+	int NumLocals;
+	VMFunctionBuilder Build;
+
+	TMap<int, int> Depth;		// stack depth on entry, by code index
+	TMap<int, bool> LoopHeads;	// targets of backward jumps
+	TMap<int, bool> BlockStarts;	// branch targets and fall-throughs of conditional branches
+	TArray<int> Order;
+	TArray<int> Work;
+	int MaxDepth = 0;
+
+	int Counter = 0;
+	int Temp = 0;
+	int StackBase = 0;
+
+	TMap<int, size_t> Addresses;
+	TArray<std::pair<size_t, int>> Jumps;
+	TArray<size_t> RunawayExits;
+	TArray<size_t> Div0Exits;
+	TArray<size_t> Mod0Exits;
+};
+
+//==========================================================================
+//
+// FACSCompiler :: Analyze
+//
+// Finds all instructions reachable from the entry point and the stack
+// depth at each of them. Fails if anything is not supported.
+//
+//==========================================================================
+
+bool FACSCompiler::Analyze (int entry)
+{
+	Depth[entry] = 0;
+	BlockStarts[entry] = true;
+	Order.Push(entry);
+	Work.Push(entry);
+
+	int index;
+	while (Work.Pop(index))
+	{
+		const int *pc = Code + index;
+		int depth = Depth[index];
+		int next = index + GetDecodedLength(pc);
+		int pop, push;
+
+		if (!GetStackEffect(pc, pop, push) || depth < pop)
+		{
+			return false;
+		}
+		int after = depth - pop + push;
+		MaxDepth = max(MaxDepth, after);
+
+		switch (pc[0])
+		{
+		case PCD_RETURNVOID:
+		case PCD_RETURNVAL:
+			break;
+
+		case PCD_GOTO:
+			if (!AddSuccessor(index, pc[1], after)) return false;
+			break;
+
+		case PCD_IFGOTO:
+		case PCD_IFNOTGOTO:
+			BlockStarts[next] = true;
+			if (!AddSuccessor(index, pc[1], after) || !AddSuccessor(index, next, after)) return false;
+			break;
+
+		case PCD_CASEGOTO:
+			BlockStarts[next] = true;
+			if (!AddSuccessor(index, pc[2], depth - 1) || !AddSuccessor(index, next, depth)) return false;
+			break;
+
+		case PCD_CASEGOTOSORTED:
+			BlockStarts[next] = true;
+			for (int i = 0; i < pc[1]; ++i)
+			{
+				if (!AddSuccessor(index, pc[3 + i*2], depth - 1)) return false;
+			}
+			if (!AddSuccessor(index, next, depth)) return false;
+			break;
+
+		default:
+			if (!AddSuccessor(index, next, after)) return false;
+			break;
+		}
+	}
+	std::sort(Order.begin(), Order.end());
+	return true;
+}
+
+bool FACSCompiler::AddSuccessor (int from, int to, int depth)
+{
+	if (to <= from)
+	{
+		LoopHeads[to] = true;
+	}
+	if (to != from + GetDecodedLength(Code + from))
+	{
+		BlockStarts[to] = true;
+	}
+	int *known = Depth.CheckKey(to);
+	if (known != nullptr)
+	{
+		return *known == depth;
+	}
+	Depth[to] = depth;
+	Order.Push(to);
+	Work.Push(to);
+	return true;
+}
+
+//==========================================================================
+//
+// FACSCompiler :: Compile
+//
+//==========================================================================
+
+VMScriptFunction *FACSCompiler::Compile (int entry, const FString &name)
+{
+	if (!Analyze(entry) || NumLocals + 2 + MaxDepth > 255)
+	{
+		return nullptr;
+	}
+
+	TArray<int> key;
+	uint32_t hash = MakeKey(entry, name, key);
+	auto cached = ACSCompiledFunctions.CheckKey(hash);
+	if (cached != nullptr)
+	{
+		for (auto known : *cached)
+		{
+			if (known->Key == key)
+			{
+				return static_cast<VMScriptFunction *>(known->Func);
+			}
+		}
+	}
+
+	// The arguments and the instruction budget arrive in the first registers,
+	// followed by the other locals, the budget counter, a scratch register
+	// and the stack.
+	for (int i = 0; i < NumLocals + 2 + MaxDepth; ++i)
+	{
+		Build.Registers[REGT_INT].Get(1);
+	}
+	Counter = NumLocals;
+	Temp = NumLocals + 1;
+	StackBase = NumLocals + 2;
+	// a0 is the map variable table, a1 holds the address of the variable being accessed.
+	Build.Registers[REGT_POINTER].Get(2);
+
+	if (NumArgs != Counter)
+	{
+		Build.Emit(OP_MOVE, Counter, NumArgs);
+	}
+	for (int i = NumArgs; i < NumLocals; ++i)
+	{
+		Build.Emit(OP_LI, i, 0);
+	}
+
+	for (unsigned i = 0; i < Order.Size(); ++i)
+	{
+		int index = Order[i];
+		Addresses[index] = Build.GetAddress();
+		if (BlockStarts.CheckKey(index) != nullptr)
+		{
+			// Charge the whole block to the budget when entering it. Only a
+			// loop can exceed it, so it is only checked at loop heads.
+			unsigned end = i + 1;
+			while (end < Order.Size() && BlockStarts.CheckKey(Order[end]) == nullptr)
+			{
+				end++;
+			}
+			Build.Emit(OP_SUB_RK, Counter, Counter, Build.GetConstantInt(end - i));
+			if (LoopHeads.CheckKey(index) != nullptr)
+			{
+				Build.Emit(OP_LT_RK, 1, Counter, Build.GetConstantInt(0));
+				RunawayExits.Push(Build.Emit(OP_JMP, 0));
+			}
+		}
+		if (!EmitInstruction(index, Depth[index]))
+		{
+			return nullptr;
+		}
+	}
+	for (auto &jump : Jumps)
+	{
+		Build.Backpatch(jump.first, Addresses[jump.second]);
+	}
+	EmitExit(RunawayExits, ACSCOMPILE_Runaway);
+	EmitExit(Div0Exits, ACSCOMPILE_DivideBy0);
+	EmitExit(Mod0Exits, ACSCOMPILE_ModulusBy0);
+
+	VMScriptFunction *sfunc = new VMScriptFunction;
+	TArray<PType *> rets, args;
+	rets.Push(TypeSInt32);
+	rets.Push(TypeSInt32);
+	rets.Push(TypeSInt32);
+	args.Push(TypeVoidPtr);
+	uint8_t *regtypes = (uint8_t *)ClassDataAllocator.Alloc(NumArgs + 2);
+
+	regtypes[0] = REGT_POINTER;
+	for (int i = 0; i <= NumArgs; ++i)
+	{
+		args.Push(TypeSInt32);
+		regtypes[i + 1] = REGT_INT;
+	}
+	sfunc->Proto = NewPrototype(rets, args);
+	sfunc->RegTypes = regtypes;	// Built after the script compiler ran, so this must be set here.
+	Build.MakeFunction(sfunc);
+	sfunc->NumArgs = NumArgs + 2;
+	sfunc->PrintableName = name;
+
+	auto compiled = new FACSCompiledFunction;
+	compiled->Key = std::move(key);
+	compiled->Func = sfunc;
+	ACSCompiledFunctions[hash].Push(compiled);
+	return sfunc;
+}
+
+//==========================================================================
+//
+// FACSCompiler :: MakeKey
+//
+// Describes everything the generated code depends on, so identical
+// functions can share it. Must be called after Analyze.
+//
+//==========================================================================
+
+uint32_t FACSCompiler::MakeKey (int entry, const FString &name, TArray<int> &key) const
+{
+	key.Clear();
+	key.Push(NumArgs);
+	key.Push(NumLocals);
+	key.Push(entry);
+	for (auto index : Order)
+	{
+		key.Push(index);
+		for (int i = 0; i < GetDecodedLength(Code + index); ++i)
+		{
+			key.Push(Code[index + i]);
+		}
+	}
+	uint32_t hash = CalcCRC32((const uint8_t *)key.Data(), key.Size() * sizeof(int));
+	return AddCRC32(hash, (const uint8_t *)name.GetChars(), (unsigned)name.Len());
+}
+
+//==========================================================================
+//
+// FACSCompiler :: EmitInstruction
+//
+//==========================================================================
+
+bool FACSCompiler::EmitInstruction (int index, int depth)
+{
+	const int *pc = Code + index;
+	int a = StackReg(depth - 2);
+	int b = StackReg(depth - 1);
+	int i;
+
+	switch (pc[0])
+	{
+	case PCD_NOP:
+	case PCD_DROP:
+		break;
+
+	case PCD_PUSHNUMBER:
+	case PCD_PUSHBYTE:
+	case PCD_PUSH2BYTES:
+	case PCD_PUSH3BYTES:
+	case PCD_PUSH4BYTES:
+	case PCD_PUSH5BYTES:
+		for (i = 1; i < GetDecodedLength(pc); ++i)
+		{
+			Build.EmitLoadInt(StackReg(depth + i - 1), pc[i]);
+		}
+		break;
+
+	case PCD_PUSHBYTES:
+		for (i = 0; i < pc[1]; ++i)
+		{
+			Build.EmitLoadInt(StackReg(depth + i), pc[2 + i]);
+		}
+		break;
+
+	case PCD_ADD:			Build.Emit(OP_ADD_RR, a, a, b);		break;
+	case PCD_SUBTRACT:		Build.Emit(OP_SUB_RR, a, a, b);		break;
+	case PCD_MULTIPLY:		Build.Emit(OP_MUL_RR, a, a, b);		break;
+	case PCD_ANDBITWISE:	Build.Emit(OP_AND_RR, a, a, b);		break;
+	case PCD_ORBITWISE:		Build.Emit(OP_OR_RR, a, a, b);		break;
+	case PCD_EORBITWISE:	Build.Emit(OP_XOR_RR, a, a, b);		break;
+	case PCD_LSHIFT:		Build.Emit(OP_SLL_RR, a, a, b);		break;
+	case PCD_RSHIFT:		Build.Emit(OP_SRA_RR, a, a, b);		break;
+	case PCD_UNARYMINUS:	Build.Emit(OP_NEG, b, b, 0);		break;
+	case PCD_NEGATEBINARY:	Build.Emit(OP_NOT, b, b, 0);		break;
+
+	case PCD_DIVIDE:
+		EmitZeroCheck(b, Div0Exits);
+		Build.Emit(OP_DIV_RR, a, a, b);
+		break;
+
+	case PCD_MODULUS:
+		EmitZeroCheck(b, Mod0Exits);
+		Build.Emit(OP_MOD_RR, a, a, b);
+		break;
+
+	// The comparisons leave 1 on the stack if their result differs from the check value.
+	case PCD_EQ:	EmitCondition(OP_EQ_R, 0, a, b, a);		break;
+	case PCD_NE:	EmitCondition(OP_EQ_R, 1, a, b, a);		break;
+	case PCD_LT:	EmitCondition(OP_LT_RR, 0, a, b, a);	break;
+	case PCD_GT:	EmitCondition(OP_LT_RR, 0, b, a, a);	break;
+	case PCD_LE:	EmitCondition(OP_LE_RR, 0, a, b, a);	break;
+	case PCD_GE:	EmitCondition(OP_LE_RR, 0, b, a, a);	break;
+
+	case PCD_NEGATELOGICAL:
+		EmitCondition(OP_EQ_K, 0, b, Build.GetConstantInt(0), b);
+		break;
+
+	case PCD_ORLOGICAL:
+		Build.Emit(OP_OR_RR, a, a, b);
+		EmitCondition(OP_EQ_K, 1, a, Build.GetConstantInt(0), a);
+		break;
+
+	case PCD_ANDLOGICAL:
+	{
+		Build.Emit(OP_LI, Temp, 0);
+		Build.Emit(OP_EQ_K, 1, a, Build.GetConstantInt(0));
+		size_t ajump = Build.Emit(OP_JMP, 0);
+		Build.Emit(OP_EQ_K, 1, b, Build.GetConstantInt(0));
+		size_t bjump = Build.Emit(OP_JMP, 0);
+		Build.Emit(OP_LI, Temp, 1);
+		Build.BackpatchToHere(ajump);
+		Build.BackpatchToHere(bjump);
+		Build.Emit(OP_MOVE, a, Temp);
+		break;
+	}
+
+	case PCD_DUP:
+		Build.Emit(OP_MOVE, StackReg(depth), b);
+		break;
+
+	case PCD_SWAP:
+		Build.Emit(OP_MOVE, Temp, a);
+		Build.Emit(OP_MOVE, a, b);
+		Build.Emit(OP_MOVE, b, Temp);
+		break;
+
+	case PCD_GOTO:
+		EmitJump(pc[1]);
+		break;
+
+	case PCD_IFGOTO:
+		Build.Emit(OP_EQ_K, 0, b, Build.GetConstantInt(0));
+		EmitJump(pc[1]);
+		break;
+
+	case PCD_IFNOTGOTO:
+		Build.Emit(OP_EQ_K, 1, b, Build.GetConstantInt(0));
+		EmitJump(pc[1]);
+		break;
+
+	case PCD_CASEGOTO:
+		Build.Emit(OP_EQ_K, 1, b, Build.GetConstantInt(pc[1]));
+		EmitJump(pc[2]);
+		break;
+
+	case PCD_CASEGOTOSORTED:
+		for (i = 0; i < pc[1]; ++i)
+		{
+			Build.Emit(OP_EQ_K, 1, b, Build.GetConstantInt(pc[2 + i*2]));
+			EmitJump(pc[3 + i*2]);
+		}
+		break;
+
+	case PCD_RETURNVOID:
+		EmitReturn(-1, ACSCOMPILE_Ok);
+		break;
+
+	case PCD_RETURNVAL:
+		EmitReturn(b, ACSCOMPILE_Ok);
+		break;
+
+	default:
+		return EmitVarAccess(index, depth);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FACSCompiler :: EmitVarAccess
+//
+// Script variables live in registers. The others are loaded and stored
+// through a1, which points at them.
+//
+//==========================================================================
+
+bool FACSCompiler::EmitVarAccess (int index, int depth)
+{
+	const int *pc = Code + index;
+	EACSVarClass cls;
+	EACSVarOp op;
+	int mathop;
+	int var = pc[1];
+	int reg;
+
+	if (!GetVarAccess(pc[0], cls, op, mathop))
+	{
+		return false;
+	}
+
+	switch (cls)
+	{
+	case ACSVAR_Script:
+		if (var < 0 || var >= NumLocals) return false;
+		reg = var;
+		break;
+
+	case ACSVAR_Map:
+		if (var < 0 || var >= NUM_MAPVARS) return false;
+		Build.Emit(OP_LP, 1, 0, Build.GetConstantInt(var * (int)sizeof(int32_t *)));
+		reg = Temp;
+		break;
+
+	case ACSVAR_World:
+		if (var < 0 || var >= NUM_WORLDVARS) return false;
+		Build.Emit(OP_LKP, 1, Build.GetConstantAddress(ACS_WorldVars.Pointer() + var));
+		reg = Temp;
+		break;
+
+	case ACSVAR_Global:
+		if (var < 0 || var >= NUM_GLOBALVARS) return false;
+		Build.Emit(OP_LKP, 1, Build.GetConstantAddress(ACS_GlobalVars.Pointer() + var));
+		reg = Temp;
+		break;
+
+	default:
+		return false;
+	}
+
+	int zero = Build.GetConstantInt(0);
+	if (reg == Temp && op != ACSVAROP_Assign)
+	{
+		Build.Emit(OP_LW, Temp, 1, zero);
+	}
+	switch (op)
+	{
+	case ACSVAROP_Assign:
+		if (reg == Temp) Build.Emit(OP_SW, 1, StackReg(depth - 1), zero);
+		else Build.Emit(OP_MOVE, reg, StackReg(depth - 1));
+		return true;
+
+	case ACSVAROP_Push:
+		Build.Emit(OP_MOVE, StackReg(depth), reg);
+		return true;
+
+	case ACSVAROP_Inc:
+	case ACSVAROP_Dec:
+		Build.Emit(OP_ADDI, reg, reg, uint8_t(op == ACSVAROP_Inc ? 1 : -1));
+		break;
+
+	case ACSVAROP_Math:
+		if (mathop == OP_DIV_RR) EmitZeroCheck(StackReg(depth - 1), Div0Exits);
+		else if (mathop == OP_MOD_RR) EmitZeroCheck(StackReg(depth - 1), Mod0Exits);
+		Build.Emit(mathop, reg, reg, StackReg(depth - 1));
+		break;
+	}
+	if (reg == Temp)
+	{
+		Build.Emit(OP_SW, 1, Temp, zero);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FACSCompiler :: EmitZeroCheck
+//
+// Leaves the function with an error status if the register is 0, the same
+// way the interpreter stops the script on division by zero.
+//
+//==========================================================================
+
+void FACSCompiler::EmitZeroCheck (int reg, TArray<size_t> &exits)
+{
+	Build.Emit(OP_EQ_K, 1, reg, Build.GetConstantInt(0));
+	exits.Push(Build.Emit(OP_JMP, 0));
+}
+
+//==========================================================================
+//
+// FACSCompiler :: EmitCondition
+//
+// Sets dest to 1 if the comparison's result differs from check, else to 0.
+// A comparison must always be followed by a jump, which is taken if the
+// result equals check.
+//
+//==========================================================================
+
+void FACSCompiler::EmitCondition (int opcode, int check, int b, int c, int dest)
+{
+	Build.Emit(OP_LI, Temp, 0);
+	Build.Emit(opcode, check, b, c);
+	Build.Emit(OP_JMP, 1);
+	Build.Emit(OP_LI, Temp, 1);
+	Build.Emit(OP_MOVE, dest, Temp);
+}
+
+void FACSCompiler::EmitJump (int target)
+{
+	Jumps.Push(std::make_pair(Build.Emit(OP_JMP, 0), target));
+}
+
+void FACSCompiler::EmitReturn (int value, int status)
+{
+	if (value < 0) Build.EmitRetInt(0, false, 0);
+	else Build.Emit(OP_RET, 0, REGT_INT, value);
+	Build.EmitRetInt(1, false, status);
+	Build.Emit(OP_RET, 2 | RET_FINAL, REGT_INT, Counter);
+}
+
+void FACSCompiler::EmitExit (TArray<size_t> &jumps, int status)
+{
+	if (jumps.Size() > 0)
+	{
+		Build.BackpatchListToHere(jumps);
+		EmitReturn(-1, status);
+	}
+}
+
+//==========================================================================
+//
+// FBehavior :: CompileFunction
+//
+// Returns nullptr if the function cannot be compiled.
+//
+//==========================================================================
+
+VMFunction *FBehavior::CompileFunction (const ScriptFunction *func)
+{
+	if (func->ImportNum != 0 || func->ArgCount > ACSCOMPILE_MAXARGS || func->LocalArrays.Count > 0)
+	{
+		return nullptr;
+	}
+	int entry = int(Ofs2PC(func->Address) - Code.Data());
+	if (entry == 0)
+	{
+		return nullptr;
+	}
+
+	FString name;
+	int funcnum = int(func - Functions);
+	uint32_t *names = (uint32_t *)FindChunk(MAKE_ID('F','N','A','M'));
+	if (names != nullptr && (unsigned)funcnum < LittleLong(names[2]))
+	{
+		name.Format("ACS.%s.%s", ModuleName, (char *)(names + 2) + LittleLong(names[3 + funcnum]));
+	}
+	else
+	{
+		name.Format("ACS.%s.%d", ModuleName, funcnum);
+	}
+
+	FACSCompiler compiler(Code.Data(), func->ArgCount, func->ArgCount + func->LocalCount);
+	VMScriptFunction *sfunc = compiler.Compile(entry, name);
+	DPrintf(DMSG_NOTIFY, "%s %s\n", sfunc != nullptr ? "Compiled" : "Could not compile", name.GetChars());
+	return sfunc;
+}
+
+//==========================================================================
+//
+// CCMD acscompilertest
+//
+// Compiles small functions for the p-codes the compiler supports and
+// checks that they return what the interpreter computes for them,
+// including the instruction count charged to the runaway limit.
+//
+//==========================================================================
+
+static int RunCompiledTest (const int *code, int numargs, int numlocals, const int *args, int &status, int &used)
+{
+	FACSCompiler compiler(code, numargs, numlocals);
+	VMScriptFunction *func = compiler.Compile(1, "ACS.test");
+	if (func == nullptr)
+	{
+		status = -1;
+		return 0;
+	}
+
+	VMValue params[ACSCOMPILE_MAXARGS + 2];
+	int value = 0, remaining = ACSCOMPILE_RUNAWAY;
+	VMReturn ret[3] = { &value, &status, &remaining };
+	params[0] = VMValue((void *)nullptr);
+	for (int i = 0; i < numargs; ++i)
+	{
+		params[i + 1] = args[i];
+	}
+	params[numargs + 1] = (int)ACSCOMPILE_RUNAWAY;
+	VMCall(func, params, numargs + 2, ret, 3);
+	used = ACSCOMPILE_RUNAWAY - remaining;
+	return value;
+}
+
+CCMD (acscompilertest)
+{
+	static const struct
+	{
+		int pcode;
+		const char *name;
+		int (*eval)(int a, int b);
+	} binaryops[] =
+	{
+		{ PCD_EQ,			"EQ",			[](int a, int b) { return int(a == b); } },
+		{ PCD_NE,			"NE",			[](int a, int b) { return int(a != b); } },
+		{ PCD_LT,			"LT",			[](int a, int b) { return int(a < b); } },
+		{ PCD_GT,			"GT",			[](int a, int b) { return int(a > b); } },
+		{ PCD_LE,			"LE",			[](int a, int b) { return int(a <= b); } },
+		{ PCD_GE,			"GE",			[](int a, int b) { return int(a >= b); } },
+		{ PCD_ORLOGICAL,	"ORLOGICAL",	[](int a, int b) { return int(a || b); } },
+		{ PCD_ANDLOGICAL,	"ANDLOGICAL",	[](int a, int b) { return int(a && b); } },
+		{ PCD_ADD,			"ADD",			[](int a, int b) { return a + b; } },
+		{ PCD_SUBTRACT,		"SUBTRACT",		[](int a, int b) { return a - b; } },
+		{ PCD_MULTIPLY,		"MULTIPLY",		[](int a, int b) { return a * b; } },
+		{ PCD_DIVIDE,		"DIVIDE",		[](int a, int b) { return b == 0 ? 0 : a / b; } },
+	};
+	static const int values[] = { -7, -1, 0, 1, 2, 5 };
+	int failed = 0, passed = 0;
+	int status, used;
+
+	auto check = [&](const char *name, int a, int b, int got, int expected, int gotstatus, int expectedstatus, int gotused, int expectedused)
+	{
+		if (got != expected || gotstatus != expectedstatus || gotused != expectedused)
+		{
+			Printf(TEXTCOLOR_RED "%s(%d, %d): got %d status %d used %d, expected %d status %d used %d\n", name, a, b,
+				got, gotstatus, gotused, expected, expectedstatus, expectedused);
+			failed++;
+		}
+		else passed++;
+	};
+
+	// return arg0 <op> arg1
+	for (auto &op : binaryops)
+	{
+		const int code[] = { PCD_NOP, PCD_PUSHSCRIPTVAR, 0, PCD_PUSHSCRIPTVAR, 1, op.pcode, PCD_RETURNVAL };
+		for (int a : values) for (int b : values)
+		{
+			int args[] = { a, b };
+			int got = RunCompiledTest(code, 2, 2, args, status, used);
+			int expectedstatus = (op.pcode == PCD_DIVIDE && b == 0) ? ACSCOMPILE_DivideBy0 : ACSCOMPILE_Ok;
+			// A block is charged in full when it is entered, so the division by 0 counts the return as well.
+			check(op.name, a, b, got, op.eval(a, b), status, expectedstatus, used, 4);
+		}
+	}
+
+	// return !arg0
+	{
+		static const int code[] = { PCD_NOP, PCD_PUSHSCRIPTVAR, 0, PCD_NEGATELOGICAL, PCD_RETURNVAL };
+		for (int a : values)
+		{
+			int got = RunCompiledTest(code, 1, 1, &a, status, used);
+			check("NEGATELOGICAL", a, 0, got, !a, status, ACSCOMPILE_Ok, used, 3);
+		}
+	}
+
+	// for (sum = 0; arg0; arg0--) sum += arg0; return sum;
+	// A negative argument never ends and must be stopped as a runaway.
+	{
+		static const int code[] = { PCD_NOP,
+			PCD_PUSHSCRIPTVAR, 0,		// 1
+			PCD_IFNOTGOTO, 13,			// 3
+			PCD_PUSHSCRIPTVAR, 0,		// 5
+			PCD_ADDSCRIPTVAR, 1,		// 7
+			PCD_DECSCRIPTVAR, 0,		// 9
+			PCD_GOTO, 1,				// 11
+			PCD_PUSHSCRIPTVAR, 1,		// 13
+			PCD_RETURNVAL };			// 15
+		for (int n : { 0, 1, 10, 1000 })
+		{
+			int got = RunCompiledTest(code, 1, 2, &n, status, used);
+			check("loop", n, 0, got, n * (n + 1) / 2, status, ACSCOMPILE_Ok, used, 6 * n + 4);
+		}
+		int n = -1;
+		RunCompiledTest(code, 1, 2, &n, status, used);
+		if (status != ACSCOMPILE_Runaway || used <= ACSCOMPILE_RUNAWAY - 6)
+		{
+			Printf(TEXTCOLOR_RED "endless loop: status %d used %d, expected a runaway\n", status, used);
+			failed++;
+		}
+		else passed++;
+	}
+
+	Printf("%d passed, %d failed\n", passed, failed);
+}
+
 FBehavior::~FBehavior ()
 {
 	if (Scripts != NULL)
@@ -3410,6 +4747,8 @@ void DACSThinker::Serialize(FSerializer &arc)
 }
 
 cycle_t ACSTime;
+static double ACSTotalTime;
+static int ACSTotalTics;
 
 void DACSThinker::Tick ()
 {
@@ -3427,6 +4766,8 @@ void DACSThinker::Tick ()
 //	GlobalACSStrings.Clear();
 
 	ACSTime.Unclock();
+	ACSTotalTime += ACSTime.TimeMS();
+	ACSTotalTics++;
 }
 
 void DACSThinker::StopScriptsFor (AActor *actor)
@@ -6753,28 +8094,16 @@ enum
 };
 
 
-#define NEXTWORD	(LittleLong(*pc++))
-#define NEXTBYTE	(fmt==ACS_LittleEnhanced?getbyte(pc):NEXTWORD)
-#define NEXTSHORT	(fmt==ACS_LittleEnhanced?getshort(pc):NEXTWORD)
+// The code has been expanded to one native endian word per operand by
+// FBehavior::DecodeCode, so every operand is read the same way.
+#define NEXTWORD	(*pc++)
+#define NEXTBYTE	NEXTWORD
+#define NEXTSHORT	NEXTWORD
 #define STACK(a)	(Stack[sp - (a)])
 #define PushToStack(a)	(Stack[sp++] = (a))
 // Direct instructions that take strings need to have the tag applied.
 #define TAGSTR(a)	(a|activeBehavior->GetLibraryID())
 
-inline int getbyte (int *&pc)
-{
-	int res = *(uint8_t *)pc;
-	pc = (int *)((uint8_t *)pc+1);
-	return res;
-}
-
-inline int getshort (int *&pc)
-{
-	int res = LittleShort( *(int16_t *)pc);
-	pc = (int *)((uint8_t *)pc+2);
-	return res;
-}
-
 static bool CharArrayParms(int &capacity, int &offset, int &a, FACSStackMemory& Stack, int &sp, bool ranged)
 {
 	if (ranged)
@@ -6904,19 +8233,7 @@ int DLevelScript::RunScript()
 			break;
 		}
 
-		if (fmt == ACS_LittleEnhanced)
-		{
-			pcd = getbyte(pc);
-			if (pcd >= 256-16)
-			{
-				pcd = (256-16) + ((pcd - (256-16)) << 8) + getbyte(pc);
-			}
-		}
-		else
-		{
-			pcd = NEXTWORD;
-		}
-
+		pcd = NEXTWORD;
 		switch (pcd)
 		{
 		default:
@@ -6941,56 +8258,56 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_PUSHNUMBER:
-			PushToStack (uallong(pc[0]));
+			PushToStack (pc[0]);
 			pc++;
 			break;
 
 		case PCD_PUSHBYTE:
-			PushToStack (*(uint8_t *)pc);
-			pc = (int *)((uint8_t *)pc + 1);
+			PushToStack (pc[0]);
+			pc++;
 			break;
 
 		case PCD_PUSH2BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
+			Stack[sp] = pc[0];
+			Stack[sp+1] = pc[1];
 			sp += 2;
-			pc = (int *)((uint8_t *)pc + 2);
+			pc += 2;
 			break;
 
 		case PCD_PUSH3BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
-			Stack[sp+2] = ((uint8_t *)pc)[2];
+			Stack[sp] = pc[0];
+			Stack[sp+1] = pc[1];
+			Stack[sp+2] = pc[2];
 			sp += 3;
-			pc = (int *)((uint8_t *)pc + 3);
+			pc += 3;
 			break;
 
 		case PCD_PUSH4BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
-			Stack[sp+2] = ((uint8_t *)pc)[2];
-			Stack[sp+3] = ((uint8_t *)pc)[3];
+			Stack[sp] = pc[0];
+			Stack[sp+1] = pc[1];
+			Stack[sp+2] = pc[2];
+			Stack[sp+3] = pc[3];
 			sp += 4;
-			pc = (int *)((uint8_t *)pc + 4);
+			pc += 4;
 			break;
 
 		case PCD_PUSH5BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
-			Stack[sp+2] = ((uint8_t *)pc)[2];
-			Stack[sp+3] = ((uint8_t *)pc)[3];
-			Stack[sp+4] = ((uint8_t *)pc)[4];
+			Stack[sp] = pc[0];
+			Stack[sp+1] = pc[1];
+			Stack[sp+2] = pc[2];
+			Stack[sp+3] = pc[3];
+			Stack[sp+4] = pc[4];
 			sp += 5;
-			pc = (int *)((uint8_t *)pc + 5);
+			pc += 5;
 			break;
 
 		case PCD_PUSHBYTES:
-			temp = *(uint8_t *)pc;
-			pc = (int *)((uint8_t *)pc + temp + 1);
-			for (temp = -temp; temp; temp++)
+			temp = NEXTWORD;
+			for (int i = 0; i < temp; i++)
 			{
-				PushToStack (*((uint8_t *)pc + temp));
+				PushToStack (pc[i]);
 			}
+			pc += temp;
 			break;
 
 		case PCD_DUP:
@@ -7075,79 +8392,79 @@ int DLevelScript::RunScript()
 		case PCD_LSPEC1DIRECT:
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(Level, temp, activationline, activator, backSide,
-								uallong(pc[0]) & specialargmask ,0, 0, 0, 0);
+								pc[0] & specialargmask ,0, 0, 0, 0);
 			pc += 1;
 			break;
 
 		case PCD_LSPEC2DIRECT:
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(Level, temp, activationline, activator, backSide,
-								uallong(pc[0]) & specialargmask,
-								uallong(pc[1]) & specialargmask, 0, 0, 0);
+								pc[0] & specialargmask,
+								pc[1] & specialargmask, 0, 0, 0);
 			pc += 2;
 			break;
 
 		case PCD_LSPEC3DIRECT:
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(Level, temp, activationline, activator, backSide,
-								uallong(pc[0]) & specialargmask,
-								uallong(pc[1]) & specialargmask,
-								uallong(pc[2]) & specialargmask, 0, 0);
+								pc[0] & specialargmask,
+								pc[1] & specialargmask,
+								pc[2] & specialargmask, 0, 0);
 			pc += 3;
 			break;
 
 		case PCD_LSPEC4DIRECT:
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(Level, temp, activationline, activator, backSide,
-								uallong(pc[0]) & specialargmask,
-								uallong(pc[1]) & specialargmask,
-								uallong(pc[2]) & specialargmask,
-								uallong(pc[3]) & specialargmask, 0);
+								pc[0] & specialargmask,
+								pc[1] & specialargmask,
+								pc[2] & specialargmask,
+								pc[3] & specialargmask, 0);
 			pc += 4;
 			break;
 
 		case PCD_LSPEC5DIRECT:
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(Level, temp, activationline, activator, backSide,
-								uallong(pc[0]) & specialargmask,
-								uallong(pc[1]) & specialargmask,
-								uallong(pc[2]) & specialargmask,
-								uallong(pc[3]) & specialargmask,
-								uallong(pc[4]) & specialargmask);
+								pc[0] & specialargmask,
+								pc[1] & specialargmask,
+								pc[2] & specialargmask,
+								pc[3] & specialargmask,
+								pc[4] & specialargmask);
 			pc += 5;
 			break;
 
 		// Parameters for PCD_LSPEC?DIRECTB are by definition bytes so never need and-ing.
 		case PCD_LSPEC1DIRECTB:
-			P_ExecuteSpecial(Level, ((uint8_t *)pc)[0], activationline, activator, backSide,
-				((uint8_t *)pc)[1], 0, 0, 0, 0);
-			pc = (int *)((uint8_t *)pc + 2);
+			P_ExecuteSpecial(Level, pc[0], activationline, activator, backSide,
+				pc[1], 0, 0, 0, 0);
+			pc += 2;
 			break;
 
 		case PCD_LSPEC2DIRECTB:
-			P_ExecuteSpecial(Level, ((uint8_t *)pc)[0], activationline, activator, backSide,
-				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], 0, 0, 0);
-			pc = (int *)((uint8_t *)pc + 3);
+			P_ExecuteSpecial(Level, pc[0], activationline, activator, backSide,
+				pc[1], pc[2], 0, 0, 0);
+			pc += 3;
 			break;
 
 		case PCD_LSPEC3DIRECTB:
-			P_ExecuteSpecial(Level, ((uint8_t *)pc)[0], activationline, activator, backSide,
-				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], ((uint8_t *)pc)[3], 0, 0);
-			pc = (int *)((uint8_t *)pc + 4);
+			P_ExecuteSpecial(Level, pc[0], activationline, activator, backSide,
+				pc[1], pc[2], pc[3], 0, 0);
+			pc += 4;
 			break;
 
 		case PCD_LSPEC4DIRECTB:
-			P_ExecuteSpecial(Level, ((uint8_t *)pc)[0], activationline, activator, backSide,
-				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], ((uint8_t *)pc)[3],
-				((uint8_t *)pc)[4], 0);
-			pc = (int *)((uint8_t *)pc + 5);
+			P_ExecuteSpecial(Level, pc[0], activationline, activator, backSide,
+				pc[1], pc[2], pc[3],
+				pc[4], 0);
+			pc += 5;
 			break;
 
 		case PCD_LSPEC5DIRECTB:
-			P_ExecuteSpecial(Level, ((uint8_t *)pc)[0], activationline, activator, backSide,
-				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], ((uint8_t *)pc)[3],
-				((uint8_t *)pc)[4], ((uint8_t *)pc)[5]);
-			pc = (int *)((uint8_t *)pc + 6);
+			P_ExecuteSpecial(Level, pc[0], activationline, activator, backSide,
+				pc[1], pc[2], pc[3],
+				pc[4], pc[5]);
+			pc += 6;
 			break;
 
 		case PCD_CALLFUNC:
@@ -7198,6 +8515,54 @@ int DLevelScript::RunScript()
 					state = SCRIPT_PleaseRemove;
 					break;
 				}
+				if (func->CallCount >= 0 && acs_compile)
+				{
+					if (func->Compiled == nullptr && ++func->CallCount >= ACSCOMPILE_THRESHOLD)
+					{
+						func->Compiled = module->CompileFunction(func);
+						if (func->Compiled == nullptr) func->CallCount = -1;
+					}
+					if (func->Compiled != nullptr)
+					{
+						VMValue params[ACSCOMPILE_MAXARGS + 2];
+						int budget = ACSCOMPILE_RUNAWAY - int(runaway);
+						int value = 0, status = ACSCOMPILE_Ok, remaining = budget;
+						VMReturn ret[3] = { &value, &status, &remaining };
+
+						params[0] = VMValue((void *)module->MapVars.Pointer());
+						for (i = 0; i < func->ArgCount; ++i)
+						{
+							params[i + 1] = Stack[sp - func->ArgCount + i];
+						}
+						params[func->ArgCount + 1] = budget;
+						VMCall(func->Compiled, params, func->ArgCount + 2, ret, 3);
+						sp -= func->ArgCount;
+
+						// Charge what the function executed as if the interpreter had run it.
+						unsigned int used = unsigned(max(budget - remaining, 0));
+						runaway += used;
+						module->GetFunctionProfileData(func)->AddRun(used);
+
+						if (status == ACSCOMPILE_Runaway)
+						{
+							Printf ("Runaway %s terminated\n", ScriptPresentation(script).GetChars());
+							state = SCRIPT_PleaseRemove;
+						}
+						else if (status == ACSCOMPILE_DivideBy0)
+						{
+							state = SCRIPT_DivideBy0;
+						}
+						else if (status == ACSCOMPILE_ModulusBy0)
+						{
+							state = SCRIPT_ModulusBy0;
+						}
+						else if (pcd != PCD_CALLDISCARD)
+						{
+							PushToStack(value);
+						}
+						break;
+					}
+				}
 				if (sp + func->LocalCount + 64 > STACK_SIZE)
 				{ // 64 is the margin for the function's working space
 					Printf ("Out of stack space in %s\n", ScriptPresentation(script).GetChars());
@@ -8131,7 +9496,7 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_GOTO:
-			pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+			pc = activeBehavior->JumpTarget (*pc);
 			break;
 
 		case PCD_GOTOSTACK:
@@ -8141,7 +9506,7 @@ int DLevelScript::RunScript()
 
 		case PCD_IFGOTO:
 			if (STACK(1))
-				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+				pc = activeBehavior->JumpTarget (*pc);
 			else
 				pc++;
 			sp--;
@@ -8164,7 +9529,7 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_DELAYDIRECT:
-			statedata = uallong(pc[0]) + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
+			statedata = pc[0] + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
 			pc++;
 			if (statedata > 0)
 			{
@@ -8173,12 +9538,12 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_DELAYDIRECTB:
-			statedata = *(uint8_t *)pc + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
+			statedata = pc[0] + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
 			if (statedata > 0)
 			{
 				state = SCRIPT_Delayed;
 			}
-			pc = (int *)((uint8_t *)pc + 1);
+			pc++;
 			break;
 
 		case PCD_RANDOM:
@@ -8187,13 +9552,13 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_RANDOMDIRECT:
-			PushToStack (Random (uallong(pc[0]), uallong(pc[1])));
+			PushToStack (Random (pc[0], pc[1]));
 			pc += 2;
 			break;
 
 		case PCD_RANDOMDIRECTB:
-			PushToStack (Random (((uint8_t *)pc)[0], ((uint8_t *)pc)[1]));
-			pc = (int *)((uint8_t *)pc + 2);
+			PushToStack (Random (pc[0], pc[1]));
+			pc += 2;
 			break;
 
 		case PCD_THINGCOUNT:
@@ -8202,7 +9567,7 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_THINGCOUNTDIRECT:
-			PushToStack (ThingCount (uallong(pc[0]), -1, uallong(pc[1]), -1));
+			PushToStack (ThingCount (pc[0], -1, pc[1], -1));
 			pc += 2;
 			break;
 
@@ -8229,7 +9594,7 @@ int DLevelScript::RunScript()
 
 		case PCD_TAGWAITDIRECT:
 			state = SCRIPT_TagWait;
-			statedata = uallong(pc[0]);
+			statedata = pc[0];
 			pc++;
 			break;
 
@@ -8241,7 +9606,7 @@ int DLevelScript::RunScript()
 
 		case PCD_POLYWAITDIRECT:
 			state = SCRIPT_PolyWait;
-			statedata = uallong(pc[0]);
+			statedata = pc[0];
 			pc++;
 			break;
 
@@ -8251,7 +9616,7 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_CHANGEFLOORDIRECT:
-			ChangeFlat (uallong(pc[0]), TAGSTR(uallong(pc[1])), 0);
+			ChangeFlat (pc[0], TAGSTR(pc[1]), 0);
 			pc += 2;
 			break;
 
@@ -8261,7 +9626,7 @@ int DLevelScript::RunScript()
 			break;
 
 		case PCD_CHANGECEILINGDIRECT:
-			ChangeFlat (uallong(pc[0]), TAGSTR(uallong(pc[1])), 1);
+			ChangeFlat (pc[0], TAGSTR(pc[1]), 1);
 			pc += 2;
 			break;
 
@@ -8326,7 +9691,7 @@ int DLevelScript::RunScript()
 
 		case PCD_IFNOTGOTO:
 			if (!STACK(1))
-				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+				pc = activeBehavior->JumpTarget (*pc);
 			else
 				pc++;
 			sp--;
@@ -8350,7 +9715,7 @@ scriptwait:
 		case PCD_SCRIPTWAITDIRECT:
 			if (!(Level->i_compatflags2 & COMPATF2_SCRIPTWAIT))
 			{
-				statedata = uallong(pc[0]);
+				statedata = pc[0];
 				pc++;
 				goto scriptwait;
 			}
@@ -8358,7 +9723,7 @@ scriptwait:
 			{
 				// Old implementation for compatibility with Daedalus MAP19
 				state = SCRIPT_ScriptWait;
-				statedata = uallong(pc[0]);
+				statedata = pc[0];
 				pc++;
 				PutLast();
 				break;
@@ -8378,9 +9743,9 @@ scriptwait:
 			break;
 
 		case PCD_CASEGOTO:
-			if (STACK(1) == uallong(pc[0]))
+			if (STACK(1) == pc[0])
 			{
-				pc = activeBehavior->Ofs2PC (uallong(pc[1]));
+				pc = activeBehavior->JumpTarget (pc[1]);
 				sp--;
 			}
 			else
@@ -8390,18 +9755,16 @@ scriptwait:
 			break;
 
 		case PCD_CASEGOTOSORTED:
-			// The count and jump table are 4-byte aligned
-			pc = (int *)(((size_t)pc + 3) & ~3);
 			{
-				int numcases = uallong(pc[0]); pc++;
+				int numcases = pc[0]; pc++;
 				int min = 0, max = numcases-1;
 				while (min <= max)
 				{
 					int mid = (min + max) / 2;
-					int32_t caseval = LittleLong(pc[mid*2]);
+					int32_t caseval = pc[mid*2];
 					if (caseval == STACK(1))
 					{
-						pc = activeBehavior->Ofs2PC (LittleLong(pc[mid*2+1]));
+						pc = activeBehavior->JumpTarget (pc[mid*2+1]);
 						sp--;
 						break;
 					}
@@ -8775,7 +10138,7 @@ scriptwait:
 			break;
 
 		case PCD_SETFONTDIRECT:
-			DoSetFont (TAGSTR(uallong(pc[0])));
+			DoSetFont (TAGSTR(pc[0]));
 			pc++;
 			break;
 
@@ -9109,7 +10472,7 @@ scriptwait:
 			break;
 
 		case PCD_SETGRAVITYDIRECT:
-			Level->gravity = ACSToDouble(uallong(pc[0]));
+			Level->gravity = ACSToDouble(pc[0]);
 			pc++;
 			break;
 
@@ -9120,7 +10483,7 @@ scriptwait:
 			break;
 
 		case PCD_SETAIRCONTROLDIRECT:
-			Level->aircontrol = ACSToDouble(uallong(pc[0]));
+			Level->aircontrol = ACSToDouble(pc[0]);
 			pc++;
 			Level->AirControlChanged ();
 			break;
@@ -9131,7 +10494,7 @@ scriptwait:
 			break;
 
 		case PCD_SPAWNDIRECT:
-			PushToStack (DoSpawn (TAGSTR(uallong(pc[0])), uallong(pc[1]), uallong(pc[2]), uallong(pc[3]), uallong(pc[4]), uallong(pc[5]), false));
+			PushToStack (DoSpawn (TAGSTR(pc[0]), pc[1], pc[2], pc[3], pc[4], pc[5], false));
 			pc += 6;
 			break;
 
@@ -9141,7 +10504,7 @@ scriptwait:
 			break;
 
 		case PCD_SPAWNSPOTDIRECT:
-			PushToStack (DoSpawnSpot (TAGSTR(uallong(pc[0])), uallong(pc[1]), uallong(pc[2]), uallong(pc[3]), false));
+			PushToStack (DoSpawnSpot (TAGSTR(pc[0]), pc[1], pc[2], pc[3], false));
 			pc += 4;
 			break;
 
@@ -9202,8 +10565,8 @@ scriptwait:
 
 		case PCD_GIVEINVENTORYDIRECT:
 		{
-			int typeindex = FName(Level->Behaviors.LookupString(TAGSTR(uallong(pc[0])))).GetIndex();
-			ScriptUtil::Exec(NAME_GiveInventory, ScriptUtil::Pointer, activator.Get(), ScriptUtil::Int, typeindex, ScriptUtil::Int, uallong(pc[1]), ScriptUtil::End);
+			int typeindex = FName(Level->Behaviors.LookupString(TAGSTR(pc[0]))).GetIndex();
+			ScriptUtil::Exec(NAME_GiveInventory, ScriptUtil::Pointer, activator.Get(), ScriptUtil::Int, typeindex, ScriptUtil::Int, pc[1], ScriptUtil::End);
 			pc += 2;
 			break;
 		}
@@ -9239,8 +10602,8 @@ scriptwait:
 
 		case PCD_TAKEINVENTORYDIRECT:
 		{
-			int typeindex = FName(Level->Behaviors.LookupString(TAGSTR(uallong(pc[0])))).GetIndex();
-			ScriptUtil::Exec(NAME_TakeInventory, ScriptUtil::Pointer, activator.Get(), ScriptUtil::Int, typeindex, ScriptUtil::Int, uallong(pc[1]), ScriptUtil::End);
+			int typeindex = FName(Level->Behaviors.LookupString(TAGSTR(pc[0]))).GetIndex();
+			ScriptUtil::Exec(NAME_TakeInventory, ScriptUtil::Pointer, activator.Get(), ScriptUtil::Int, typeindex, ScriptUtil::Int, pc[1], ScriptUtil::End);
 			pc += 2;
 			break;
 		}
@@ -9256,7 +10619,7 @@ scriptwait:
 			break;
 
 		case PCD_CHECKINVENTORYDIRECT:
-			PushToStack (CheckInventory (activator, Level->Behaviors.LookupString (TAGSTR(uallong(pc[0]))), false));
+			PushToStack (CheckInventory (activator, Level->Behaviors.LookupString (TAGSTR(pc[0])), false));
 			pc += 1;
 			break;
 
@@ -9361,7 +10724,7 @@ scriptwait:
 			break;
 
 		case PCD_SETMUSICDIRECT:
-			S_ChangeMusic (Level->Behaviors.LookupString (TAGSTR(uallong(pc[0]))), uallong(pc[1]));
+			S_ChangeMusic (Level->Behaviors.LookupString (TAGSTR(pc[0])), pc[1]);
 			pc += 3;
 			break;
 
@@ -9376,7 +10739,7 @@ scriptwait:
 		case PCD_LOCALSETMUSICDIRECT:
 			if (Level->isConsolePlayer(activator))
 			{
-				S_ChangeMusic (Level->Behaviors.LookupString (TAGSTR(uallong(pc[0]))), uallong(pc[1]));
+				S_ChangeMusic (Level->Behaviors.LookupString (TAGSTR(pc[0])), pc[1]);
 			}
 			pc += 3;
 			break;
@@ -10818,6 +12181,27 @@ CCMD(acsprofile)
 	}
 }
 
+//==========================================================================
+//
+// CCMD acstime
+//
+// Prints the time spent running scripts since the last reset. This is
+// what tools/benchmarks/acs uses to compare builds.
+//
+//==========================================================================
+
+CCMD(acstime)
+{
+	if (argv.argc() > 1 && !stricmp(argv[1], "reset"))
+	{
+		ACSTotalTime = 0;
+		ACSTotalTics = 0;
+		return;
+	}
+	Printf("acstime: %d tics, %.3f ms total, %.4f ms/tic\n", ACSTotalTics, ACSTotalTime,
+		ACSTotalTics > 0 ? ACSTotalTime / ACSTotalTics : 0.);
+}
+
 ADD_STAT(ACS)
 {
 	return FStringf("ACS time: %f ms", ACSTime.TimeMS());
@@ -46,6 +46,7 @@ class FFont;
 class FileReader;
 struct line_t;
 class FSerializer;
+class VMFunction;
 
 
 enum
@@ -147,6 +148,7 @@ void P_CollectACSGlobalStrings();
 void P_ReadACSVars(FSerializer &);
 void P_WriteACSVars(FSerializer &);
 void P_ClearACSVars(bool);
+void P_ClearACSCompiledFunctions();
 
 struct ACSProfileInfo
 {
@@ -313,6 +315,8 @@ struct ScriptFunction
 	int  LocalCount;
 	uint32_t Address;
 	ACSLocalArrays LocalArrays;
+	VMFunction *Compiled = nullptr;	// see FBehavior::CompileFunction
+	int CallCount = 0;				// -1 if it cannot be compiled
 };
 
 // Script types
@@ -357,9 +361,10 @@ public:
 	uint8_t *NextChunk (uint8_t *chunk) const;
 	const ScriptPtr *FindScript (int number) const;
 	void StartTypedScripts (uint16_t type, AActor *activator, bool always, int arg1, bool runNow);
-	uint32_t PC2Ofs (int *pc) const { return (uint32_t)((uint8_t *)pc - Data); }
-	int *Ofs2PC (uint32_t ofs) const {	return (int *)(Data + ofs); }
+	uint32_t PC2Ofs (int *pc) const { return CodeOffsets[unsigned(pc - Code.Data())]; }
+	int *Ofs2PC (uint32_t ofs) const { return Code.Data() + (ofs < CodeIndex.Size() ? CodeIndex[ofs] : 0); }
 	int *Jump2PC (uint32_t jumpPoint) const { return Ofs2PC(JumpPoints[jumpPoint]); }
+	int *JumpTarget (int index) const { return Code.Data() + index; }
 	ACSFormat GetFormat() const { return Format; }
 	ScriptFunction *GetFunction (int funcnum, FBehavior *&module) const;
 	int GetArrayVal (int arraynum, int index) const;
@@ -370,7 +375,7 @@ public:
 	int FindMapVarName (const char *varname) const;
 	int FindMapArray (const char *arrayname) const;
 	int GetLibraryID () const { return LibraryID; }
-	int *GetScriptAddress (const ScriptPtr *ptr) const { return (int *)(ptr->Address + Data); }
+	int *GetScriptAddress (const ScriptPtr *ptr) const { return Ofs2PC(ptr->Address); }
 	int GetScriptIndex (const ScriptPtr *ptr) const { ptrdiff_t index = ptr - Scripts; return index >= NumScripts ? -1 : (int)index; }
 	ScriptPtr *GetScriptPtr(int index) const { return index >= 0 && index < NumScripts ? &Scripts[index] : NULL; }
 	int GetLumpNum() const { return LumpNum; }
@@ -379,6 +384,7 @@ public:
 	ACSProfileInfo *GetFunctionProfileData(int index) { return index >= 0 && index < NumFunctions ? &FunctionProfileData[index] : NULL; }
 	ACSProfileInfo *GetFunctionProfileData(ScriptFunction *func) { return GetFunctionProfileData((int)(func - (ScriptFunction *)Functions)); }
 	const char *LookupString (uint32_t index, bool forprint = false) const;
+	VMFunction *CompileFunction (const ScriptFunction *func);
 
 	BoundsCheckingArray<int32_t *, NUM_MAPVARS> MapVars;
 
@@ -410,8 +416,12 @@ private:
 	TArray<FBehavior *> Imports;
 	char ModuleName[9];
 	TArray<int> JumpPoints;
+	TArray<int> Code;				// p-code expanded to one word per opcode and operand
+	TArray<int> CodeIndex;			// offset into Data -> index into Code, 0 if not decoded
+	TArray<uint32_t> CodeOffsets;	// index into Code -> offset into Data
 
 	void LoadScriptsDirectory ();
+	void DecodeCode ();
 
 	static int SortScripts (const void *a, const void *b);
 	void UnencryptStrings ();
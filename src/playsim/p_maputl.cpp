@@ -993,10 +993,10 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 			if (centeronly)
 			{
 				// Block boundaries for compatibility mode
-				double blockleft = (curx * FBlockmap::MAPBLOCKUNITS) + Level->blockmap.bmaporgx;
-				double blockright = blockleft + FBlockmap::MAPBLOCKUNITS;
-				double blockbottom = (cury * FBlockmap::MAPBLOCKUNITS) + Level->blockmap.bmaporgy;
-				double blocktop = blockbottom + FBlockmap::MAPBLOCKUNITS;
+				double blockleft = (curx * Level->blockmap.BlockSize) + Level->blockmap.bmaporgx;
+				double blockright = blockleft + Level->blockmap.BlockSize;
+				double blockbottom = (cury * Level->blockmap.BlockSize) + Level->blockmap.bmaporgy;
+				double blocktop = blockbottom + Level->blockmap.BlockSize;
 
 				// only return actors with the center in this block
 				if (me->X() >= blockleft && me->X() < blockright &&
@@ -1471,13 +1471,13 @@ void FPathTraverse::init(double x1, double y1, double x2, double y2, int flags,
 
 	x1 -= Level->blockmap.bmaporgx;
 	y1 -= Level->blockmap.bmaporgy;
-	xt1 = x1 / FBlockmap::MAPBLOCKUNITS;
-	yt1 = y1 / FBlockmap::MAPBLOCKUNITS;
+	xt1 = x1 / Level->blockmap.BlockSize;
+	yt1 = y1 / Level->blockmap.BlockSize;
 
 	x2 -= Level->blockmap.bmaporgx;
 	y2 -= Level->blockmap.bmaporgy;
-	xt2 = x2 / FBlockmap::MAPBLOCKUNITS;
-	yt2 = y2 / FBlockmap::MAPBLOCKUNITS;
+	xt2 = x2 / Level->blockmap.BlockSize;
+	yt2 = y2 / Level->blockmap.BlockSize;
 
 	mapx = xs_FloorToInt(xt1);
 	mapy = xs_FloorToInt(yt1);
@@ -1702,7 +1702,7 @@ DEFINE_ACTION_FUNCTION_NATIVE(AActor, CheckFov, P_CheckFov)
 // P_RoughMonsterSearch
 //
 // Searches though the surrounding mapblocks for monsters/players
-//		distance is in FBlockmap::MAPBLOCKUNITS
+//		distance is in blocks of FBlockmap::MAPBLOCKUNITS
 //===========================================================================
 
 AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, int, void *), void *params)
@@ -1721,6 +1721,8 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 	int bmapwidth = Level->blockmap.bmapwidth;
 	int bmapheight = Level->blockmap.bmapheight;
 
+	// Keep the search radius the same on a finer blockmap.
+	distance = distance * FBlockmap::MAPBLOCKUNITS / Level->blockmap.BlockSize;
 	startX = Level->blockmap.GetBlockX(mo->X());
 	startY = Level->blockmap.GetBlockY(mo->Y());
 	validcount++;
@@ -603,13 +603,12 @@ bool AActor::SetState (FState *newstate, bool nofunction)
 	return true;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, SetState)
+static int SetState(AActor *self, FState *state, bool nofunction)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_POINTER(state, FState);
-	PARAM_BOOL(nofunction);
-	ACTION_RETURN_BOOL(self->SetState(state, nofunction));
-};
+	return self->SetState(state, nofunction);
+}
+
+DEFINE_ACTION_FUNCTION_AUTO(AActor, SetState, SetState)
 
 
 //============================================================================
@@ -647,12 +646,12 @@ void AActor::DestroyAllInventory ()
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, DestroyAllInventory)
+static void DestroyAllInventory(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
 	self->DestroyAllInventory();
-	return 0;
 }
+
+DEFINE_ACTION_FUNCTION_AUTO(AActor, DestroyAllInventory, DestroyAllInventory)
 //============================================================================
 //
 // AActor :: UseInventory
@@ -736,14 +735,13 @@ AActor *AActor::FindInventory (FName type, bool subclass)
 	return FindInventory(PClass::FindActor(type), subclass);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, FindInventory)
+static AActor *FindInventory(AActor *self, PClassActor *type, bool subclass)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_CLASS(type, AActor);
-	PARAM_BOOL(subclass);
-	ACTION_RETURN_OBJECT(self->FindInventory(type, subclass));
+	return self->FindInventory(type, subclass);
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, FindInventory, FindInventory)
+
 //============================================================================
 //
 // AActor :: GiveInventoryType
@@ -765,13 +763,13 @@ AActor *AActor::GiveInventoryType (PClassActor *type)
 	return nullptr;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, GiveInventoryType)
+static AActor *GiveInventoryType(AActor *self, PClassActor *type)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_CLASS(type, AActor);
-	ACTION_RETURN_OBJECT(self->GiveInventoryType(type));
+	return self->GiveInventoryType(type);
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, GiveInventoryType, GiveInventoryType)
+
 //============================================================================
 //
 // AActor :: ClearInventory
@@ -817,15 +815,12 @@ void AActor::CopyFriendliness (AActor *other, bool changeTarget, bool resetHealt
 	Level->total_monsters += CountsAsKill();
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CopyFriendliness)
+static void CopyFriendliness(AActor *self, AActor *other, bool changetarget, bool resethealth)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_OBJECT_NOT_NULL(other, AActor);
-	PARAM_BOOL(changetarget);
-	PARAM_BOOL(resethealth);
-	self->CopyFriendliness(other, changetarget, resethealth);
-	return 0;
+	self->CopyFriendliness(PARAM_NULLCHECK(other, other), changetarget, resethealth);
 }
+
+DEFINE_ACTION_FUNCTION_AUTO(AActor, CopyFriendliness, CopyFriendliness)
 //---------------------------------------------------------------------------
 //
 // FUNC P_GetRealMaxHealth
@@ -949,14 +944,13 @@ bool P_GiveBody(AActor *actor, int num, int max)
 	return false;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, GiveBody)
+static int GiveBody(AActor *self, int num, int max)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_INT(num);
-	PARAM_INT(max);
-	ACTION_RETURN_BOOL(P_GiveBody(self, num, max));
+	return P_GiveBody(self, num, max);
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, GiveBody, GiveBody)
+
 //============================================================================
 //
 // AActor :: CheckLocalView
@@ -990,13 +984,13 @@ bool AActor::CheckLocalView() const
 	return false;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CheckLocalView)
+static int CheckLocalView(AActor *self, int cp)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_INT(cp);
-	ACTION_RETURN_BOOL(self->CheckLocalView());
+	return self->CheckLocalView();
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, CheckLocalView, CheckLocalView)
+
 //============================================================================
 //
 // AActor :: IsInsideVisibleAngles
@@ -1144,14 +1138,13 @@ void AActor::Touch (AActor *toucher)
 {
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Touch)
+static void Touch(AActor *self, AActor *toucher)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_OBJECT_NOT_NULL(toucher, AActor);
-	self->Touch(toucher);
-	return 0;
+	self->Touch(PARAM_NULLCHECK(toucher, toucher));
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, Touch, Touch)
+
 void AActor::CallTouch(AActor *toucher)
 {
 	IFVIRTUAL(AActor, Touch)
@@ -1301,13 +1294,13 @@ bool AActor::Grind(bool items)
 	return true;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Grind)
+static int Grind(AActor *self, bool items)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_BOOL(items);
-	ACTION_RETURN_BOOL(self->Grind(items));
+	return self->Grind(items);
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, Grind, Grind)
+
 bool AActor::CallGrind(bool items)
 {
 	IFVIRTUAL(AActor, Grind)
@@ -1503,15 +1496,13 @@ void P_ExplodeMissile (AActor *mo, line_t *line, AActor *target, bool onsky, FNa
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, ExplodeMissile)
+static void ExplodeMissile(AActor *self, line_t *line, AActor *target)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_POINTER(line, line_t);
-	PARAM_OBJECT(target, AActor);
 	P_ExplodeMissile(self, line, target);
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, ExplodeMissile, ExplodeMissile)
+
 
 void AActor::PlayBounceSound(bool onfloor)
 {
@@ -1708,13 +1699,13 @@ bool AActor::CanSeek(AActor *target) const
 	return true;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CanSeek)
+static int CanSeek(AActor *self, AActor *target)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_OBJECT_NOT_NULL(target, AActor);
-	ACTION_RETURN_BOOL(self->CanSeek(target));
+	return self->CanSeek(PARAM_NULLCHECK(target, target));
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, CanSeek, CanSeek)
+
 //----------------------------------------------------------------------------
 //
 // FUNC P_SeekerMissile
@@ -2694,14 +2685,12 @@ void P_CheckFakeFloorTriggers (AActor *mo, double oldz, bool oldz_has_viewheight
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CheckFakeFloorTriggers)
+static void CheckFakeFloorTriggers(AActor *self, double oldz, bool oldz_has_viewh)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_FLOAT(oldz);
-	PARAM_BOOL(oldz_has_viewh);
 	P_CheckFakeFloorTriggers(self, oldz, oldz_has_viewh);
-	return 0;
 }
+
+DEFINE_ACTION_FUNCTION_AUTO(AActor, CheckFakeFloorTriggers, CheckFakeFloorTriggers)
 //===========================================================================
 //
 // PlayerLandedOnThing
@@ -2822,15 +2811,13 @@ void AActor::FallAndSink(double grav, double oldfloorz)
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, FallAndSink)
+static void FallAndSink(AActor *self, double grav, double oldfloorz)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_FLOAT(grav);
-	PARAM_FLOAT(oldfloorz);
 	self->FallAndSink(grav, oldfloorz);
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, FallAndSink, FallAndSink)
+
 void AActor::CallFallAndSink(double grav, double oldfloorz)
 {
 	IFVIRTUAL(AActor, FallAndSink)
@@ -3153,13 +3140,13 @@ void AActor::Howl ()
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Howl)
+static void Howl(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
 	self->Howl();
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, Howl, Howl)
+
 bool AActor::Slam (AActor *thing)
 {
 	flags &= ~MF_SKULLFLY;
@@ -3187,13 +3174,13 @@ bool AActor::Slam (AActor *thing)
 	return false;			// stop moving
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Slam)
+static int Slam(AActor *self, AActor *thing)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_OBJECT(thing, AActor);
-	ACTION_RETURN_BOOL(self->Slam(thing));
+	return self->Slam(thing);
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, Slam, Slam)
+
 bool AActor::CallSlam(AActor *thing)
 {
 	IFVIRTUAL(AActor, Slam)
@@ -3317,13 +3304,13 @@ void AActor::PlayActiveSound ()
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, PlayActiveSound)
+static void PlayActiveSound(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
 	self->PlayActiveSound();
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, PlayActiveSound, PlayActiveSound)
+
 bool AActor::IsOkayToAttack (AActor *link)
 {
 	// Standard things to eliminate: an actor shouldn't attack itself,
@@ -3385,14 +3372,13 @@ void AActor::SetShade (int r, int g, int b)
 	fillcolor = MAKEARGB(ColorMatcher.Pick (r, g, b), r, g, b);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, SetShade)
+static void SetShade(AActor *self, int color)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_INT(color);
 	self->SetShade(color);
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, SetShade, SetShade)
+
 // [MC] Helper function for Set(View)Pitch. 
 DAngle AActor::ClampPitch(DAngle p)
 {	
@@ -3587,14 +3573,13 @@ void AActor::CheckPortalTransition(bool islinked)
 	if (islinked && moved) LinkToWorld(&ctx);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CheckPortalTransition)
+static void CheckPortalTransition(AActor *self, bool linked)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_BOOL(linked);
 	self->CheckPortalTransition(linked);
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, CheckPortalTransition, CheckPortalTransition)
+
 //
 // P_MobjThinker
 //
@@ -4215,12 +4200,13 @@ bool AActor::CheckNoDelay()
 	return true;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CheckNoDelay)
+static int CheckNoDelay(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	ACTION_RETURN_BOOL(self->CheckNoDelay());
+	return self->CheckNoDelay();
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, CheckNoDelay, CheckNoDelay)
+
 //==========================================================================
 //
 // AActor :: CheckSectorTransition
@@ -4425,13 +4411,13 @@ bool AActor::UpdateWaterLevel(bool dosplash)
 	return false;	// we did the splash ourselves
 }
 
-DEFINE_ACTION_FUNCTION(AActor, UpdateWaterLevel)
+static int UpdateWaterLevel(AActor *self, bool splash)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_BOOL(splash);
-	ACTION_RETURN_BOOL(self->UpdateWaterLevel(splash));
+	return self->UpdateWaterLevel(splash);
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, UpdateWaterLevel, UpdateWaterLevel)
+
 //==========================================================================
 //
 // P_SpawnMobj
@@ -4637,6 +4623,7 @@ AActor *AActor::StaticSpawn(FLevelLocals *Level, PClassActor *type, const DVecto
 	actor = static_cast<AActor *>(Level->CreateThinker(type));
 
 	ConstructActor(actor, pos, SpawningMapThing);
+	S_PreloadActorSounds(actor);
 	return actor;
 }
 
@@ -4738,13 +4725,13 @@ void AActor::HandleSpawnFlags ()
 	}
 }
 
-DEFINE_ACTION_FUNCTION(AActor, HandleSpawnFlags)
+static void HandleSpawnFlags(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
 	self->HandleSpawnFlags();
-	return 0;
 }
 
+DEFINE_ACTION_FUNCTION_AUTO(AActor, HandleSpawnFlags, HandleSpawnFlags)
+
 void AActor::BeginPlay ()
 {
 	// If the actor is spawned with the dormant flag set, clear it, and use
@@ -103,6 +103,7 @@ CVAR(Bool, sv_singleplayerrespawn, false, CVAR_SERVERINFO | CVAR_CHEAT)
 // Variables for prediction
 CVAR (Bool, cl_noprediction, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR(Bool, cl_predict_specials, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVARD(Bool, cl_predict_remote, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG, "Also predict the other players by repeating their last known input")
 
 CUSTOM_CVAR(Float, cl_predict_lerpscale, 0.05f, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
@@ -133,22 +134,53 @@ struct PredictPos
 } static PredictionLerpFrom, PredictionLerpResult, PredictionLast;
 static int PredictionLerptics;
 
-static player_t PredictionPlayerBackup;
-static AActor *PredictionActor;
-static TArray<uint8_t> PredictionActorBackupArray;
-static TArray<AActor *> PredictionSectorListBackup;
+//==========================================================================
+//
+// Snapshot of a predicted player and its pawn.
+//
+// The pawn is copied with a plain memcpy of everything after its sector
+// links, which is a lot cheaper than going through FSerializer. The
+// sector, portal and blockmap links are kept separately so that their
+// order is exactly the same after restoring. When more than one player
+// is predicted, all snapshots are taken before anything moves and get
+// restored in reverse order.
+//
+//==========================================================================
 
-static TArray<sector_t *> PredictionTouchingSectorsBackup;
-static TArray<msecnode_t *> PredictionTouchingSectors_sprev_Backup;
+struct FPredictionBackup
+{
+	player_t Player;
+	AActor *Actor = nullptr;
+	TArray<uint8_t> ActorData;
+	TArray<AActor *> SectorList;
 
-static TArray<sector_t *> PredictionRenderSectorsBackup;
-static TArray<msecnode_t *> PredictionRenderSectors_sprev_Backup;
+	TArray<sector_t *> TouchingSectors;
+	TArray<msecnode_t *> TouchingSectors_sprev;
 
-static TArray<sector_t *> PredictionPortalSectorsBackup;
-static TArray<msecnode_t *> PredictionPortalSectors_sprev_Backup;
+	TArray<sector_t *> RenderSectors;
+	TArray<msecnode_t *> RenderSectors_sprev;
 
-static TArray<FLinePortal *> PredictionPortalLinesBackup;
-static TArray<portnode_t *> PredictionPortalLines_sprev_Backup;
+	TArray<sector_t *> PortalSectors;
+	TArray<msecnode_t *> PortalSectors_sprev;
+
+	TArray<FLinePortal *> PortalLines;
+	TArray<portnode_t *> PortalLines_sprev;
+
+	// Links of the predicted state, filled in by Unlink
+	FLinkContext Ctx;
+	msecnode_t *SectorPortalList = nullptr;
+	portnode_t *LinePortalList = nullptr;
+
+	void Save(player_t *player);
+	bool Overlaps(const FPredictionBackup &other) const;
+	void Unlink(player_t *player);
+	void Restore(player_t *player);
+};
+
+static FPredictionBackup PredictionBackup;
+static FPredictionBackup RemotePredictionBackup[MAXPLAYERS];
+static int RemotePredicted[MAXPLAYERS];
+static int NumRemotePredicted;
 
 // [GRB] Custom player classes
 TArray<FPlayerClass> PlayerClasses;
@@ -1382,63 +1414,46 @@ nodetype *RestoreNodeList(AActor *act, nodetype *head, nodetype *linktype::*othe
 	return head;
 }
 
-void P_PredictPlayer (player_t *player)
-{
-	int maxtic;
-
-	if (cl_noprediction ||
-		singletics ||
-		demoplayback ||
-		player->mo == NULL ||
-		player != player->mo->Level->GetConsolePlayer() ||
-		player->playerstate != PST_LIVE ||
-		!netgame ||
-		/*player->morphTics ||*/
-		(player->cheats & CF_PREDICTING))
-	{
-		return;
-	}
-
-	maxtic = maketic;
-
-	if (gametic == maxtic)
-	{
-		return;
-	}
+//==========================================================================
+//
+// FPredictionBackup :: Save
+//
+//==========================================================================
 
-	// Save original values for restoration later
-	PredictionPlayerBackup.CopyFrom(*player, false);
+void FPredictionBackup::Save(player_t *player)
+{
+	Player.CopyFrom(*player, false);
 
 	auto act = player->mo;
-	PredictionActor = player->mo;
-	PredictionActorBackupArray.Resize(act->GetClass()->Size);
-	memcpy(PredictionActorBackupArray.Data(), &act->snext, act->GetClass()->Size - ((uint8_t *)&act->snext - (uint8_t *)act));
+	Actor = act;
+	ActorData.Resize(act->GetClass()->Size);
+	memcpy(ActorData.Data(), &act->snext, act->GetClass()->Size - ((uint8_t *)&act->snext - (uint8_t *)act));
 
 	act->flags &= ~MF_PICKUP;
 	act->flags2 &= ~MF2_PUSHWALL;
 	act->renderflags &= ~RF_NOINTERPOLATEVIEW;
 	player->cheats |= CF_PREDICTING;
 
-	BackupNodeList(act, act->touching_sectorlist, &sector_t::touching_thinglist, PredictionTouchingSectors_sprev_Backup, PredictionTouchingSectorsBackup);
-	BackupNodeList(act, act->touching_rendersectors, &sector_t::touching_renderthings, PredictionRenderSectors_sprev_Backup, PredictionRenderSectorsBackup);
-	BackupNodeList(act, act->touching_sectorportallist, &sector_t::sectorportal_thinglist, PredictionPortalSectors_sprev_Backup, PredictionPortalSectorsBackup);
-	BackupNodeList(act, act->touching_lineportallist, &FLinePortal::lineportal_thinglist, PredictionPortalLines_sprev_Backup, PredictionPortalLinesBackup);
+	BackupNodeList(act, act->touching_sectorlist, &sector_t::touching_thinglist, TouchingSectors_sprev, TouchingSectors);
+	BackupNodeList(act, act->touching_rendersectors, &sector_t::touching_renderthings, RenderSectors_sprev, RenderSectors);
+	BackupNodeList(act, act->touching_sectorportallist, &sector_t::sectorportal_thinglist, PortalSectors_sprev, PortalSectors);
+	BackupNodeList(act, act->touching_lineportallist, &FLinePortal::lineportal_thinglist, PortalLines_sprev, PortalLines);
 
 	// Keep an ordered list off all actors in the linked sector.
-	PredictionSectorListBackup.Clear();
+	SectorList.Clear();
 	if (!(act->flags & MF_NOSECTOR))
 	{
 		AActor *link = act->Sector->thinglist;
 		
 		while (link != NULL)
 		{
-			PredictionSectorListBackup.Push(link);
+			SectorList.Push(link);
 			link = link->snext;
 		}
 	}
 
 	// Blockmap ordering also needs to stay the same, so unlink the block nodes
-	// without releasing them. (They will be used again in P_UnpredictPlayer).
+	// without releasing them. (They will be used again in Restore).
 	FBlockNode *block = act->BlockNode;
 
 	while (block != NULL)
@@ -1451,6 +1466,229 @@ void P_PredictPlayer (player_t *player)
 		block = block->NextBlock;
 	}
 	act->BlockNode = NULL;
+}
+
+//==========================================================================
+//
+// FPredictionBackup :: Overlaps
+//
+// Two pawns that share a sector cannot both be predicted because
+// restoring the first one's node lists would need the other one's
+// nodes from before the prediction.
+//
+// Sharing a blockmap block is fine. Save takes the block nodes out of
+// their lists, keeping their neighbour pointers, and the snapshots are
+// restored in the reverse order they were taken. Each Restore therefore
+// sees a block list exactly as it was after its own Save, just like a
+// stack of unlinks being undone.
+//
+//==========================================================================
+
+template<class T> static bool Intersects(const TArray<T> &a, const TArray<T> &b)
+{
+	for (auto x : a)
+	{
+		if (b.Find(x) < b.Size()) return true;
+	}
+	return false;
+}
+
+bool FPredictionBackup::Overlaps(const FPredictionBackup &other) const
+{
+	return Actor->Sector == other.Actor->Sector || Intersects(TouchingSectors, other.TouchingSectors) ||
+		Intersects(RenderSectors, other.RenderSectors) || Intersects(PortalSectors, other.PortalSectors) ||
+		Intersects(PortalLines, other.PortalLines);
+}
+
+//==========================================================================
+//
+// FPredictionBackup :: Unlink
+//
+// Removes the predicted pawn from all lists. This must be done for all
+// predicted players before any of them gets restored.
+//
+//==========================================================================
+
+void FPredictionBackup::Unlink(player_t *player)
+{
+	AActor *act = player->mo;
+
+	// Unlink from all list, including those which are not being handled by UnlinkFromWorld.
+	SectorPortalList = act->touching_sectorportallist;
+	LinePortalList = act->touching_lineportallist;
+	act->touching_sectorportallist = nullptr;
+	act->touching_lineportallist = nullptr;
+
+	Ctx = {};
+	act->UnlinkFromWorld(&Ctx);
+}
+
+//==========================================================================
+//
+// FPredictionBackup :: Restore
+//
+//==========================================================================
+
+void FPredictionBackup::Restore(player_t *player)
+{
+	unsigned int i;
+	AActor *act = player->mo;
+
+	if (act != Actor)
+	{
+		// Q: Can this happen? If yes, can we continue?
+	}
+
+	AActor *savedcamera = player->camera;
+
+	auto &actInvSel = act->PointerVar<AActor*>(NAME_InvSel);
+	auto InvSel = actInvSel;
+	int inventorytics = player->inventorytics;
+	const bool settings_controller = player->settings_controller;
+
+	player->CopyFrom(Player, false);
+
+	player->settings_controller = settings_controller;
+	// Restore the camera instead of using the backup's copy, because spynext/prev
+	// could cause it to change during prediction.
+	player->camera = savedcamera;
+
+	memcpy(&act->snext, ActorData.Data(), ActorData.Size() - ((uint8_t *)&act->snext - (uint8_t *)act));
+
+	// The blockmap ordering needs to remain unchanged, too.
+	// Restore sector links and refrences.
+	// [ED850] This is somewhat of a duplicate of LinkToWorld(), but we need to keep every thing the same,
+	// otherwise we end up fixing bugs in blockmap logic (i.e undefined behaviour with polyobject collisions),
+	// which we really don't want to do here.
+	if (!(act->flags & MF_NOSECTOR))
+	{
+		sector_t *sec = act->Sector;
+		AActor *me, *next;
+		AActor **link;// , **prev;
+
+		// The thinglist is just a pointer chain. We are restoring the exact same things, so we can NULL the head safely
+		sec->thinglist = NULL;
+
+		for (i = SectorList.Size(); i-- > 0;)
+		{
+			me = SectorList[i];
+			link = &sec->thinglist;
+			next = *link;
+			if ((me->snext = next))
+				next->sprev = &me->snext;
+			me->sprev = link;
+			*link = me;
+		}
+
+		act->touching_sectorlist = RestoreNodeList(act, Ctx.sector_list, &sector_t::touching_thinglist, TouchingSectors_sprev, TouchingSectors);
+		act->touching_rendersectors = RestoreNodeList(act, Ctx.render_list, &sector_t::touching_renderthings, RenderSectors_sprev, RenderSectors);
+		act->touching_sectorportallist = RestoreNodeList(act, SectorPortalList, &sector_t::sectorportal_thinglist, PortalSectors_sprev, PortalSectors);
+		act->touching_lineportallist = RestoreNodeList(act, LinePortalList, &FLinePortal::lineportal_thinglist, PortalLines_sprev, PortalLines);
+	}
+
+	// Now fix the pointers in the blocknode chain
+	FBlockNode *block = act->BlockNode;
+
+	while (block != NULL)
+	{
+		*(block->PrevActor) = block;
+		if (block->NextActor != NULL)
+		{
+			block->NextActor->PrevActor = &block->NextActor;
+		}
+		block = block->NextBlock;
+	}
+
+	actInvSel = InvSel;
+	player->inventorytics = inventorytics;
+}
+
+//==========================================================================
+//
+// P_PredictPlayer
+//
+// Runs the local player ahead to the last tic that has been made locally.
+// With cl_predict_remote the other players are run ahead as well, using
+// their last known input for the tics that did not arrive yet.
+//
+//==========================================================================
+
+static bool CanPredict(player_t *player)
+{
+	return player->mo != NULL && player->playerstate == PST_LIVE && !(player->cheats & CF_PREDICTING);
+}
+
+void P_PredictPlayer (player_t *player)
+{
+	int maxtic;
+
+	if (cl_noprediction ||
+		singletics ||
+		demoplayback ||
+		player->mo == NULL ||
+		player != player->mo->Level->GetConsolePlayer() ||
+		!netgame ||
+		/*player->morphTics ||*/
+		!CanPredict(player))
+	{
+		return;
+	}
+
+	maxtic = maketic;
+
+	if (gametic == maxtic)
+	{
+		return;
+	}
+
+	// Save original values for restoration later
+	PredictionBackup.Save(player);
+
+	ticcmd_t remotecmds[MAXPLAYERS];
+	NumRemotePredicted = 0;
+	if (cl_predict_remote)
+	{
+		for (int i = 0; i < MAXPLAYERS; i++)
+		{
+			player_t *other = &players[i];
+			if (!playeringame[i] || other == player || other->Bot != nullptr || !CanPredict(other) || other->mo->Level != player->mo->Level)
+				continue;
+
+			auto &backup = RemotePredictionBackup[i];
+			backup.Save(other);
+
+			bool overlaps = backup.Overlaps(PredictionBackup);
+			for (int j = 0; j < NumRemotePredicted && !overlaps; j++)
+			{
+				overlaps = backup.Overlaps(RemotePredictionBackup[RemotePredicted[j]]);
+			}
+			if (overlaps)
+			{
+				// Nothing has moved yet so this can be undone right away.
+				backup.Unlink(other);
+				backup.Restore(other);
+				continue;
+			}
+			remotecmds[i] = other->cmd;
+			RemotePredicted[NumRemotePredicted++] = i;
+		}
+	}
+	if (NumRemotePredicted > 0)
+	{
+		// Saving took the pawns out of the blockmap, and they would only get back
+		// in once they move, so they could walk through each other. Relink them
+		// the way a move that goes nowhere would. This has to wait until all
+		// snapshots are taken because those remember their neighbours in the blocks.
+		FLinkContext ctx;
+		player->mo->UnlinkFromWorld(&ctx);
+		player->mo->LinkToWorld(&ctx);
+		for (int j = 0; j < NumRemotePredicted; j++)
+		{
+			AActor *mo = players[RemotePredicted[j]].mo;
+			mo->UnlinkFromWorld(&ctx);
+			mo->LinkToWorld(&ctx);
+		}
+	}
 
 	// Values too small to be usable for lerping can be considered "off".
 	bool CanLerp = (!(cl_predict_lerpscale < 0.01f) && (ticdup == 1)), DoLerp = false, NoInterpolateOld = R_GetViewInterpolationStatus();
@@ -1463,6 +1701,14 @@ void P_PredictPlayer (player_t *player)
 		P_PlayerThink (player);
 		player->mo->Tick ();
 
+		for (int j = 0; j < NumRemotePredicted; j++)
+		{
+			player_t *other = &players[RemotePredicted[j]];
+			other->cmd = remotecmds[RemotePredicted[j]];
+			P_PlayerThink (other);
+			other->mo->Tick ();
+		}
+
 		if (CanLerp && PredictionLast.gametic > 0 && i == PredictionLast.gametic && !NoInterpolateOld)
 		{
 			// Z is not compared as lifts will alter this with no apparent change
@@ -1518,84 +1764,20 @@ void P_UnPredictPlayer ()
 
 	if (player->cheats & CF_PREDICTING)
 	{
-		unsigned int i;
-		AActor *act = player->mo;
-
-		if (act != PredictionActor)
+		// All pawns need to be out of the lists before any of them gets relinked,
+		// and the snapshots must be restored in the reverse order they were taken.
+		for (int j = NumRemotePredicted; j-- > 0;)
 		{
-			// Q: Can this happen? If yes, can we continue?
+			RemotePredictionBackup[RemotePredicted[j]].Unlink(&players[RemotePredicted[j]]);
 		}
+		PredictionBackup.Unlink(player);
 
-		AActor *savedcamera = player->camera;
-
-		auto &actInvSel = act->PointerVar<AActor*>(NAME_InvSel);
-		auto InvSel = actInvSel;
-		int inventorytics = player->inventorytics;
-		const bool settings_controller = player->settings_controller;
-
-		player->CopyFrom(PredictionPlayerBackup, false);
-
-		player->settings_controller = settings_controller;
-		// Restore the camera instead of using the backup's copy, because spynext/prev
-		// could cause it to change during prediction.
-		player->camera = savedcamera;
-
-		FLinkContext ctx;
-		// Unlink from all list, including those which are not being handled by UnlinkFromWorld.
-		auto sectorportal_list = act->touching_sectorportallist;
-		auto lineportal_list = act->touching_lineportallist;
-		act->touching_sectorportallist = nullptr;
-		act->touching_lineportallist = nullptr;
-
-		act->UnlinkFromWorld(&ctx);
-		memcpy(&act->snext, PredictionActorBackupArray.Data(), PredictionActorBackupArray.Size() - ((uint8_t *)&act->snext - (uint8_t *)act));
-
-		// The blockmap ordering needs to remain unchanged, too.
-		// Restore sector links and refrences.
-		// [ED850] This is somewhat of a duplicate of LinkToWorld(), but we need to keep every thing the same,
-		// otherwise we end up fixing bugs in blockmap logic (i.e undefined behaviour with polyobject collisions),
-		// which we really don't want to do here.
-		if (!(act->flags & MF_NOSECTOR))
+		for (int j = NumRemotePredicted; j-- > 0;)
 		{
-			sector_t *sec = act->Sector;
-			AActor *me, *next;
-			AActor **link;// , **prev;
-
-			// The thinglist is just a pointer chain. We are restoring the exact same things, so we can NULL the head safely
-			sec->thinglist = NULL;
-
-			for (i = PredictionSectorListBackup.Size(); i-- > 0;)
-			{
-				me = PredictionSectorListBackup[i];
-				link = &sec->thinglist;
-				next = *link;
-				if ((me->snext = next))
-					next->sprev = &me->snext;
-				me->sprev = link;
-				*link = me;
-			}
-
-			act->touching_sectorlist = RestoreNodeList(act, ctx.sector_list, &sector_t::touching_thinglist, PredictionTouchingSectors_sprev_Backup, PredictionTouchingSectorsBackup);
-			act->touching_rendersectors = RestoreNodeList(act, ctx.render_list, &sector_t::touching_renderthings, PredictionRenderSectors_sprev_Backup, PredictionRenderSectorsBackup);
-			act->touching_sectorportallist = RestoreNodeList(act, sectorportal_list, &sector_t::sectorportal_thinglist, PredictionPortalSectors_sprev_Backup, PredictionPortalSectorsBackup);
-			act->touching_lineportallist = RestoreNodeList(act, lineportal_list, &FLinePortal::lineportal_thinglist, PredictionPortalLines_sprev_Backup, PredictionPortalLinesBackup);
-		}
-
-		// Now fix the pointers in the blocknode chain
-		FBlockNode *block = act->BlockNode;
-
-		while (block != NULL)
-		{
-			*(block->PrevActor) = block;
-			if (block->NextActor != NULL)
-			{
-				block->NextActor->PrevActor = &block->NextActor;
-			}
-			block = block->NextBlock;
+			RemotePredictionBackup[RemotePredicted[j]].Restore(&players[RemotePredicted[j]]);
 		}
-
-		actInvSel = InvSel;
-		player->inventorytics = inventorytics;
+		PredictionBackup.Restore(player);
+		NumRemotePredicted = 0;
 	}
 }
 
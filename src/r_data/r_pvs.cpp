@@ -0,0 +1,580 @@
+/*
+** r_pvs.cpp
+** Potentially visible set per subsector
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 agent
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The builder works like a 2D version of the classic portal flow: every
+** two-sided seg is a portal between two subsectors. Starting at each portal
+** of a source subsector, the flow recurses through the portals of the
+** neighbouring subsectors, clipping each one against the separating lines
+** between the current source window and the current pass window.
+** A subsector is potentially visible if any part of one of its portals
+** survives the clipping.
+**
+*/
+
+#include <zlib.h>
+#include "r_pvs.h"
+#include "g_levellocals.h"
+#include "c_cvars.h"
+#include "printf.h"
+#include "i_time.h"
+#include "m_swap.h"
+
+CVAR(Bool, r_pvs, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Int, r_pvs_maxbuild, 4096, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// larger maps only use cached data, as created by 'buildpvs'
+CVAR(Int, r_pvs_maxbuildtime, 100, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// milliseconds the PVS may take to build at map load
+
+//==========================================================================
+//
+// Bit helpers
+//
+//==========================================================================
+
+static void SetBitRange(uint32_t *bits, unsigned start, unsigned count)
+{
+	while (count > 0 && (start & 31))
+	{
+		bits[start >> 5] |= 1u << (start & 31);
+		start++;
+		count--;
+	}
+	while (count >= 32)
+	{
+		bits[start >> 5] = 0xffffffffu;
+		start += 32;
+		count -= 32;
+	}
+	while (count > 0)
+	{
+		bits[start >> 5] |= 1u << (start & 31);
+		start++;
+		count--;
+	}
+}
+
+static void WriteVarInt(TArray<uint8_t> &out, uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		out.Push(uint8_t(v | 0x80));
+		v >>= 7;
+	}
+	out.Push(uint8_t(v));
+}
+
+static uint32_t ReadVarInt(const uint8_t *&p, const uint8_t *end)
+{
+	uint32_t v = 0;
+	for (int shift = 0; p < end && shift < 32; shift += 7)
+	{
+		uint8_t b = *p++;
+		v |= uint32_t(b & 0x7f) << shift;
+		if (!(b & 0x80)) break;
+	}
+	return v;
+}
+
+//==========================================================================
+//
+// The builder
+//
+//==========================================================================
+
+class FPVSBuilder
+{
+	struct FPortal
+	{
+		DVector2 v1, v2;
+		int target;		// subsector on the other side
+		int reverse;	// the same portal seen from the target
+	};
+
+	struct FFlowMemo
+	{
+		int stamp;
+		double t0, t1, s0, s1;
+	};
+
+	enum
+	{
+		MaxSteps = 200000,	// work budget per source subsector before falling back to a flood fill
+		MaxDepth = 1024,
+	};
+
+	static constexpr double EPSILON = 1 / 16.;
+
+	FLevelLocals *Level;
+	TArray<FPortal> Portals;
+	TArray<int> FirstPortal;	// portals of subsector i are [FirstPortal[i], FirstPortal[i+1])
+	TArray<uint32_t> Visible;
+	TArray<FFlowMemo> Memo;
+	TArray<int> FloodStack;
+	int Stamp = 0;
+	int Steps = 0;
+	bool Overflow = false;
+
+	int Origin;		// the source portal of the current flow
+
+	static DVector2 Lerp(const FPortal &p, double t)
+	{
+		return p.v1 + (p.v2 - p.v1) * t;
+	}
+
+	static double PointSide(const DVector2 &a, const DVector2 &b, const DVector2 &p)
+	{
+		return (b.X - a.X) * (p.Y - a.Y) - (b.Y - a.Y) * (p.X - a.X);
+	}
+
+	void MarkVisible(int sub)
+	{
+		Visible[sub >> 5] |= 1u << (sub & 31);
+	}
+
+	bool ClipToSeparators(const DVector2 *src, const DVector2 *pass, const FPortal &target, double &t0, double &t1);
+	void Flow(double s0, double s1, int pass, double p0, double p1, int depth);
+	void Flood(int source);
+
+public:
+	FPVSBuilder(FLevelLocals *l) : Level(l) {}
+	bool CreatePortals();
+	void BuildRow(int source, TArray<uint32_t> &row);
+};
+
+//==========================================================================
+//
+// Every two-sided seg becomes a portal. Since the node builder puts the
+// subsector on the right side of its segs, the target is to the left.
+//
+//==========================================================================
+
+bool FPVSBuilder::CreatePortals()
+{
+	unsigned numsubsectors = Level->subsectors.Size();
+	TArray<int> segportal(Level->segs.Size(), true);
+
+	FirstPortal.Resize(numsubsectors + 1);
+	for (unsigned i = 0; i < numsubsectors; i++)
+	{
+		auto &sub = Level->subsectors[i];
+		FirstPortal[i] = Portals.Size();
+		for (unsigned j = 0; j < sub.numlines; j++)
+		{
+			seg_t *seg = sub.firstline + j;
+			segportal[seg->Index()] = -1;
+			if (seg->linedef != nullptr && seg->backsector == nullptr) continue;	// one-sided walls are the only occluders.
+
+			if (seg->PartnerSeg == nullptr || seg->PartnerSeg->Subsector == nullptr)
+			{
+				// Without the partner we do not know where this leads, so the result cannot be trusted.
+				DPrintf(DMSG_NOTIFY, "PVS: seg %d has no partner\n", seg->Index());
+				return false;
+			}
+			segportal[seg->Index()] = Portals.Size();
+			FPortal &portal = Portals[Portals.Reserve(1)];
+			portal.v1 = seg->v1->fPos();
+			portal.v2 = seg->v2->fPos();
+			portal.target = seg->PartnerSeg->Subsector->Index();
+			portal.reverse = -1;
+		}
+	}
+	FirstPortal[numsubsectors] = Portals.Size();
+
+	for (auto &seg : Level->segs)
+	{
+		int p = segportal[seg.Index()];
+		if (p >= 0) Portals[p].reverse = segportal[seg.PartnerSeg->Index()];
+	}
+
+	Visible.Resize((numsubsectors + 31) / 32);
+	Memo.Resize(Portals.Size());
+	for (auto &m : Memo) m.stamp = 0;
+	return true;
+}
+
+//==========================================================================
+//
+// Clips the target window against the lines that separate the source
+// from the pass window, keeping the part on the side of the pass.
+// In 2D these are the two lines that cross between both windows.
+//
+//==========================================================================
+
+bool FPVSBuilder::ClipToSeparators(const DVector2 *src, const DVector2 *pass, const FPortal &target, double &t0, double &t1)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			const DVector2 &a = src[i];
+			const DVector2 &b = pass[j];
+			double len = (b - a).Length();
+			if (len < EPSILON) continue;
+
+			double srcside = PointSide(a, b, src[i ^ 1]) / len;
+			double passside = PointSide(a, b, pass[j ^ 1]) / len;
+			if (fabs(srcside) < EPSILON || fabs(passside) < EPSILON) continue;
+			if ((srcside > 0) == (passside > 0)) continue;	// not a separator
+
+			double sign = passside > 0 ? 1 : -1;
+			DVector2 p0 = Lerp(target, t0);
+			DVector2 p1 = Lerp(target, t1);
+
+			// Allow some slack so that the result errs on the side of visibility.
+			double d0 = PointSide(a, b, p0) / len * sign + EPSILON;
+			double d1 = PointSide(a, b, p1) / len * sign + EPSILON;
+			if (d0 < 0 && d1 < 0) return false;
+			if (d0 < 0)
+			{
+				t0 = t0 + (t1 - t0) * (d0 / (d0 - d1));
+			}
+			else if (d1 < 0)
+			{
+				t1 = t0 + (t1 - t0) * (d0 / (d0 - d1));
+			}
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Recursive portal flow. [s0, s1] is the remaining window on the origin
+// portal, [p0, p1] the window on the portal that is being passed.
+//
+//==========================================================================
+
+void FPVSBuilder::Flow(double s0, double s1, int pass, double p0, double p1, int depth)
+{
+	if (++Steps > MaxSteps || depth > MaxDepth)
+	{
+		Overflow = true;
+		return;
+	}
+
+	const FPortal &origin = Portals[Origin];
+	const FPortal &passportal = Portals[pass];
+	DVector2 srcpts[2] = { Lerp(origin, s0), Lerp(origin, s1) };
+	DVector2 passpts[2] = { Lerp(passportal, p0), Lerp(passportal, p1) };
+
+	int leaf = passportal.target;
+	for (int t = FirstPortal[leaf]; t < FirstPortal[leaf + 1]; t++)
+	{
+		if (t == passportal.reverse) continue;
+
+		const FPortal &target = Portals[t];
+		double t0 = 0, t1 = 1;
+		if (!ClipToSeparators(srcpts, passpts, target, t0, t1)) continue;
+		MarkVisible(target.target);
+
+		// Narrow the source window to what can still see the clipped target.
+		DVector2 targetpts[2] = { Lerp(target, t0), Lerp(target, t1) };
+		double ns0 = s0, ns1 = s1;
+		if (!ClipToSeparators(targetpts, passpts, origin, ns0, ns1)) continue;
+
+		// If a wider pair of windows was already followed through this portal nothing new can be found.
+		FFlowMemo &memo = Memo[t];
+		if (memo.stamp == Stamp && t0 >= memo.t0 && t1 <= memo.t1 && ns0 >= memo.s0 && ns1 <= memo.s1) continue;
+		memo = { Stamp, t0, t1, ns0, ns1 };
+
+		Flow(ns0, ns1, t, t0, t1, depth + 1);
+		if (Overflow) return;
+	}
+}
+
+//==========================================================================
+//
+// Fallback if the flow exceeds its budget: everything that is connected
+// is considered visible.
+//
+//==========================================================================
+
+void FPVSBuilder::Flood(int source)
+{
+	TArray<uint32_t> done(Visible.Size(), true);
+	memset(done.Data(), 0, done.Size() * sizeof(uint32_t));
+
+	FloodStack.Clear();
+	FloodStack.Push(source);
+	done[source >> 5] |= 1u << (source & 31);
+	while (FloodStack.Size() > 0)
+	{
+		int sub;
+		FloodStack.Pop(sub);
+		MarkVisible(sub);
+		for (int p = FirstPortal[sub]; p < FirstPortal[sub + 1]; p++)
+		{
+			int target = Portals[p].target;
+			if (!(done[target >> 5] & (1u << (target & 31))))
+			{
+				done[target >> 5] |= 1u << (target & 31);
+				FloodStack.Push(target);
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FPVSBuilder::BuildRow(int source, TArray<uint32_t> &row)
+{
+	memset(Visible.Data(), 0, Visible.Size() * sizeof(uint32_t));
+	MarkVisible(source);
+	Steps = 0;
+	Overflow = false;
+
+	for (int p = FirstPortal[source]; p < FirstPortal[source + 1] && !Overflow; p++)
+	{
+		// Everything directly adjacent to the neighbours is visible as well because subsectors are convex.
+		const FPortal &portal = Portals[p];
+		MarkVisible(portal.target);
+		Origin = p;
+		Stamp++;
+		for (int t = FirstPortal[portal.target]; t < FirstPortal[portal.target + 1] && !Overflow; t++)
+		{
+			if (t == portal.reverse) continue;
+			MarkVisible(Portals[t].target);
+			Flow(0, 1, t, 0, 1, 0);
+		}
+	}
+	if (Overflow)
+	{
+		Flood(source);
+	}
+	row = Visible;
+}
+
+//==========================================================================
+//
+// FSubsectorPVS
+//
+//==========================================================================
+
+void FSubsectorPVS::Clear()
+{
+	NumSubsectors = 0;
+	RowOffsets.Reset();
+	RowData.Reset();
+	VisibleSubsectors.Reset();
+	VisibleNodes.Reset();
+	ViewSubsector = -1;
+}
+
+//==========================================================================
+//
+// Builds the visibility data for all subsectors of the level.
+// Returns false if the level's nodes are not suitable or if it takes
+// longer than maxtime milliseconds. 0 means no limit.
+//
+//==========================================================================
+
+bool FSubsectorPVS::Build(FLevelLocals *Level, int maxtime)
+{
+	Clear();
+	if (Level->nodes.Size() == 0 || Level->linePortals.Size() > 0)
+	{
+		// Line portals let the view pass through one-sided walls.
+		return false;
+	}
+
+	uint64_t starttime = I_msTime();
+	FPVSBuilder builder(Level);
+	if (!builder.CreatePortals()) return false;
+
+	unsigned numsubsectors = Level->subsectors.Size();
+	TArray<uint32_t> row;
+	RowOffsets.Resize(numsubsectors);
+	for (unsigned i = 0; i < numsubsectors; i++)
+	{
+		if (maxtime > 0 && I_msTime() - starttime > (uint64_t)maxtime)
+		{
+			DPrintf(DMSG_NOTIFY, "PVS generation aborted after %u of %u subsectors\n", i, numsubsectors);
+			Clear();
+			return false;
+		}
+		builder.BuildRow(i, row);
+		RowOffsets[i] = RowData.Size();
+
+		// Run length encode alternating runs of invisible and visible subsectors.
+		bool state = false;
+		uint32_t run = 0;
+		for (unsigned j = 0; j < numsubsectors; j++)
+		{
+			bool bit = !!(row[j >> 5] & (1u << (j & 31)));
+			if (bit != state)
+			{
+				WriteVarInt(RowData, run);
+				state = bit;
+				run = 0;
+			}
+			run++;
+		}
+		WriteVarInt(RowData, run);
+	}
+	RowData.ShrinkToFit();
+	NumSubsectors = numsubsectors;
+	DPrintf(DMSG_NOTIFY, "PVS generation took %.3f sec (%u subsectors, %u bytes)\n", (I_msTime() - starttime) * 0.001, numsubsectors, RowData.Size());
+	return true;
+}
+
+//==========================================================================
+//
+// Hash over the subsector layout so that cached data is only used for
+// the exact same set of nodes.
+//
+//==========================================================================
+
+uint32_t FSubsectorPVS::LayoutHash(FLevelLocals *Level)
+{
+	uint32_t hash = crc32(0, nullptr, 0);
+	for (auto &sub : Level->subsectors)
+	{
+		uint32_t data[2] = { LittleLong(uint32_t(sub.firstline->Index())), LittleLong(sub.numlines) };
+		hash = crc32(hash, (const Bytef *)data, sizeof(data));
+	}
+	return hash;
+}
+
+void FSubsectorPVS::Serialize(TArray<uint8_t> &out) const
+{
+	out.Clear();
+	WriteVarInt(out, NumSubsectors);
+	for (auto ofs : RowOffsets)
+	{
+		WriteVarInt(out, ofs);
+	}
+	WriteVarInt(out, RowData.Size());
+	out.Append(RowData);
+}
+
+bool FSubsectorPVS::Deserialize(FLevelLocals *Level, const uint8_t *data, size_t len)
+{
+	Clear();
+	const uint8_t *p = data, *end = data + len;
+	unsigned numsubsectors = ReadVarInt(p, end);
+	if (numsubsectors != Level->subsectors.Size()) return false;
+
+	RowOffsets.Resize(numsubsectors);
+	for (auto &ofs : RowOffsets)
+	{
+		ofs = ReadVarInt(p, end);
+	}
+	unsigned datasize = ReadVarInt(p, end);
+	if (p + datasize != end)
+	{
+		RowOffsets.Reset();
+		return false;
+	}
+	for (auto ofs : RowOffsets)
+	{
+		// Every row has at least one run, so it must start inside the data.
+		if (ofs >= datasize)
+		{
+			RowOffsets.Reset();
+			return false;
+		}
+	}
+	RowData.Resize(datasize);
+	memcpy(RowData.Data(), p, datasize);
+	NumSubsectors = numsubsectors;
+	return true;
+}
+
+//==========================================================================
+//
+// Flags every node that has a visible subsector below it.
+//
+//==========================================================================
+
+bool FSubsectorPVS::MarkNodes(FLevelLocals *Level, void *node)
+{
+	if ((size_t)node & 1)
+	{
+		return IsSubsectorVisible(((subsector_t *)((uint8_t *)node - 1))->Index());
+	}
+	node_t *bsp = (node_t *)node;
+	bool front = MarkNodes(Level, bsp->children[0]);
+	bool back = MarkNodes(Level, bsp->children[1]);
+	if (!front && !back) return false;
+
+	int index = bsp->Index();
+	VisibleNodes[index >> 5] |= 1u << (index & 31);
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FSubsectorPVS::SetViewpoint(FLevelLocals *Level, const DVector2 &pos)
+{
+	if (!IsValid()) return false;
+
+	// The BSP cell of a subsector extends beyond its walls, but the data is only valid inside them.
+	subsector_t *sub = Level->PointInRenderSubsector(pos);
+	for (unsigned i = 0; i < sub->numlines; i++)
+	{
+		seg_t *seg = sub->firstline + i;
+		DVector2 v1 = seg->v1->fPos();
+		DVector2 delta = seg->v2->fPos() - v1;
+		double side = delta.X * (pos.Y - v1.Y) - delta.Y * (pos.X - v1.X);
+		if (side > delta.Length()) return false;
+	}
+
+	int index = sub->Index();
+	if (index != ViewSubsector)
+	{
+		VisibleSubsectors.Resize((NumSubsectors + 31) / 32);
+		VisibleNodes.Resize((Level->nodes.Size() + 31) / 32);
+		memset(VisibleSubsectors.Data(), 0, VisibleSubsectors.Size() * sizeof(uint32_t));
+		memset(VisibleNodes.Data(), 0, VisibleNodes.Size() * sizeof(uint32_t));
+
+		const uint8_t *p = RowData.Data() + RowOffsets[index];
+		const uint8_t *end = RowData.Data() + RowData.Size();
+		bool state = false;
+		unsigned count = 0;
+		while (count < NumSubsectors && p < end)
+		{
+			unsigned run = min<unsigned>(ReadVarInt(p, end), NumSubsectors - count);
+			if (state) SetBitRange(VisibleSubsectors.Data(), count, run);
+			count += run;
+			state = !state;
+		}
+		MarkNodes(Level, Level->HeadNode());
+		ViewSubsector = index;
+	}
+	return true;
+}
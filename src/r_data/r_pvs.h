@@ -0,0 +1,58 @@
+
+#ifndef __R_PVS_H
+#define __R_PVS_H
+
+#include "tarray.h"
+#include "vectors.h"
+
+struct FLevelLocals;
+struct subsector_t;
+
+//==========================================================================
+//
+// Potentially visible set per subsector.
+//
+// Only one-sided walls are treated as occluders so the data remains valid
+// no matter how the sectors move. Rows are stored run length encoded and
+// the row for the view's subsector gets unpacked once it changes, along
+// with a per-node summary that lets the renderers skip entire branches.
+//
+//==========================================================================
+
+class FSubsectorPVS
+{
+public:
+	void Clear();
+	bool IsValid() const { return NumSubsectors > 0; }
+
+	bool Build(FLevelLocals *Level, int maxtime = 0);
+	void Serialize(TArray<uint8_t> &out) const;
+	bool Deserialize(FLevelLocals *Level, const uint8_t *data, size_t len);
+	static uint32_t LayoutHash(FLevelLocals *Level);
+
+	// Selects the row for the given view position. Returns false if the position is not inside a subsector.
+	bool SetViewpoint(FLevelLocals *Level, const DVector2 &pos);
+
+	bool IsSubsectorVisible(int index) const
+	{
+		return !!(VisibleSubsectors[index >> 5] & (1u << (index & 31)));
+	}
+
+	bool IsNodeVisible(int index) const
+	{
+		return !!(VisibleNodes[index >> 5] & (1u << (index & 31)));
+	}
+
+private:
+	bool MarkNodes(FLevelLocals *Level, void *node);
+
+	unsigned NumSubsectors = 0;
+	TArray<uint32_t> RowOffsets;
+	TArray<uint8_t> RowData;
+
+	int ViewSubsector = -1;
+	TArray<uint32_t> VisibleSubsectors;
+	TArray<uint32_t> VisibleNodes;
+};
+
+#endif
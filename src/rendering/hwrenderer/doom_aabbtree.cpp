@@ -22,8 +22,10 @@
 
 
 
+#include <zlib.h>
 #include "doom_aabbtree.h"
 #include "g_levellocals.h"
+#include "m_swap.h"
 
 using namespace hwrenderer;
 
@@ -64,7 +66,12 @@ DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev)
 		nodes.Push({ aabb_min, aabb_max, staticroot, dynamicroot });
 	}
 
-	// Add the lines referenced by the leaf nodes
+	CreateTreeLines();
+}
+
+// Add the lines referenced by the leaf nodes
+void DoomLevelAABBTree::CreateTreeLines()
+{
 	treelines.Resize(mapLines.Size());
 	for (unsigned int i = 0; i < mapLines.Size(); i++)
 	{
@@ -78,6 +85,122 @@ DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev)
 	}
 }
 
+// Everything the tree depends on: the line positions and which lines get added to which subtree.
+uint32_t DoomLevelAABBTree::LayoutHash(FLevelLocals *lev)
+{
+	uint32_t hash = crc32(0, nullptr, 0);
+	for (auto &line : lev->lines)
+	{
+		float coords[4] = { (float)line.v1->fX(), (float)line.v1->fY(), (float)line.v2->fX(), (float)line.v2->fY() };
+		uint32_t data[5];
+		memcpy(data, coords, sizeof(coords));
+		for (int i = 0; i < 4; i++) data[i] = LittleLong(data[i]);
+		data[4] = LittleLong(uint32_t((line.backsector ? 1 : 0) | (line.sidedef[0] && (line.sidedef[0]->Flags & WALLF_POLYOBJ) ? 2 : 0)));
+		hash = crc32(hash, (const Bytef *)data, sizeof(data));
+	}
+	return hash;
+}
+
+void DoomLevelAABBTree::Serialize(TArray<uint8_t> &out) const
+{
+	auto write = [&](uint32_t value)
+	{
+		value = LittleLong(value);
+		memcpy(&out[out.Reserve(4)], &value, 4);
+	};
+	auto writefloat = [&](float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, 4);
+		write(bits);
+	};
+
+	out.Clear();
+	out.Grow(16 + nodes.Size() * 28 + mapLines.Size() * 4);
+	write(nodes.Size());
+	write(mapLines.Size());
+	write(dynamicStartNode);
+	write(dynamicStartLine);
+	for (auto &node : nodes)
+	{
+		writefloat(node.aabb_left);
+		writefloat(node.aabb_top);
+		writefloat(node.aabb_right);
+		writefloat(node.aabb_bottom);
+		write(node.left_node);
+		write(node.right_node);
+		write(node.line_index);
+	}
+	for (auto line : mapLines)
+	{
+		write(line);
+	}
+}
+
+DoomLevelAABBTree *DoomLevelAABBTree::Deserialize(FLevelLocals *lev, const uint8_t *data, size_t len)
+{
+	const uint8_t *end = data + len;
+	auto read = [&]()
+	{
+		uint32_t value;
+		memcpy(&value, data, 4);
+		data += 4;
+		return LittleLong(value);
+	};
+	auto readfloat = [&]()
+	{
+		uint32_t bits = read();
+		float value;
+		memcpy(&value, &bits, 4);
+		return value;
+	};
+
+	if (len < 16) return nullptr;
+	unsigned numnodes = read();
+	unsigned numlines = read();
+	unsigned startnode = read();
+	unsigned startline = read();
+	if (size_t(end - data) != numnodes * size_t(28) + numlines * size_t(4) || startnode > numnodes || startline > numlines)
+		return nullptr;
+
+	auto tree = new DoomLevelAABBTree;
+	tree->Level = lev;
+	tree->dynamicStartNode = startnode;
+	tree->dynamicStartLine = startline;
+	tree->nodes.Grow(numnodes);
+	for (unsigned i = 0; i < numnodes; i++)
+	{
+		FVector2 aabb_min, aabb_max;
+		aabb_min.X = readfloat();
+		aabb_min.Y = readfloat();
+		aabb_max.X = readfloat();
+		aabb_max.Y = readfloat();
+		int left = read();
+		int right = read();
+		int line = read();
+		// Children are always created before their parent.
+		bool valid = line == -1 ? (unsigned)left < i && (unsigned)right < i : left == -1 && right == -1 && (unsigned)line < numlines;
+		if (!valid)
+		{
+			delete tree;
+			return nullptr;
+		}
+		tree->nodes.Push(line == -1 ? AABBTreeNode(aabb_min, aabb_max, left, right) : AABBTreeNode(aabb_min, aabb_max, line));
+	}
+	tree->mapLines.Resize(numlines);
+	for (auto &line : tree->mapLines)
+	{
+		line = read();
+		if ((unsigned)line >= lev->lines.Size())
+		{
+			delete tree;
+			return nullptr;
+		}
+	}
+	tree->CreateTreeLines();
+	return tree;
+}
+
 bool DoomLevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree)
 {
 	// Create a list of level lines we want to add:
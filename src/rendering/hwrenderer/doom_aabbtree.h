@@ -11,7 +11,14 @@ public:
 	DoomLevelAABBTree(FLevelLocals *lev);
 	bool Update() override;
 
+	// Node cache support. Deserialize returns nullptr if the data does not fit the level.
+	void Serialize(TArray<uint8_t> &out) const;
+	static DoomLevelAABBTree *Deserialize(FLevelLocals *lev, const uint8_t *data, size_t len);
+	static uint32_t LayoutHash(FLevelLocals *lev);
+
 private:
+	DoomLevelAABBTree() = default;
+	void CreateTreeLines();
 	bool GenerateTree(const FVector2 *centroids, bool dynamicsubtree);
 
 	// Generate a tree node and its children recursively
@@ -257,6 +257,49 @@ void DoWriteSavePic(FileWriter* file, ESSType ssformat, uint8_t* scr, int width,
 	M_CreatePNG(file, scr, ssformat == SS_PAL ? palette : nullptr, ssformat, width, height, pitch, vid_gamma);
 }
 
+//===========================================================================
+//
+// Renders a camera's view into the offscreen save buffers and copies
+// the result to an RGB buffer of width * height * 3 bytes.
+//
+//===========================================================================
+
+sector_t* RenderOffscreenView(AActor* camera, int width, int height, float fov, float ratio, float fovratio, uint8_t* scr)
+{
+	IntRect bounds;
+	bounds.left = 0;
+	bounds.top = 0;
+	bounds.width = width;
+	bounds.height = height;
+	auto& RenderState = *screen->RenderState();
+
+	// we must be sure the GPU finished reading from the buffer before we fill it with new data.
+	screen->WaitForCommands(false);
+
+	// Switch to render buffers dimensioned for the savepic
+	screen->SetSaveBuffers(true);
+	screen->ImageTransitionScene(true);
+
+	hw_ClearFakeFlat();
+	screen->mVertexData->Reset();
+	RenderState.SetVertexBuffer(screen->mVertexData);
+	screen->mLights->Clear();
+	screen->mViewpoints->Clear();
+
+	// This shouldn't overwrite the global viewpoint even for a short time.
+	FRenderViewpoint savevp;
+	sector_t* viewsector = RenderViewpoint(savevp, camera, &bounds, fov, ratio, fovratio, true, false);
+	RenderState.EnableStencil(false);
+	RenderState.SetNoSoftLightLevel();
+
+	screen->CopyScreenToBuffer(width, height, scr);
+
+	// Switch back the screen render buffers
+	screen->SetViewportRects(nullptr);
+	screen->SetSaveBuffers(false);
+	return viewsector;
+}
+
 //===========================================================================
 //
 // Render the view to a savegame picture
@@ -271,42 +314,12 @@ void WriteSavePic(player_t* player, FileWriter* file, int width, int height)
 	}
 	else
 	{
-		IntRect bounds;
-		bounds.left = 0;
-		bounds.top = 0;
-		bounds.width = width;
-		bounds.height = height;
-		auto& RenderState = *screen->RenderState();
-
-		// we must be sure the GPU finished reading from the buffer before we fill it with new data.
-		screen->WaitForCommands(false);
-
-		// Switch to render buffers dimensioned for the savepic
-		screen->SetSaveBuffers(true);
-		screen->ImageTransitionScene(true);
-
-		hw_ClearFakeFlat();
-		screen->mVertexData->Reset();
-		RenderState.SetVertexBuffer(screen->mVertexData);
-		screen->mLights->Clear();
-		screen->mViewpoints->Clear();
-
-		// This shouldn't overwrite the global viewpoint even for a short time.
-		FRenderViewpoint savevp;
-		sector_t* viewsector = RenderViewpoint(savevp, players[consoleplayer].camera, &bounds, r_viewpoint.FieldOfView.Degrees, 1.6f, 1.6f, true, false);
-		RenderState.EnableStencil(false);
-		RenderState.SetNoSoftLightLevel();
-
 		int numpixels = width * height;
 		uint8_t* scr = (uint8_t*)M_Malloc(numpixels * 3);
-		screen->CopyScreenToBuffer(width, height, scr);
+		sector_t* viewsector = RenderOffscreenView(players[consoleplayer].camera, width, height, r_viewpoint.FieldOfView.Degrees, 1.6f, 1.6f, scr);
 
 		DoWriteSavePic(file, SS_RGB, scr, width, height, viewsector, screen->FlipSavePic());
 		M_Free(scr);
-
-		// Switch back the screen render buffers
-		screen->SetViewportRects(nullptr);
-		screen->SetSaveBuffers(false);
 	}
 }
 
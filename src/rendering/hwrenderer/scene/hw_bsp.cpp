@@ -338,6 +338,7 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 	if (ispoly || seg->linedef->validcount!=validcount) 
 	{
 		if (!ispoly) seg->linedef->validcount=validcount;
+		if (useocclusion && !ispoly) Occlusion.AddSeg(seg);
 
 		if (gl_render_walls)
 		{
@@ -810,6 +811,9 @@ void HWDrawInfo::RenderBSPNode (void *node)
 	{
 		node_t *bsp = (node_t *)node;
 
+		// Nothing below this node can be seen from the view's subsector.
+		if (usepvs && !Level->pvs.IsNodeVisible(bsp->Index())) return;
+
 		// Decide which side the view point is on.
 		int side = R_PointOnSide(viewx, viewy, bsp);
 
@@ -825,10 +829,16 @@ void HWDrawInfo::RenderBSPNode (void *node)
 			if (!(no_renderflags[bsp->Index()] & SSRF_SEEN))
 				return;
 		}
+		else if (useocclusion && Occlusion.IsNodeChildOccluded(bsp, side))
+		{
+			return;
+		}
 
 		node = bsp->children[side];
 	}
-	DoSubsector ((subsector_t *)((uint8_t *)node - 1));
+	auto sub = (subsector_t *)((uint8_t *)node - 1);
+	if (usepvs && !Level->pvs.IsSubsectorVisible(sub->Index())) return;
+	DoSubsector (sub);
 }
 
 void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
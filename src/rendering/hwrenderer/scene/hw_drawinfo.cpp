@@ -54,6 +54,8 @@ CVAR(Int, gl_enhanced_nv_stealth, 3, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 CVAR(Bool, gl_texture, true, 0)
 CVAR(Float, gl_mask_threshold, 0.5f, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 CVAR(Float, gl_mask_sprite_threshold, 0.5f, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Bool, r_pvs)
+EXTERN_CVAR(Bool, gl_occlusion_cull)
 
 sector_t * hw_FakeFlat(sector_t * sec, sector_t * dest, area_t in_area, bool back);
 
@@ -435,6 +437,10 @@ void HWDrawInfo::CreateScene(bool drawpsprites)
 	// reset the portal manager
 	portalState.StartFrame();
 
+	usepvs = r_pvs && mCurrentPortal == nullptr && Level->pvs.SetViewpoint(Level, vp.Pos.XY());
+	useocclusion = gl_occlusion_cull && mCurrentPortal == nullptr;
+	if (useocclusion) Occlusion.Begin(this);
+
 	ProcessAll.Clock();
 
 	// clip the scene and fill the drawlists
@@ -478,11 +484,11 @@ void HWDrawInfo::RenderScene(FRenderState &state)
 
 	if (gl_sort_textures)
 	{
-		drawlists[GLDL_PLAINWALLS].SortWalls();
-		drawlists[GLDL_PLAINFLATS].SortFlats();
-		drawlists[GLDL_MASKEDWALLS].SortWalls();
-		drawlists[GLDL_MASKEDFLATS].SortFlats();
-		drawlists[GLDL_MASKEDWALLSOFS].SortWalls();
+		drawlists[GLDL_PLAINWALLS].SortWalls(this);
+		drawlists[GLDL_PLAINFLATS].SortFlats(this);
+		drawlists[GLDL_MASKEDWALLS].SortWalls(this);
+		drawlists[GLDL_MASKEDFLATS].SortFlats(this);
+		drawlists[GLDL_MASKEDWALLSOFS].SortWalls(this);
 	}
 
 	// Part 1: solid geometry. This is set up so that there are no transparent parts
@@ -9,6 +9,7 @@
 #include "v_video.h"
 #include "hw_weapon.h"
 #include "hw_drawlist.h"
+#include "hw_occlusion.h"
 
 enum EDrawMode
 {
@@ -178,6 +179,9 @@ struct HWDrawInfo
 	area_t	in_area;
 	fixed_t viewx, viewy;	// since the nodes are still fixed point, keeping the view position  also fixed point for node traversal is faster.
 	bool multithread;
+	bool usepvs;	// only for the main view, portals see the level from elsewhere.
+	bool useocclusion;
+	HWOcclusionBuffer Occlusion;
 
 private:
     // For ProcessLowerMiniseg
@@ -341,6 +345,7 @@ public:
 
 void CleanSWDrawer();
 sector_t* RenderViewpoint(FRenderViewpoint& mainvp, AActor* camera, IntRect* bounds, float fov, float ratio, float fovratio, bool mainview, bool toscreen);
+sector_t* RenderOffscreenView(AActor* camera, int width, int height, float fov, float ratio, float fovratio, uint8_t* scr);
 void WriteSavePic(player_t* player, FileWriter* file, int width, int height);
 sector_t* RenderView(player_t* player);
 
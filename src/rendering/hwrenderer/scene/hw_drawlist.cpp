@@ -38,6 +38,8 @@
 #include "hw_drawinfo.h"
 #include "hw_fakeflat.h"
 
+CVAR(Bool, gl_sprite_batching, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 FMemArena RenderDataAllocator(1024*1024);	// Use large blocks to reduce allocation time.
 
 void ResetRenderDataAllocator()
@@ -73,6 +75,76 @@ SortNode * StaticSortNodeArray::GetNew()
 
 static StaticSortNodeArray SortNodes;
 
+//==========================================================================
+//
+// Stable LSD radix sort on 64 bit keys. Passes in which all keys have
+// the same digit are skipped, which is the common case for the upper bits.
+//
+//==========================================================================
+
+template<class T>
+static void RadixSort(TArray<uint64_t> &keys, TArray<T> &items)
+{
+	static TArray<uint64_t> tempkeys;
+	static TArray<T> tempitems;
+	unsigned count = keys.Size();
+	if (count < 2) return;
+
+	unsigned histogram[8][256] = {};
+	for (auto key : keys)
+	{
+		for (int d = 0; d < 8; d++) histogram[d][(key >> (d * 8)) & 255]++;
+	}
+
+	tempkeys.Resize(count);
+	tempitems.Resize(count);
+	for (int d = 0; d < 8; d++)
+	{
+		unsigned *h = histogram[d];
+		int shift = d * 8;
+		if (h[(keys[0] >> shift) & 255] == count) continue;
+
+		unsigned offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			unsigned c = h[i];
+			h[i] = offset;
+			offset += c;
+		}
+		for (unsigned i = 0; i < count; i++)
+		{
+			unsigned pos = h[(keys[i] >> shift) & 255]++;
+			tempkeys[pos] = keys[i];
+			tempitems[pos] = items[i];
+		}
+		keys.Swap(tempkeys);
+		items.Swap(tempitems);
+	}
+}
+
+// Maps a float to an unsigned int with the same ordering.
+static inline uint32_t FloatSortKey(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, 4);
+	return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+//==========================================================================
+//
+// Packed key for the opaque lists:
+// texture (24 bits) | render style (8 bits) | light level (8 bits) | depth (24 bits)
+// Depth sorts front to back within each state group.
+//
+//==========================================================================
+
+static inline uint64_t MakeSortKey(FGameTexture *tex, int style, int light, float depth)
+{
+	uint64_t texkey = tex ? uint32_t(tex->GetID().GetIndex() + 1) & 0xffffff : 0;
+	uint64_t depthkey = uint32_t(clamp(depth * 16.f, 0.f, 16777215.f));
+	return (texkey << 40) | (uint64_t(style & 255) << 32) | (uint64_t(clamp(light, 0, 255)) << 24) | depthkey;
+}
+
 //==========================================================================
 //
 //
@@ -399,6 +471,39 @@ inline double CalcIntersectionVertex(HWWall *w1, HWWall * w2)
 	return ((ay - cy)*(dx - cx) - (ax - cx)*(dy - cy)) / ((bx - ax)*(dy - cy) - (by - ay)*(dx - cx));
 }
 
+//==========================================================================
+//
+// An item whose end only pokes through the head wall's line by a tiny
+// amount is not split. Cutting it would only create a sliver, so it is
+// put on the side that the rest of it is on. v1 and v2 are the values
+// PointOnSide returned for the item's ends.
+//
+//==========================================================================
+#define MIN_SPLIT (0.01f)
+
+bool HWDrawList::SortWithoutSplit(SortNode * head, SortNode * sort, float v1, float v2)
+{
+	HWWall * wh = walls[drawitems[head->itemindex].index];
+	float len = sqrtf((wh->glseg.x2 - wh->glseg.x1) * (wh->glseg.x2 - wh->glseg.x1) + (wh->glseg.y2 - wh->glseg.y1) * (wh->glseg.y2 - wh->glseg.y1));
+	if (len < MIN_EQ) return false;
+
+	// PointOnSide is scaled by the wall's length.
+	float d1 = v1 / len, d2 = v2 / len;
+	if (d1 < MIN_SPLIT && d2 < MIN_SPLIT)
+	{
+		head->AddToLeft(sort);
+	}
+	else if (d1 > -MIN_SPLIT && d2 > -MIN_SPLIT)
+	{
+		head->AddToRight(sort);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
 void HWDrawList::SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort)
 {
 	HWWall * wh= walls[drawitems[head->itemindex].index];
@@ -429,7 +534,7 @@ void HWDrawList::SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sor
 	{
 		head->AddToRight(sort);
 	}
-	else
+	else if (!SortWithoutSplit(head, sort, v1, v2))
 	{
 		double r = CalcIntersectionVertex(ws, wh);
 
@@ -517,7 +622,7 @@ void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * s
 	{
 		head->AddToRight(sort);
 	}
-	else
+	else if (!SortWithoutSplit(head, sort, v1, v2))
 	{
 		const bool drawWithXYBillboard = ((ss->particle && gl_billboard_particles) || (!(ss->actor && ss->actor->renderflags & RF_FORCEYBILLBOARD)
 			&& (gl_billboard_mode == 1 || (ss->actor && ss->actor->renderflags & RF_FORCEXYBILLBOARD))));
@@ -581,22 +686,6 @@ void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * s
 }
 
 
-//==========================================================================
-//
-//
-//
-//==========================================================================
-
-inline int HWDrawList::CompareSprites(SortNode * a,SortNode * b)
-{
-	HWSprite * s1= sprites[drawitems[a->itemindex].index];
-	HWSprite * s2= sprites[drawitems[b->itemindex].index];
-
-	if (s1->depth < s2->depth) return 1;
-	if (s1->depth > s2->depth) return -1;
-	return reverseSort? s2->index-s1->index : s1->index-s2->index;
-}
-
 //==========================================================================
 //
 //
@@ -605,19 +694,24 @@ inline int HWDrawList::CompareSprites(SortNode * a,SortNode * b)
 SortNode * HWDrawList::SortSpriteList(SortNode * head)
 {
 	SortNode * n;
-	int count;
 	unsigned i;
 
 	static TArray<SortNode*> sortspritelist;
+	static TArray<uint64_t> sortkeys;
 
 	SortNode * parent=head->parent;
 
+	// Far to near, ties are resolved by the sprite's index.
 	sortspritelist.Clear();
-	for(count=0,n=head;n;n=n->next) sortspritelist.Push(n);
-	std::stable_sort(sortspritelist.begin(), sortspritelist.end(), [=](SortNode *a, SortNode *b)
+	sortkeys.Clear();
+	for(n=head;n;n=n->next)
 	{
-		return CompareSprites(a, b) < 0;
-	});
+		HWSprite * s = sprites[drawitems[n->itemindex].index];
+		uint32_t index = reverseSort ? ~uint32_t(s->index) : uint32_t(s->index);
+		sortspritelist.Push(n);
+		sortkeys.Push((uint64_t(~FloatSortKey(s->depth)) << 32) | (index ^ 0x80000000u));
+	}
+	RadixSort(sortkeys, sortspritelist);
 
 	for(i=0;i<sortspritelist.Size();i++)
 	{
@@ -701,6 +795,66 @@ SortNode * HWDrawList::DoSort(HWDrawInfo *di, SortNode * head)
 	return sn;
 }
 
+//==========================================================================
+//
+// Merges runs of consecutive sprites that need the same render state
+// into one draw call. Since only neighbours in the sorted order get
+// merged the drawing order does not change. This must be called while
+// the vertex buffer is mapped.
+//
+//==========================================================================
+
+HWSprite *HWDrawList::GetBatchableSprite(HWDrawInfo *di, SortNode *node)
+{
+	if (drawitems[node->itemindex].rendertype != DrawType_SPRITE) return nullptr;
+	HWSprite *s = sprites[drawitems[node->itemindex].index];
+	return s->IsBatchable(di) ? s : nullptr;
+}
+
+void HWDrawList::BatchSprites(HWDrawInfo *di, SortNode *head)
+{
+	static TArray<HWSprite*> batch;
+
+	if (head->left) BatchSprites(di, head->left);
+	if (head->right) BatchSprites(di, head->right);
+
+	SortNode *node = head;
+	while (node)
+	{
+		HWSprite *leader = GetBatchableSprite(di, node);
+		node = node->equal;
+		if (leader == nullptr) continue;
+
+		batch.Clear();
+		batch.Push(leader);
+		while (node)
+		{
+			HWSprite *s = GetBatchableSprite(di, node);
+			if (s == nullptr || !leader->BatchesWith(s)) break;
+			batch.Push(s);
+			node = node->equal;
+		}
+		if (batch.Size() < 2) continue;
+
+		auto vert = screen->mVertexData->AllocVertices(batch.Size() * 6);
+		auto vp = vert.first;
+		unsigned start = 0;
+		for (unsigned i = 0; i <= batch.Size(); i++)
+		{
+			// Sprites which need a polygon offset interrupt the batch and are drawn on their own.
+			if (i < batch.Size() && batch[i]->GetBatchVertices(di, vp + i * 6)) continue;
+
+			if (i - start > 1)
+			{
+				batch[start]->vertexindex = vert.second + start * 6;
+				batch[start]->batchcount = i - start;
+				for (unsigned j = start + 1; j < i; j++) batch[j]->batchcount = 0;
+			}
+			start = i + 1;
+		}
+	}
+}
+
 //==========================================================================
 //
 //
@@ -712,40 +866,47 @@ void HWDrawList::Sort(HWDrawInfo *di)
     SortZ = di->Viewpoint.Pos.Z;
 	MakeSortList();
 	sorted = DoSort(di, SortNodes[SortNodeStart]);
+	if (gl_sprite_batching) BatchSprites(di, sorted);
 }
 
 //==========================================================================
 //
-// Sorting the drawitems first by texture and then by light level
+// Sorting the drawitems by texture, render state, light level and depth
 //
 //==========================================================================
 
-void HWDrawList::SortWalls()
+void HWDrawList::SortWalls(HWDrawInfo *di)
 {
 	if (drawitems.Size() > 1)
 	{
-		std::sort(drawitems.begin(), drawitems.end(), [=](const HWDrawItem &a, const HWDrawItem &b) -> bool
-		{
-			HWWall * w1 = walls[a.index];
-			HWWall * w2 = walls[b.index];
+		static TArray<uint64_t> sortkeys;
+		auto &vp = di->Viewpoint.Pos;
 
-			if (w1->texture != w2->texture) return w1->texture < w2->texture;
-			return (w1->flags & 3) < (w2->flags & 3);
-
-		});
+		sortkeys.Resize(drawitems.Size());
+		for (unsigned i = 0; i < drawitems.Size(); i++)
+		{
+			HWWall * w = walls[drawitems[i].index];
+			float depth = fabsf((w->glseg.x1 + w->glseg.x2) * 0.5f - (float)vp.X) + fabsf((w->glseg.y1 + w->glseg.y2) * 0.5f - (float)vp.Y);
+			sortkeys[i] = MakeSortKey(w->texture, (w->flags & 3) | (w->RenderStyle << 2), w->lightlevel, depth);
+		}
+		RadixSort(sortkeys, drawitems);
 	}
 }
 
-void HWDrawList::SortFlats()
+void HWDrawList::SortFlats(HWDrawInfo *di)
 {
 	if (drawitems.Size() > 1)
 	{
-		std::sort(drawitems.begin(), drawitems.end(), [=](const HWDrawItem &a, const HWDrawItem &b)
+		static TArray<uint64_t> sortkeys;
+		float viewz = (float)di->Viewpoint.Pos.Z;
+
+		sortkeys.Resize(drawitems.Size());
+		for (unsigned i = 0; i < drawitems.Size(); i++)
 		{
-			HWFlat * w1 = flats[a.index];
-			HWFlat* w2 = flats[b.index];
-			return w1->texture < w2->texture;
-		});
+			HWFlat * f = flats[drawitems[i].index];
+			sortkeys[i] = MakeSortKey(f->texture, f->renderstyle, f->lightlevel, fabsf(f->z - viewz));
+		}
+		RadixSort(sortkeys, drawitems);
 	}
 }
 
@@ -817,6 +978,7 @@ void HWDrawList::DoDraw(HWDrawInfo *di, FRenderState &state, bool translucent, i
 	case DrawType_SPRITE:
 		{
 			HWSprite * s= sprites[drawitems[i].index];
+			if (s->batchcount == 0) break;	// already drawn as part of a batch
 			RenderSprite.Clock();
 			s->DrawSprite(di, state, translucent);
 			RenderSprite.Unclock();
@@ -92,8 +92,8 @@ public:
 	HWFlat *NewFlat();
 	HWSprite *NewSprite();
 	void Reset();
-	void SortWalls();
-	void SortFlats();
+	void SortWalls(HWDrawInfo *di);
+	void SortFlats(HWDrawInfo *di);
 	
 	
 	void MakeSortList();
@@ -104,9 +104,11 @@ public:
 	void SortSpriteIntoPlane(SortNode * head,SortNode * sort);
 	void SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort);
 	void SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort);
-	int CompareSprites(SortNode * a,SortNode * b);
+	bool SortWithoutSplit(SortNode * head, SortNode * sort, float v1, float v2);
 	SortNode * SortSpriteList(SortNode * head);
 	SortNode * DoSort(HWDrawInfo *di, SortNode * head);
+	HWSprite * GetBatchableSprite(HWDrawInfo *di, SortNode * node);
+	void BatchSprites(HWDrawInfo *di, SortNode * head);
 	void Sort(HWDrawInfo *di);
 
 	void DoDraw(HWDrawInfo *di, FRenderState &state, bool translucent, int i);
@@ -360,6 +360,7 @@ public:
 	int index;
 	float depth;
 	int vertexindex;
+	int batchcount;		// number of sprites drawn with this one's state. 0 if a preceding sprite draws it.
 
 	float topclip;
 	float bottomclip;
@@ -391,6 +392,10 @@ public:
 	void Process(HWDrawInfo *di, AActor* thing,sector_t * sector, area_t in_area, int thruportal = false, bool isSpriteShadow = false);
 	void ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *sector);//, int shade, int fakeside)
 
+	bool IsBatchable(HWDrawInfo *di);
+	bool BatchesWith(HWSprite *other);
+	bool GetBatchVertices(HWDrawInfo *di, FFlatVertex *vp);
+
 	void DrawSprite(HWDrawInfo *di, FRenderState &state, bool translucent);
 };
 
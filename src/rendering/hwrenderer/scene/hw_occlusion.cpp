@@ -0,0 +1,441 @@
+//
+//---------------------------------------------------------------------------
+//
+// Copyright(C) 2026 agent
+// All rights reserved.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//--------------------------------------------------------------------------
+//
+/*
+** hw_occlusion.cpp
+** CPU side occlusion culling for the hardware renderer
+**
+*/
+
+#include <float.h>
+#include "hw_occlusion.h"
+#include "hw_drawinfo.h"
+#include "p_lnspec.h"
+#include "g_levellocals.h"
+#include "r_sky.h"
+#include "m_bbox.h"
+#include "texturemanager.h"
+
+CVAR(Bool, gl_occlusion_cull, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+static const float NEAR_W = 1.f;
+static const float UNBOUNDED = FLT_MAX / 4;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void HWOcclusionBuffer::Begin(HWDrawInfo *di)
+{
+	VSMatrix viewproj = di->VPUniforms.mProjectionMatrix;
+	viewproj.multMatrix(di->VPUniforms.mViewMatrix);
+	for (int i = 0; i < 16; i++) Matrix[i] = (float)viewproj.get()[i];
+
+	if (Depth == nullptr)
+	{
+		Depth.reset(new std::atomic<float>[Width * Height]);
+		TileMax.reset(new std::atomic<float>[TilesX * TilesY]);
+	}
+	for (int i = 0; i < Width * Height; i++) Depth[i].store(FLT_MAX, std::memory_order_relaxed);
+	for (int i = 0; i < TilesX * TilesY; i++) TileMax[i].store(FLT_MAX, std::memory_order_relaxed);
+
+	SetupZRanges(di->Level);
+}
+
+//==========================================================================
+//
+// The node bounding boxes are only 2D so the height ranges need to be
+// collected from the sectors each frame because the planes may move.
+// Anything whose planes are not simple gets an unbounded range.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::SetupZRanges(FLevelLocals *Level)
+{
+	SectorZ.Resize(Level->sectors.Size() * 2);
+	for (auto &sec : Level->sectors)
+	{
+		float zmin, zmax;
+
+		if (sec.floorplane.isSlope() || sec.GetHeightSec() != nullptr || sec.GetTexture(sector_t::floor) == skyflatnum) zmin = -UNBOUNDED;
+		else zmin = (float)sec.floorplane.ZatPoint(sec.centerspot);
+
+		if (sec.ceilingplane.isSlope() || sec.GetHeightSec() != nullptr || sec.GetTexture(sector_t::ceiling) == skyflatnum) zmax = UNBOUNDED;
+		else zmax = (float)sec.ceilingplane.ZatPoint(sec.centerspot);
+
+		for (auto rover : sec.e->XFloor.ffloors)
+		{
+			if (!(rover->flags & FF_EXISTS)) continue;
+			if (rover->top.plane->isSlope() || rover->bottom.plane->isSlope())
+			{
+				zmin = -UNBOUNDED;
+				zmax = UNBOUNDED;
+				break;
+			}
+			zmax = max(zmax, (float)rover->top.plane->ZatPoint(sec.centerspot));
+			zmin = min(zmin, (float)rover->bottom.plane->ZatPoint(sec.centerspot));
+		}
+		SectorZ[sec.Index() * 2] = zmin;
+		SectorZ[sec.Index() * 2 + 1] = zmax;
+	}
+
+	NodeZ.Resize(Level->nodes.Size() * 2);
+	if (Level->nodes.Size() > 0)
+	{
+		float zmin, zmax;
+		SetupNodeZ(Level, Level->HeadNode(), zmin, zmax);
+	}
+}
+
+void HWOcclusionBuffer::SetupNodeZ(FLevelLocals *Level, void *node, float &zmin, float &zmax)
+{
+	if ((size_t)node & 1)
+	{
+		GetZRange(node, zmin, zmax);
+		return;
+	}
+	node_t *bsp = (node_t *)node;
+	float zmin1, zmax1;
+	SetupNodeZ(Level, bsp->children[0], zmin, zmax);
+	SetupNodeZ(Level, bsp->children[1], zmin1, zmax1);
+	zmin = min(zmin, zmin1);
+	zmax = max(zmax, zmax1);
+	NodeZ[bsp->Index() * 2] = zmin;
+	NodeZ[bsp->Index() * 2 + 1] = zmax;
+}
+
+void HWOcclusionBuffer::GetZRange(void *node, float &zmin, float &zmax)
+{
+	if ((size_t)node & 1)
+	{
+		auto sub = (subsector_t *)((uint8_t *)node - 1);
+		int index = sub->render_sector->Index();
+		zmin = SectorZ[index * 2];
+		zmax = SectorZ[index * 2 + 1];
+	}
+	else
+	{
+		int index = ((node_t *)node)->Index();
+		zmin = NodeZ[index * 2];
+		zmax = NodeZ[index * 2 + 1];
+	}
+}
+
+//==========================================================================
+//
+// Transforms into clip space. The renderer's coordinate order is X, Z, Y.
+//
+//==========================================================================
+
+HWOcclusionBuffer::FClipVertex HWOcclusionBuffer::Project(double x, double y, double z) const
+{
+	FClipVertex v;
+	v.x = float(Matrix[0] * x + Matrix[4] * z + Matrix[8] * y + Matrix[12]);
+	v.y = float(Matrix[1] * x + Matrix[5] * z + Matrix[9] * y + Matrix[13]);
+	v.w = float(Matrix[3] * x + Matrix[7] * z + Matrix[11] * y + Matrix[15]);
+	return v;
+}
+
+//==========================================================================
+//
+// Adds the opaque parts of a seg that passed the clipper as occluders.
+// Only parts that are guaranteed to be drawn solid are used: one-sided
+// walls, upper and lower parts with a non-masked texture and the sides
+// of solid 3D floors in the back sector.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::AddSeg(seg_t *seg)
+{
+	if (seg->linedef == nullptr || seg->sidedef == nullptr) return;
+	if (seg->linedef->isVisualPortal() || seg->linedef->special == Line_Horizon) return;
+
+	sector_t *front = seg->frontsector;
+	sector_t *back = seg->backsector;
+	if (front->GetHeightSec() != nullptr) return;
+
+	DVector2 v1 = seg->v1->fPos();
+	DVector2 v2 = seg->v2->fPos();
+	float fc1 = (float)front->ceilingplane.ZatPoint(v1);
+	float fc2 = (float)front->ceilingplane.ZatPoint(v2);
+	float ff1 = (float)front->floorplane.ZatPoint(v1);
+	float ff2 = (float)front->floorplane.ZatPoint(v2);
+
+	auto isOpaque = [=](FTextureID texid)
+	{
+		auto tex = TexMan.GetGameTexture(texid, true);
+		return tex && tex->isValid() && !tex->isMasked();
+	};
+
+	if (back == nullptr)
+	{
+		if (isOpaque(seg->sidedef->GetTexture(side_t::mid)))
+		{
+			AddWall(v1, v2, fc1, fc2, ff1, ff2);
+		}
+		return;
+	}
+	if (back == front || back->GetHeightSec() != nullptr) return;
+
+	float bc1 = (float)back->ceilingplane.ZatPoint(v1);
+	float bc2 = (float)back->ceilingplane.ZatPoint(v2);
+	float bf1 = (float)back->floorplane.ZatPoint(v1);
+	float bf2 = (float)back->floorplane.ZatPoint(v2);
+
+	// Sky walls are not drawn if either side has a sky.
+	if ((bc1 < fc1 || bc2 < fc2) && front->GetTexture(sector_t::ceiling) != skyflatnum && back->GetTexture(sector_t::ceiling) != skyflatnum &&
+		isOpaque(seg->sidedef->GetTexture(side_t::top)))
+	{
+		AddWall(v1, v2, fc1, fc2, max(bc1, ff1), max(bc2, ff2));
+	}
+	if ((bf1 > ff1 || bf2 > ff2) && front->GetTexture(sector_t::floor) != skyflatnum && back->GetTexture(sector_t::floor) != skyflatnum &&
+		isOpaque(seg->sidedef->GetTexture(side_t::bottom)))
+	{
+		AddWall(v1, v2, min(bf1, fc1), min(bf2, fc2), ff1, ff2);
+	}
+
+	for (auto rover : back->e->XFloor.ffloors)
+	{
+		if (rover->flags & FF_THISINSIDE) continue;
+		if ((rover->flags & (FF_EXISTS | FF_RENDERSIDES)) != (FF_EXISTS | FF_RENDERSIDES)) continue;
+		if (rover->flags & (FF_INVERTSIDES | FF_SWIMMABLE | FF_TRANSLUCENT | FF_ADDITIVETRANS | FF_FOG)) continue;
+		if (rover->alpha < 255) continue;
+
+		FTextureID texid;
+		if (rover->flags & FF_UPPERTEXTURE) texid = seg->sidedef->GetTexture(side_t::top);
+		else if (rover->flags & FF_LOWERTEXTURE) texid = seg->sidedef->GetTexture(side_t::bottom);
+		else texid = rover->master->sidedef[0]->GetTexture(side_t::mid);
+		if (!isOpaque(texid)) continue;
+
+		float top1 = min(fc1, (float)rover->top.plane->ZatPoint(v1));
+		float top2 = min(fc2, (float)rover->top.plane->ZatPoint(v2));
+		float bottom1 = max(ff1, (float)rover->bottom.plane->ZatPoint(v1));
+		float bottom2 = max(ff2, (float)rover->bottom.plane->ZatPoint(v2));
+		AddWall(v1, v2, top1, top2, bottom1, bottom2);
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void HWOcclusionBuffer::AddWall(const DVector2 &v1, const DVector2 &v2, float ztop1, float ztop2, float zbottom1, float zbottom2)
+{
+	ztop1 = max(ztop1, zbottom1);
+	ztop2 = max(ztop2, zbottom2);
+	if (ztop1 == zbottom1 && ztop2 == zbottom2) return;
+
+	FClipVertex quad[4] = { Project(v1.X, v1.Y, zbottom1), Project(v1.X, v1.Y, ztop1), Project(v2.X, v2.Y, ztop2), Project(v2.X, v2.Y, zbottom2) };
+
+	// Clip against the near plane.
+	FClipVertex clipped[8];
+	int count = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		const FClipVertex &a = quad[i];
+		const FClipVertex &b = quad[(i + 1) & 3];
+		float da = a.w - NEAR_W;
+		float db = b.w - NEAR_W;
+		if (da >= 0) clipped[count++] = a;
+		if ((da >= 0) != (db >= 0))
+		{
+			float t = da / (da - db);
+			clipped[count++] = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.w + (b.w - a.w) * t };
+		}
+	}
+	if (count >= 3)
+	{
+		RasterizePolygon(clipped, count);
+	}
+}
+
+//==========================================================================
+//
+// Conservative rasterization of a convex polygon: a pixel only gets
+// written if the polygon covers it completely and it receives the
+// farthest depth the polygon has inside the pixel.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::RasterizePolygon(const FClipVertex *verts, int count)
+{
+	float sx[8], sy[8], iw[8];
+	float minx = FLT_MAX, maxx = -FLT_MAX, miny = FLT_MAX, maxy = -FLT_MAX, miniw = FLT_MAX;
+	for (int i = 0; i < count; i++)
+	{
+		iw[i] = 1.f / verts[i].w;
+		sx[i] = (verts[i].x * iw[i] * 0.5f + 0.5f) * Width;
+		sy[i] = (verts[i].y * iw[i] * 0.5f + 0.5f) * Height;
+		minx = min(minx, sx[i]);
+		maxx = max(maxx, sx[i]);
+		miny = min(miny, sy[i]);
+		maxy = max(maxy, sy[i]);
+		miniw = min(miniw, iw[i]);
+	}
+
+	int x0 = max(0, (int)floorf(minx));
+	int x1 = min(Width - 1, (int)ceilf(maxx));
+	int y0 = max(0, (int)floorf(miny));
+	int y1 = min(Height - 1, (int)ceilf(maxy));
+	if (x0 > x1 || y0 > y1) return;
+
+	// Pick the largest triangle of the fan for the depth plane to keep it numerically stable.
+	float area = 0, bestarea = 0;
+	int best = 1;
+	for (int i = 1; i < count - 1; i++)
+	{
+		float a = (sx[i] - sx[0]) * (sy[i + 1] - sy[0]) - (sx[i + 1] - sx[0]) * (sy[i] - sy[0]);
+		area += a;
+		if (fabsf(a) > fabsf(bestarea))
+		{
+			bestarea = a;
+			best = i;
+		}
+	}
+	if (fabsf(area) < 1.f) return;	// too small to fully cover any pixel.
+
+	float sign = area > 0 ? 1.f : -1.f;
+	float ea[8], eb[8], ec[8];
+	for (int i = 0; i < count; i++)
+	{
+		int j = i + 1 == count ? 0 : i + 1;
+		ea[i] = (sy[i] - sy[j]) * sign;
+		eb[i] = (sx[j] - sx[i]) * sign;
+		ec[i] = (sx[i] * sy[j] - sx[j] * sy[i]) * sign;
+		// Move the edge inward by half a pixel so that only fully covered pixels pass.
+		ec[i] -= 0.5f * (fabsf(ea[i]) + fabsf(eb[i]));
+	}
+
+	int i1 = best, i2 = best + 1;
+	float dx1 = sx[i1] - sx[0], dy1 = sy[i1] - sy[0], dw1 = iw[i1] - iw[0];
+	float dx2 = sx[i2] - sx[0], dy2 = sy[i2] - sy[0], dw2 = iw[i2] - iw[0];
+	float A = (dw1 * dy2 - dw2 * dy1) / bestarea;
+	float B = (dx1 * dw2 - dx2 * dw1) / bestarea;
+	float C = iw[0] - A * sx[0] - B * sy[0];
+	float slack = 0.5f * (fabsf(A) + fabsf(B));
+
+	bool written = false;
+	for (int y = y0; y <= y1; y++)
+	{
+		float py = y + 0.5f;
+		std::atomic<float> *line = &Depth[y * Width];
+		for (int x = x0; x <= x1; x++)
+		{
+			float px = x + 0.5f;
+			int e = 0;
+			while (e < count && ea[e] * px + eb[e] * py + ec[e] >= 0) e++;
+			if (e < count) continue;
+
+			float invw = max(A * px + B * py + C - slack, miniw);
+			float depth = 1.f / invw;
+			if (depth < line[x].load(std::memory_order_relaxed))
+			{
+				line[x].store(depth, std::memory_order_relaxed);
+				written = true;
+			}
+		}
+	}
+	if (!written) return;
+
+	for (int ty = y0 / TileSize; ty <= y1 / TileSize; ty++)
+	{
+		for (int tx = x0 / TileSize; tx <= x1 / TileSize; tx++)
+		{
+			float farthest = 0;
+			for (int y = ty * TileSize; y < (ty + 1) * TileSize; y++)
+			{
+				const std::atomic<float> *line = &Depth[y * Width + tx * TileSize];
+				for (int x = 0; x < TileSize; x++) farthest = max(farthest, line[x].load(std::memory_order_relaxed));
+			}
+			TileMax[ty * TilesX + tx].store(farthest, std::memory_order_relaxed);
+		}
+	}
+}
+
+//==========================================================================
+//
+// Checks whether a box is entirely behind the occluders.
+//
+// This may be called from the render worker thread while the BSP
+// traversal is still adding occluders. The depth values are atomics, so
+// this reads a mix of older and newer values. Either is safe to test
+// against, because depths only ever get nearer and all of them stem from
+// real geometry. An older value only means that less gets culled.
+//
+//==========================================================================
+
+bool HWOcclusionBuffer::IsBoxOccluded(const DVector3 &mins, const DVector3 &maxs)
+{
+	if (mins.Z <= -UNBOUNDED || maxs.Z >= UNBOUNDED) return false;
+
+	float minx = FLT_MAX, maxx = -FLT_MAX, miny = FLT_MAX, maxy = -FLT_MAX, minw = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		FClipVertex v = Project(i & 1 ? maxs.X : mins.X, i & 2 ? maxs.Y : mins.Y, i & 4 ? maxs.Z : mins.Z);
+		if (v.w < NEAR_W) return false;
+
+		float sx = (v.x / v.w * 0.5f + 0.5f) * Width;
+		float sy = (v.y / v.w * 0.5f + 0.5f) * Height;
+		minx = min(minx, sx);
+		maxx = max(maxx, sx);
+		miny = min(miny, sy);
+		maxy = max(maxy, sy);
+		minw = min(minw, v.w);
+	}
+
+	int x0 = max(0, (int)floorf(minx));
+	int x1 = min(Width - 1, (int)floorf(maxx));
+	int y0 = max(0, (int)floorf(miny));
+	int y1 = min(Height - 1, (int)floorf(maxy));
+	if (x0 > x1 || y0 > y1) return false;	// off screen, this is for the clipper to decide.
+
+	for (int ty = y0 / TileSize; ty <= y1 / TileSize; ty++)
+	{
+		for (int tx = x0 / TileSize; tx <= x1 / TileSize; tx++)
+		{
+			if (TileMax[ty * TilesX + tx].load(std::memory_order_relaxed) < minw) continue;
+
+			int xs = max(x0, tx * TileSize), xe = min(x1, tx * TileSize + TileSize - 1);
+			int ys = max(y0, ty * TileSize), ye = min(y1, ty * TileSize + TileSize - 1);
+			for (int y = ys; y <= ye; y++)
+			{
+				const std::atomic<float> *line = &Depth[y * Width];
+				for (int x = xs; x <= xe; x++)
+				{
+					if (line[x].load(std::memory_order_relaxed) >= minw) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool HWOcclusionBuffer::IsNodeChildOccluded(node_t *node, int side)
+{
+	float zmin, zmax;
+	GetZRange(node->children[side], zmin, zmax);
+	const float *bbox = node->bbox[side];
+	return IsBoxOccluded(DVector3(bbox[BOXLEFT], bbox[BOXBOTTOM], zmin), DVector3(bbox[BOXRIGHT], bbox[BOXTOP], zmax));
+}
@@ -0,0 +1,69 @@
+#ifndef __HW_OCCLUSION_H
+#define __HW_OCCLUSION_H
+
+#include <atomic>
+#include <memory>
+#include "tarray.h"
+#include "vectors.h"
+
+struct HWDrawInfo;
+struct FLevelLocals;
+struct node_t;
+struct seg_t;
+
+//==========================================================================
+//
+// Low resolution depth buffer on the CPU.
+//
+// The BSP traversal rasterizes opaque walls into it as it goes front to
+// back and tests node boxes and sprites against it before adding them.
+// Unlike the angle clipper this also catches geometry that is hidden
+// behind mid-height walls and 3D floor slabs. Occluders are rasterized
+// conservatively, i.e. only pixels that are entirely covered get written
+// and the depth is the farthest value inside the pixel, so a test never
+// rejects anything that is visible.
+//
+// With gl_multithread the sprites get tested on the render worker thread
+// while the BSP traversal is still rasterizing, so the depth values are
+// atomics. The main thread is the only writer.
+//
+//==========================================================================
+
+class HWOcclusionBuffer
+{
+public:
+	enum
+	{
+		Width = 256,
+		Height = 160,
+		TileSize = 8,
+		TilesX = Width / TileSize,
+		TilesY = Height / TileSize,
+	};
+
+	void Begin(HWDrawInfo *di);
+	void AddSeg(seg_t *seg);
+	bool IsNodeChildOccluded(node_t *node, int side);
+	bool IsBoxOccluded(const DVector3 &mins, const DVector3 &maxs);
+
+private:
+	struct FClipVertex
+	{
+		float x, y, w;
+	};
+
+	void SetupZRanges(FLevelLocals *Level);
+	void SetupNodeZ(FLevelLocals *Level, void *node, float &zmin, float &zmax);
+	void GetZRange(void *node, float &zmin, float &zmax);
+	FClipVertex Project(double x, double y, double z) const;
+	void AddWall(const DVector2 &v1, const DVector2 &v2, float ztop1, float ztop2, float zbottom1, float zbottom2);
+	void RasterizePolygon(const FClipVertex *verts, int count);
+
+	float Matrix[16];
+	std::unique_ptr<std::atomic<float>[]> Depth;
+	std::unique_ptr<std::atomic<float>[]> TileMax;	// farthest depth per tile
+	TArray<float> SectorZ;	// min/max pairs
+	TArray<float> NodeZ;
+};
+
+#endif
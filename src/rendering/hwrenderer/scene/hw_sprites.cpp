@@ -269,6 +269,14 @@ void HWSprite::DrawSprite(HWDrawInfo *di, FRenderState &state, bool translucent)
 		{
 			state.SetNormal(0, 0, 0);
 
+			if (batchcount > 1)
+			{
+				// The vertices of the entire batch were created when the list got sorted.
+				state.SetLightIndex(-1);
+				state.Draw(DT_Triangles, vertexindex, batchcount * 6);
+				rendered_spritebatches++;
+				continue;
+			}
 
 			if (screen->BuffersArePersistent())
 			{
@@ -499,6 +507,7 @@ inline void HWSprite::PutSprite(HWDrawInfo *di, bool translucent)
 		dynlightindex = -1;
 
 	vertexindex = -1;
+	batchcount = 1;
 	if (!screen->BuffersArePersistent())
 	{
 		CreateVertices(di);
@@ -531,6 +540,79 @@ void HWSprite::CreateVertices(HWDrawInfo *di)
 }
 
 
+//==========================================================================
+//
+// Checks if this sprite can be merged into a batch with its neighbours.
+// Everything that needs per-sprite render state excludes it.
+//
+//==========================================================================
+
+bool HWSprite::IsBatchable(HWDrawInfo *di)
+{
+	if (modelframe != nullptr || lightlist != nullptr) return false;
+	if (topclip != LARGE_VALUE || bottomclip != -LARGE_VALUE) return false;
+	if (RenderStyle.BlendOp == STYLEOP_Shadow || RenderStyle.BlendOp == STYLEOP_RevSub || RenderStyle.BlendOp == STYLEOP_Sub) return false;
+	// sprite lighting is sampled per sprite and passed as a uniform.
+	if (di->Level->HasDynamicLights && !di->isFullbrightScene() && !fullbright) return false;
+	return true;
+}
+
+//==========================================================================
+//
+// Checks if DrawSprite would set up the same state for both sprites.
+//
+//==========================================================================
+
+static sector_t *GetSpriteSector(HWSprite *spr)
+{
+	return spr->actor ? spr->actor->Sector : spr->particle ? spr->particle->subsector->sector : nullptr;
+}
+
+bool HWSprite::BatchesWith(HWSprite *other)
+{
+	if (texture != other->texture || translation != other->translation || OverrideShader != other->OverrideShader) return false;
+	if (RenderStyle != other->RenderStyle || trans != other->trans || hw_styleflags != other->hw_styleflags) return false;
+	if (lightlevel != other->lightlevel || foglevel != other->foglevel || fullbright != other->fullbright) return false;
+	if (Colormap != other->Colormap || ThingColor != other->ThingColor) return false;
+	if ((actor == nullptr) != (other->actor == nullptr)) return false;
+
+	uint32_t spritetype = actor ? uint32_t(actor->renderflags & RF_SPRITETYPEMASK) : 0;
+	uint32_t otherspritetype = other->actor ? uint32_t(other->actor->renderflags & RF_SPRITETYPEMASK) : 0;
+	if (spritetype != otherspritetype) return false;
+
+	sector_t *sec = GetSpriteSector(this);
+	sector_t *othersec = GetSpriteSector(other);
+	if (sec != othersec)
+	{
+		if (sec == nullptr || othersec == nullptr) return false;
+		if (sec->SpecialColors[sector_t::sprites] != othersec->SpecialColors[sector_t::sprites]) return false;
+		if (sec->AdditiveColors[sector_t::sprites] != othersec->AdditiveColors[sector_t::sprites]) return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Writes the sprite as two separate triangles so that several sprites
+// can be drawn with one call. Returns false if it needs a polygon offset,
+// which cannot be shared.
+//
+//==========================================================================
+
+bool HWSprite::GetBatchVertices(HWDrawInfo *di, FFlatVertex *vp)
+{
+	FVector3 v[4];
+	if (CalculateVertices(di, v, &di->Viewpoint.CenterPos)) return false;
+
+	vp[0].Set(v[0][0], v[0][1], v[0][2], ul, vt);
+	vp[1].Set(v[1][0], v[1][1], v[1][2], ur, vt);
+	vp[2].Set(v[2][0], v[2][1], v[2][2], ul, vb);
+	vp[3] = vp[2];
+	vp[4] = vp[1];
+	vp[5].Set(v[3][0], v[3][1], v[3][2], ur, vb);
+	return true;
+}
+
 //==========================================================================
 //
 // 
@@ -1002,6 +1084,17 @@ void HWSprite::Process(HWDrawInfo *di, AActor* thing, sector_t * sector, area_t
 		texture = nullptr;
 	}
 
+	if (di->useocclusion && texture && spritetype == RF_FACESPRITE && !(thing->renderflags & RF_ROLLSPRITE))
+	{
+		// Billboarding rotates the sprite around its center so test a box that contains it at any angle.
+		DVector3 center((x1 + x2) * 0.5, (y1 + y2) * 0.5, (z1 + z2) * 0.5);
+		double radius = DVector3(x2 - x1, y2 - y1, z2 - z1).Length() * 0.5;
+		if (di->Occlusion.IsBoxOccluded(center - DVector3(radius, radius, radius), center + DVector3(radius, radius, radius)))
+		{
+			return;
+		}
+	}
+
 	depth = (float)((x - vp.CenterPos.X) * vp.TanCos + (y - vp.CenterPos.Y) * vp.TanSin);
 	if (isSpriteShadow) depth += 1.f/65536.f; // always sort shadows behind the sprite.
 
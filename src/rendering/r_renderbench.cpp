@@ -0,0 +1,323 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//	Offscreen render benchmark. Renders a scripted camera path into
+//	an in-memory buffer with the software renderer or the softpoly
+//	backend and writes per-frame timings to a CSV file.
+//
+//	The camera path is a text file with one keyframe per line:
+//
+//		x y z yaw pitch [frames]
+//
+//	'frames' is the number of frames spent moving linearly from this
+//	keyframe to the next one (default 1). z is the eye height.
+//
+//-----------------------------------------------------------------------------
+
+#include "r_renderbench.h"
+#include "r_utility.h"
+#include "c_cvars.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "m_png.h"
+#include "md5.h"
+#include "sc_man.h"
+#include "printf.h"
+#include "files.h"
+#include "stats.h"
+#include "engineerrors.h"
+#include "v_video.h"
+#include "v_palette.h"
+#include "g_levellocals.h"
+#include "d_main.h"
+#include "actor.h"
+#include "actorinlines.h"
+#include "swrenderer/r_renderer.h"
+#include "swrenderer/scene/r_scene.h"
+#include "hw_clock.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+
+EXTERN_CVAR(Float, vid_gamma)
+
+struct FBenchKeyframe
+{
+	DVector3 Pos;
+	DAngle Yaw, Pitch;
+	int Frames;
+};
+
+struct FBenchFrameTimes
+{
+	double Total, Bsp, Walls, Planes, Sprites;
+};
+
+static TArray<FBenchKeyframe> BenchPath;
+static FString BenchOutput;
+static FString BenchShots;
+static int BenchWidth = 640, BenchHeight = 400;
+static bool BenchHash;
+static bool BenchPending;
+
+//==========================================================================
+//
+// R_InitRenderBench
+//
+// Reads the camera path and the benchmark options from the command line.
+//
+//==========================================================================
+
+void R_InitRenderBench(const char *pathfile)
+{
+	FScanner sc;
+
+	if (!sc.OpenFile(pathfile))
+	{
+		I_FatalError("Unable to open camera path %s", pathfile);
+	}
+	while (sc.CheckFloat())
+	{
+		FBenchKeyframe &key = BenchPath[BenchPath.Reserve(1)];
+		key.Pos.X = sc.Float;
+		sc.MustGetFloat();
+		key.Pos.Y = sc.Float;
+		sc.MustGetFloat();
+		key.Pos.Z = sc.Float;
+		sc.MustGetFloat();
+		key.Yaw = DAngle(sc.Float);
+		sc.MustGetFloat();
+		key.Pitch = DAngle(sc.Float);
+		key.Frames = 1;
+
+		// The frame count is optional so it must be on the same line as the rest of the keyframe.
+		int line = sc.Line;
+		if (sc.CheckNumber())
+		{
+			if (sc.Line != line) sc.UnGet();
+			else key.Frames = max(sc.Number, 1);
+		}
+	}
+	if (sc.GetString())
+	{
+		sc.ScriptError("Number expected, got %s", sc.String);
+	}
+	if (BenchPath.Size() == 0)
+	{
+		I_FatalError("Camera path %s is empty", pathfile);
+	}
+
+	const char *v = Args->CheckValue("-renderbenchout");
+	BenchOutput = v ? v : "renderbench.csv";
+
+	v = Args->CheckValue("-renderbenchshots");
+	if (v) BenchShots = v;
+
+	int p = Args->CheckParm("-renderbenchsize");
+	if (p && p < Args->NumArgs() - 2)
+	{
+		BenchWidth = clamp(atoi(Args->GetArg(p + 1)), 64, 8192);
+		BenchHeight = clamp(atoi(Args->GetArg(p + 2)), 64, 8192);
+	}
+	BenchHash = !!Args->CheckParm("-renderbenchhash");
+	BenchPending = true;
+}
+
+bool R_RenderBenchPending()
+{
+	return BenchPending;
+}
+
+//==========================================================================
+//
+// Positions the camera for one frame of the path
+//
+//==========================================================================
+
+static void SetBenchCamera(AActor *camera, int frame)
+{
+	unsigned key = 0;
+	while (key < BenchPath.Size() - 1 && frame >= BenchPath[key].Frames)
+	{
+		frame -= BenchPath[key].Frames;
+		key++;
+	}
+
+	const FBenchKeyframe &from = BenchPath[key];
+	const FBenchKeyframe &to = BenchPath[min(key + 1, BenchPath.Size() - 1)];
+	double t = double(frame) / from.Frames;
+
+	camera->Angles.Yaw = from.Yaw + deltaangle(from.Yaw, to.Yaw) * t;
+	camera->Angles.Pitch = from.Pitch + (to.Pitch - from.Pitch) * t;
+	camera->SetOrigin(from.Pos + (to.Pos - from.Pos) * t, false);
+	r_NoInterpolate = true;
+}
+
+//==========================================================================
+//
+// Renders one frame and returns the pixels for hashing and screenshots
+//
+//==========================================================================
+
+static void RenderBenchFrame(AActor *camera, DCanvas *canvas, TArray<uint8_t> &rgb, FBenchFrameTimes &times)
+{
+	cycle_t frametime;
+
+	frametime.Reset();
+	if (!V_IsHardwareRenderer())
+	{
+		frametime.Clock();
+		SWRenderer->RenderViewToCanvas(camera, canvas, BenchWidth, BenchHeight);
+		frametime.Unclock();
+
+		// Wall setup is part of the BSP traversal in the software renderer.
+		times.Bsp = swrenderer::WallCycles.TimeMS();
+		times.Walls = 0;
+		times.Planes = swrenderer::PlaneCycles.TimeMS();
+		times.Sprites = swrenderer::MaskedCycles.TimeMS();
+	}
+	else
+	{
+		float ratio = float(BenchWidth) / BenchHeight;
+		float fovratio = ratio >= 1.3f ? 1.333333f : ratio;
+
+		ResetProfilingData();
+		frametime.Clock();
+		RenderOffscreenView(camera, BenchWidth, BenchHeight, r_viewpoint.FieldOfView.Degrees, ratio, fovratio, rgb.Data());
+		frametime.Unclock();
+
+		times.Bsp = Bsp.TimeMS();
+		times.Walls = SetupWall.TimeMS() + RenderWall.TimeMS();
+		times.Planes = SetupFlat.TimeMS() + RenderFlat.TimeMS();
+		times.Sprites = SetupSprite.TimeMS() + RenderSprite.TimeMS();
+	}
+	times.Total = frametime.TimeMS();
+}
+
+//==========================================================================
+//
+// R_RunRenderBench
+//
+// Called from the main loop once the benchmark map is running.
+// Renders the entire path and exits.
+//
+//==========================================================================
+
+void R_RunRenderBench()
+{
+	BenchPending = false;
+
+	if (V_IsHardwareRenderer() && !screen->IsPoly())
+	{
+		I_FatalError("-renderbench requires the software renderer or the softpoly backend");
+	}
+	if (V_IsHardwareRenderer())
+	{
+		// The softpoly backend renders into the screen's canvas.
+		BenchWidth = min(BenchWidth, screen->GetWidth());
+		BenchHeight = min(BenchHeight, screen->GetHeight());
+	}
+
+	bool paletted = !V_IsHardwareRenderer();
+	int pixelsize = paletted ? 1 : 3;
+	DCanvas canvas(BenchWidth, BenchHeight, false);
+	TArray<uint8_t> rgb(paletted ? 0 : BenchWidth * BenchHeight * 3, true);
+	uint8_t *pixels = paletted ? canvas.GetPixels() : rgb.Data();
+	int pitch = paletted ? canvas.GetPitch() : BenchWidth * 3;
+	if (!paletted && screen->FlipSavePic())
+	{
+		pixels += (BenchHeight - 1) * pitch;
+		pitch = -pitch;
+	}
+
+	FileWriter *out = FileWriter::Open(BenchOutput);
+	if (out == nullptr)
+	{
+		I_FatalError("Unable to create %s", BenchOutput.GetChars());
+	}
+	out->Printf("# map %s, %s, %dx%d\n", primaryLevel->MapName.GetChars(), paletted ? "software" : "softpoly", BenchWidth, BenchHeight);
+	out->Printf("frame,x,y,z,yaw,pitch,total_ms,bsp_ms,walls_ms,planes_ms,sprites_ms%s\n", BenchHash ? ",hash" : "");
+
+	AActor *camera = Spawn(primaryLevel, NAME_MapSpot, BenchPath[0].Pos, NO_REPLACE);
+	camera->CameraHeight = 0;
+
+	bool savedactive = glcycle_t::active;
+	glcycle_t::active = true;
+
+	int numframes = 0;
+	for (unsigned i = 0; i < BenchPath.Size() - 1; i++) numframes += BenchPath[i].Frames;
+	numframes++;
+
+	// Render the first frame once without timing it so that texture precaching is not part of the results.
+	FBenchFrameTimes times, sum = {}, worst = {};
+	SetBenchCamera(camera, 0);
+	RenderBenchFrame(camera, &canvas, rgb, times);
+
+	for (int frame = 0; frame < numframes; frame++)
+	{
+		SetBenchCamera(camera, frame);
+		RenderBenchFrame(camera, &canvas, rgb, times);
+
+		sum.Total += times.Total;
+		sum.Bsp += times.Bsp;
+		sum.Walls += times.Walls;
+		sum.Planes += times.Planes;
+		sum.Sprites += times.Sprites;
+		worst.Total = max(worst.Total, times.Total);
+
+		auto pos = camera->Pos();
+		out->Printf("%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f", frame, pos.X, pos.Y, pos.Z,
+			camera->Angles.Yaw.Degrees, camera->Angles.Pitch.Degrees, times.Total, times.Bsp, times.Walls, times.Planes, times.Sprites);
+
+		if (BenchHash)
+		{
+			MD5Context md5;
+			uint8_t digest[16];
+			for (int y = 0; y < BenchHeight; y++)
+			{
+				md5.Update(pixels + y * pitch, BenchWidth * pixelsize);
+			}
+			md5.Final(digest);
+			out->Printf(",");
+			for (auto c : digest) out->Printf("%02x", c);
+		}
+		out->Printf("\n");
+
+		if (BenchShots.IsNotEmpty())
+		{
+			FString shotname;
+			shotname.Format("%s%05d.png", BenchShots.GetChars(), frame);
+			FileWriter *shot = FileWriter::Open(shotname);
+			if (shot != nullptr)
+			{
+				WritePNGfile(shot, pixels, GPalette.BaseColors, paletted ? SS_PAL : SS_RGB, BenchWidth, BenchHeight, pitch, vid_gamma);
+				delete shot;
+			}
+		}
+	}
+
+	glcycle_t::active = savedactive;
+	camera->Destroy();
+
+	out->Printf("# average: total=%.3f bsp=%.3f walls=%.3f planes=%.3f sprites=%.3f, worst frame=%.3f ms\n",
+		sum.Total / numframes, sum.Bsp / numframes, sum.Walls / numframes, sum.Planes / numframes, sum.Sprites / numframes, worst.Total);
+	delete out;
+
+	Printf("Rendered %d frames in %.3f ms (%.2f fps), results written to %s\n", numframes, sum.Total, numframes * 1000. / sum.Total, BenchOutput.GetChars());
+	throw CExitEvent(0);
+}
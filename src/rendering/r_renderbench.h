@@ -0,0 +1,9 @@
+#ifndef __R_RENDERBENCH_H
+#define __R_RENDERBENCH_H
+
+// Offscreen render benchmark (-renderbench <map> <camerapath>)
+void R_InitRenderBench(const char *pathfile);
+bool R_RenderBenchPending();
+void R_RunRenderBench();
+
+#endif
@@ -214,6 +214,15 @@ void FSoftwareRenderer::WriteSavePic (player_t *player, FileWriter *file, int wi
 	DoWriteSavePic(file, SS_PAL, pic.GetPixels(), width, height, r_viewpoint.sector, false);
 }
 
+void FSoftwareRenderer::RenderViewToCanvas(AActor *camera, DCanvas *canvas, int width, int height)
+{
+	mScene.MainThread()->Viewport->viewpoint = r_viewpoint;
+	mScene.MainThread()->Viewport->viewwindow = r_viewwindow;
+	mScene.RenderViewToCanvas(camera, canvas, 0, 0, width, height);
+	r_viewpoint = mScene.MainThread()->Viewport->viewpoint;
+	r_viewwindow = mScene.MainThread()->Viewport->viewwindow;
+}
+
 void FSoftwareRenderer::DrawRemainingPlayerSprites()
 {
 	mScene.MainThread()->Viewport->viewpoint = r_viewpoint;
@@ -17,6 +17,9 @@ struct FSoftwareRenderer : public FRenderer
 	// renders view to a savegame picture
 	void WriteSavePic (player_t *player, FileWriter *file, int width, int height) override;
 
+	// renders a camera's view into an offscreen canvas
+	void RenderViewToCanvas(AActor *camera, DCanvas *canvas, int width, int height) override;
+
 	// draws player sprites with hardware acceleration (only useful for software rendering)
 	void DrawRemainingPlayerSprites() override;
 
@@ -815,7 +815,7 @@ namespace swrenderer
 		}
 	}
 
-	void RenderOpaquePass::RenderScene(FLevelLocals *Level)
+	void RenderOpaquePass::RenderScene(FLevelLocals *Level, bool usepvs)
 	{
 		if (Thread->MainThread)
 			WallCycles.Clock();
@@ -829,7 +829,9 @@ namespace swrenderer
 		SeenActors.clear();
 
 		InSubsector = nullptr;
+		UsePVS = usepvs;
 		RenderBSPNode(Level->HeadNode());	// The head node is the last node output.
+		UsePVS = false;
 
 		if (Thread->MainThread)
 			WallCycles.Unclock();
@@ -852,6 +854,10 @@ namespace swrenderer
 		{
 			node_t *bsp = (node_t *)node;
 
+			// Nothing below this node can be seen from the view's subsector. Polyobject mini-BSPs are not part of the PVS.
+			if (UsePVS && InSubsector == nullptr && !Thread->Viewport->Level()->pvs.IsNodeVisible(bsp->Index()))
+				return;
+
 			// Decide which side the view point is on.
 			int side = R_PointOnSide(Thread->Viewport->viewpoint.Pos, bsp);
 
@@ -865,7 +871,10 @@ namespace swrenderer
 
 			node = bsp->children[side];
 		}
-		RenderSubsector((subsector_t *)((uint8_t *)node - 1));
+		subsector_t *sub = (subsector_t *)((uint8_t *)node - 1);
+		if (UsePVS && InSubsector == nullptr && !Thread->Viewport->Level()->pvs.IsSubsectorVisible(sub->Index()))
+			return;
+		RenderSubsector(sub);
 	}
 
 	void RenderOpaquePass::ClearClip()
@@ -64,7 +64,7 @@ namespace swrenderer
 		RenderOpaquePass(RenderThread *thread);
 
 		void ClearClip();
-		void RenderScene(FLevelLocals *Level);
+		void RenderScene(FLevelLocals *Level, bool usepvs = false);
 
 		void ResetFakingUnderwater() { r_fakingunderwater = false; }
 		sector_t *FakeFlat(sector_t *sec, sector_t *tempsec, int *floorlightlevel, int *ceilinglightlevel, seg_t *backline, int backx1, int backx2, double frontcz1, double frontcz2);
@@ -94,6 +94,7 @@ namespace swrenderer
 		bool GetThingSprite(AActor *thing, ThingSprite &sprite);
 
 		subsector_t *InSubsector = nullptr;
+		bool UsePVS = false;
 		WaterFakeSide FakeSide = WaterFakeSide::Center;
 		bool r_fakingunderwater = false;
 
@@ -61,6 +61,7 @@
 
 EXTERN_CVAR(Int, r_clearbuffer)
 EXTERN_CVAR(Int, r_debug_draw)
+EXTERN_CVAR(Bool, r_pvs)
 
 CVAR(Int, r_scene_multithreaded, 1, 0);
 CVAR(Bool, r_models, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
@@ -156,6 +157,9 @@ namespace swrenderer
 
 		this->dontmaplines = dontmaplines;
 
+		auto Level = MainThread()->Viewport->Level();
+		usepvs = r_pvs && Level->pvs.SetViewpoint(Level, MainThread()->Viewport->viewpoint.Pos.XY());
+
 		R_UpdateFuzzPosFrameStart();
 
 		if (r_modelscene)
@@ -272,7 +276,7 @@ namespace swrenderer
 		if (thread->X2 < viewwidth)
 			thread->ClipSegments->Clip(thread->X2, viewwidth, true, &visitor);
 
-		thread->OpaquePass->RenderScene(thread->Viewport->Level());
+		thread->OpaquePass->RenderScene(thread->Viewport->Level(), usepvs);
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
 
 		if (viewactive)
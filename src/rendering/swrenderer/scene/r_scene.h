@@ -67,6 +67,7 @@ namespace swrenderer
 		void StopThreads();
 		
 		bool dontmaplines = false;
+		bool usepvs = false;
 		int clearcolor = 0;
 
 		std::unique_ptr<PolyDepthStencil> DepthStencil;
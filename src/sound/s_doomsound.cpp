@@ -277,6 +277,8 @@ void S_Shutdown()
 }
 
 
+static TMap<PClassActor*, bool> PreloadedClasses;
+
 //==========================================================================
 //
 // S_Start
@@ -287,6 +289,7 @@ void S_Shutdown()
 
 void S_Start()
 {
+	PreloadedClasses.Clear();
 	if (GSnd && soundEngine)
 	{
 		// kill all playing sounds at start of level (trust me - a good idea)
@@ -379,6 +382,39 @@ void S_PrecacheLevel(FLevelLocals* Level)
 }
 
 
+//==========================================================================
+//
+// S_PreloadActorSounds
+//
+// Called for every spawned actor. The first time a class appears after
+// the level has started, its sounds get decoded in the background so
+// that they are ready by the time it makes any noise. Everything that was
+// there from the start has already been handled by S_PrecacheLevel.
+//
+//==========================================================================
+
+void S_PreloadActorSounds(AActor* actor)
+{
+	if (GSnd == nullptr || actor->Level != primaryLevel || actor->Level->maptime == 0)
+	{
+		return;
+	}
+	auto cls = actor->GetClass();
+	if (PreloadedClasses.CheckKey(cls) != nullptr)
+	{
+		return;
+	}
+	PreloadedClasses.Insert(cls, true);
+
+	IFVIRTUALPTR(actor, AActor, MarkPrecacheSounds)
+	{
+		VMValue params[1] = { actor };
+		soundEngine->SetPreloadMarked(true);
+		VMCall(func, params, 1, nullptr, 0);
+		soundEngine->SetPreloadMarked(false);
+	}
+}
+
 //==========================================================================
 //
 // S_InitData
@@ -904,6 +940,7 @@ void S_SerializeSounds(FSerializer &arc)
 			{
 				chan = (FSoundChan*)soundEngine->GetChannel(nullptr);
 				arc(nullptr, *chan);
+				soundEngine->IndexChannel(chan);
 				// Sounds always start out evicted when restored from a save.
 				chan->ChanFlags |= CHANF_EVICTED | CHANF_ABSTIME;
 			}
@@ -1562,6 +1599,27 @@ DEFINE_ACTION_FUNCTION(DObject, S_ResumeSound)
 }
 
 
+//==========================================================================
+//
+// CCMD soundloadstats
+//
+// Shows how long the game had to wait for sounds that were not loaded
+// when they were first played. "soundloadstats reset" starts over.
+//
+//==========================================================================
+
+CCMD(soundloadstats)
+{
+	if (argv.argc() > 1 && !stricmp(argv[1], "reset"))
+	{
+		soundEngine->ResetLoadStats();
+	}
+	else
+	{
+		Printf("soundloadstats: %s", soundEngine->GetLoadStats().GetChars());
+	}
+}
+
 CCMD (snd_status)
 {
 	GSnd->PrintStatus ();
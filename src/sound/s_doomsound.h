@@ -13,6 +13,7 @@ void S_Shutdown();
 void S_UpdateSounds(AActor* listenactor);
 
 void S_PrecacheLevel(FLevelLocals* l);
+void S_PreloadActorSounds(AActor* actor);
 
 // Start sound for thing at <ent>
 void S_Sound(int channel, EChanFlags flags, FSoundID sfxid, float volume, float attenuation);
@@ -40,14 +40,25 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <thread>
 
 #include "doomdata.h"
 #include "nodebuild.h"
+#include "c_cvars.h"
+#include "ctpl.h"
 
 const int MaxSegs = 64;
 const int SplitCost = 8;
 const int AAPreference = 16;
 
+// Below this many seg classifications per SelectSplitter call it is
+// faster to score the splitters on the calling thread.
+const unsigned int MinParallelWork = 32768;
+
+CVARD(Int, gennodes_threads, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG, "Number of threads used to score splitters when building nodes. 0 = one per core, 1 = disabled")
+
+static ctpl::thread_pool NodePool;
+
 #if 0
 #define D(x) x
 #else
@@ -106,6 +117,8 @@ void FNodeBuilder::Clear()
 	Planes.Clear();
 	Touched.Clear();
 	Colinear.Clear();
+	Candidates.Clear();
+	Scores.Clear();
 	SplitSharers.Clear();
 	if (VertexMap == NULL)
 	{
@@ -444,6 +457,7 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	int bestvalue;
 	uint32_t bestseg;
 	uint32_t seg;
+	unsigned int count = 0;
 	bool nosplitters = false;
 
 	bestvalue = 0;
@@ -453,6 +467,7 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	stepleft = 0;
 
 	memset (&PlaneChecked[0], 0, PlaneChecked.Size());
+	Candidates.Clear();
 
 	D(Printf (PRINT_LOG, "Processing set %d\n", set));
 
@@ -473,28 +488,35 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 				}
 
 				stepleft = step;
-				SetNodeFromSeg (node, pseg);
-
-				int value = Heuristic (node, set, nosplit);
-
-				D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg, Segs[seg].linedef, node.x>>16, node.y>>16,
-					(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
-
-				if (value > bestvalue)
-				{
-					bestvalue = value;
-					bestseg = seg;
-				}
-				else if (value < 0)
-				{
-					nosplitters = true;
-				}
+				Candidates.Push (seg);
 			}
 		}
 
+		count++;
 		seg = pseg->next;
 	}
 
+	ScoreSplitters (set, count, Candidates, Scores, nosplit);
+
+	// The scores are only compared after all of them are known and always in
+	// set order, so the chosen splitter does not depend on the thread count.
+	for (unsigned int i = 0; i < Candidates.Size(); ++i)
+	{
+		int value = Scores[i];
+
+		D(Printf (PRINT_LOG, "Seg %5d, ld %d scores %d\n", Candidates[i], Segs[Candidates[i]].linedef, value));
+
+		if (value > bestvalue)
+		{
+			bestvalue = value;
+			bestseg = Candidates[i];
+		}
+		else if (value < 0)
+		{
+			nosplitters = true;
+		}
+	}
+
 	if (bestseg == UINT_MAX)
 	{ // No lines split any others into two sets, so this is a convex region.
 	D(Printf (PRINT_LOG, "set %d, step %d, nosplit %d has no good splitter (%d)\n", set, step, nosplit, nosplitters));
@@ -508,6 +530,61 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	return 1;
 }
 
+// Runs the heuristic for every candidate splitter of a set. Heuristic() only
+// reads the seg and vertex arrays, so for large sets the candidates are spread
+// over the node builder's thread pool, each thread with its own loop lists.
+
+void FNodeBuilder::ScoreSplitters (uint32_t set, unsigned int count, const TArray<uint32_t> &candidates, TArray<int> &scores, bool nosplit)
+{
+	unsigned int numcandidates = candidates.Size();
+	int numthreads = gennodes_threads > 0 ? gennodes_threads : (int)std::thread::hardware_concurrency();
+
+	scores.Resize (numcandidates);
+
+	if (numthreads > (int)numcandidates)
+	{
+		numthreads = numcandidates;
+	}
+	if (numthreads <= 1 || count * numcandidates < MinParallelWork)
+	{
+		for (unsigned int i = 0; i < numcandidates; ++i)
+		{
+			node_t node;
+			SetNodeFromSeg (node, &Segs[candidates[i]]);
+			scores[i] = Heuristic (node, set, nosplit);
+		}
+		return;
+	}
+
+	if (NodePool.size() < numthreads - 1)
+	{
+		NodePool.resize (numthreads - 1);
+	}
+
+	auto scorefunc = [&](int first)
+	{
+		TArray<int> touched, colinear;
+		for (unsigned int i = first; i < numcandidates; i += numthreads)
+		{
+			node_t node;
+			SetNodeFromSeg (node, &Segs[candidates[i]]);
+			scores[i] = Heuristic (node, set, nosplit, touched, colinear);
+		}
+	};
+
+	TArray<std::future<void>> futures;
+	futures.Reserve (numthreads - 1);
+	for (int i = 1; i < numthreads; ++i)
+	{
+		futures[i - 1] = NodePool.push ([&, i](int) { scorefunc (i); });
+	}
+	scorefunc (0);
+	for (auto &future : futures)
+	{
+		future.wait ();
+	}
+}
+
 // Given a splitter (node), returns a score based on how "good" the resulting
 // split in a set of segs is. Higher scores are better. -1 means this splitter
 // splits something it shouldn't and will only be returned if honorNoSplit is
@@ -515,6 +592,11 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 // in the set.
 
 int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
+{
+	return Heuristic (node, set, honorNoSplit, Touched, Colinear);
+}
+
+int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit, TArray<int> &touched, TArray<int> &colinear)
 {
 	// Set the initial score above 0 so that near vertex anti-weighting is less likely to produce a negative score.
 	int score = 1000000;
@@ -529,8 +611,8 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	unsigned int max, m2, p, q;
 	double frac;
 
-	Touched.Clear ();
-	Colinear.Clear ();
+	touched.Clear ();
+	colinear.Clear ();
 
 	while (i != UINT_MAX)
 	{
@@ -556,32 +638,32 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 			{
 				if ((sidev[0] | sidev[1]) != 0)
 				{
-					max = Touched.Size();
+					max = touched.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Touched[p] == test->loopnum)
+						if (touched[p] == test->loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Touched.Push (test->loopnum);
+						touched.Push (test->loopnum);
 					}
 				}
 				else
 				{
-					max = Colinear.Size();
+					max = colinear.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Colinear[p] == test->loopnum)
+						if (colinear[p] == test->loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Colinear.Push (test->loopnum);
+						colinear.Push (test->loopnum);
 					}
 				}
 			}
@@ -698,8 +780,8 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	// seg of that sector must be crossing the container's corner and does not
 	// actually split the container.
 
-	max = Touched.Size ();
-	m2 = Colinear.Size ();
+	max = touched.Size ();
+	m2 = colinear.Size ();
 
 	// If honorNoSplit is false, then both these lists will be empty.
 
@@ -712,10 +794,10 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 
 	for (p = 0; p < max; ++p)
 	{
-		int look = Touched[p];
+		int look = touched[p];
 		for (q = 0; q < m2; ++q)
 		{
-			if (look == Colinear[q])
+			if (look == colinear[q])
 			{
 				break;
 			}
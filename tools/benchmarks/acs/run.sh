@@ -0,0 +1,29 @@
+#!/bin/sh
+# Measures the time spent in the ACS interpreter on script heavy maps.
+#
+# Usage: run.sh <gzdoom executable> <iwad> <pwad> <map> [<map>...]
+#
+# Each map is played for TICS tics (default 1050, 30 seconds) without input
+# and the average time per tic is taken from the acstime console command.
+# Run it once for each build that should be compared.
+
+if [ $# -lt 4 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> <pwad> <map> [<map>...]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+PWAD="$3"
+shift 3
+TICS="${TICS:-1050}"
+LOG="$(mktemp)"
+
+for MAP in "$@"; do
+	rm -f "$LOG"
+	timeout 300 "$GZDOOM" -iwad "$IWAD" -file "$PWAD" -nosound -nomusic -skill 3 \
+		+logfile "$LOG" +"map $MAP; wait 35; acstime reset; wait $TICS; acstime; quit" >/dev/null 2>&1
+	printf "%-8s " "$MAP"
+	grep "acstime:" "$LOG" || echo "no result"
+done
+rm -f "$LOG"
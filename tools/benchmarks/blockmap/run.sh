@@ -0,0 +1,38 @@
+#!/bin/sh
+# Compares the regular and the fine grained generated blockmap.
+#
+# Usage: run.sh <gzdoom executable> <iwad> <pwad> <map> [demo]
+#
+# The map is loaded with a generated blockmap, once with 128 unit blocks and
+# once with genfineblockmap, and the build time is taken from the
+# "BLOCKMAP generation took" developer message. If a demo recorded on the map
+# is given it is also played back with -timedemo for both settings. Note that
+# the block size changes the order in which lines are checked, so demos
+# recorded with one setting may desync with the other.
+
+if [ $# -lt 4 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> <pwad> <map> [demo]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+PWAD="$3"
+MAP="$4"
+DEMO="$5"
+LOG="$(mktemp)"
+
+for FINE in 0 1; do
+	rm -f "$LOG"
+	timeout 300 "$GZDOOM" -iwad "$IWAD" -file "$PWAD" -nosound -nomusic -skill 3 \
+		+logfile "$LOG" +developer 3 +genblockmap 1 +genfineblockmap $FINE +"map $MAP; wait 1; quit" >/dev/null 2>&1
+	printf "genfineblockmap=%s " "$FINE"
+	grep -m 1 "BLOCKMAP generation took" "$LOG" || echo "no result"
+
+	if [ -n "$DEMO" ]; then
+		printf "genfineblockmap=%s " "$FINE"
+		timeout 600 "$GZDOOM" -iwad "$IWAD" -file "$PWAD" -nosound -nomusic \
+			+genblockmap 1 +genfineblockmap $FINE -timedemo "$DEMO" 2>&1 | grep -m 1 "gametics in" || echo "no result"
+	fi
+done
+rm -f "$LOG"
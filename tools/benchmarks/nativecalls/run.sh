@@ -0,0 +1,27 @@
+#!/bin/sh
+# Compares the per-call cost of natives with and without the JIT's direct call path.
+#
+# Usage: run.sh <gzdoom executable> <iwad> [map]
+#
+# The engine can't be told to quit from script code, so each run is stopped
+# after a fixed time and the results are taken from the log file.
+# vm_jit_hotcalls 1 lets the second pass of the benchmark run in JIT tier 2.
+
+if [ $# -lt 2 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> [map]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+MAP="${3:-MAP01}"
+DIR="$(cd "$(dirname "$0")" && pwd)"
+LOG="$(mktemp)"
+
+for DIRECT in 0 1; do
+	rm -f "$LOG"
+	timeout 60 "$GZDOOM" -iwad "$IWAD" -file "$DIR" -nosound -nomusic -skill 1 \
+		+vm_jit_directnative $DIRECT +vm_jit_hotcalls 1 +logfile "$LOG" +map "$MAP" >/dev/null 2>&1
+	grep "nativebench:" "$LOG"
+done
+rm -f "$LOG"
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Measures the time the internal node builder needs for large maps.
+#
+# Usage: run.sh <gzdoom executable> <iwad> <pwad> <map> [<map>...]
+#
+# Every map is loaded with gennodes enabled, once with a single thread and
+# once with the default thread count, and the build time is taken from the
+# "BSP generation took" developer message.
+
+if [ $# -lt 4 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> <pwad> <map> [<map>...]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+PWAD="$3"
+shift 3
+LOG="$(mktemp)"
+
+for MAP in "$@"; do
+	for THREADS in 1 0; do
+		rm -f "$LOG"
+		timeout 300 "$GZDOOM" -iwad "$IWAD" -file "$PWAD" -nosound -nomusic -skill 3 \
+			+logfile "$LOG" +developer 3 +gennodes 1 +gennodes_threads $THREADS +"map $MAP; wait 1; quit" >/dev/null 2>&1
+		printf "%-8s threads=%s " "$MAP" "$THREADS"
+		grep -m 1 "BSP generation took" "$LOG" || echo "no result"
+	done
+done
+rm -f "$LOG"
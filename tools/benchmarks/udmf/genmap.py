@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# Writes a PWAD with one large UDMF map for parser benchmarks.
+#
+# Usage: genmap.py <output.wad> [cells]
+#
+# The map is a grid of cells x cells square rooms, each with its own sector,
+# four linedefs, four sidedefs and a few user keys. 100 cells give a TEXTMAP
+# of about 10 MB, size grows with the square of the cell count.
+
+import struct
+import sys
+
+def textmap(cells):
+	out = ['namespace = "zdoom";\n\n']
+	size = 128
+	v = 0
+	for y in range(cells):
+		for x in range(cells):
+			x0, y0 = x * (size + 16), y * (size + 16)
+			for vx, vy in ((x0, y0), (x0, y0 + size), (x0 + size, y0 + size), (x0 + size, y0)):
+				out.append('vertex\n{\nx = %d.000;\ny = %d.000;\n}\n\n' % (vx, vy))
+			s = y * cells + x
+			out.append('sector\n{\nheightfloor = 0;\nheightceiling = 128;\ntexturefloor = "FLOOR0_1";\n'
+				'textureceiling = "CEIL1_1";\nlightlevel = 160;\nid = %d;\nuser_cell = %d;\n}\n\n' % (s + 1, s))
+			for i in range(4):
+				out.append('linedef\n{\nv1 = %d;\nv2 = %d;\nsidefront = %d;\nblocking = true;\n'
+					'comment = "cell %d edge %d";\n}\n\n' % (v + i, v + (i + 1) % 4, s * 4 + i, s, i))
+				out.append('sidedef\n{\nsector = %d;\ntexturemiddle = "STARTAN2";\noffsetx = %d;\n}\n\n' % (s, i * 32))
+			v += 4
+	out.append('thing\n{\nx = 64.000;\ny = 64.000;\nangle = 90;\ntype = 1;\n'
+		'skill1 = true;\nskill2 = true;\nskill3 = true;\nskill4 = true;\nskill5 = true;\nsingle = true;\n}\n\n')
+	return ''.join(out).encode('ascii')
+
+def main():
+	if len(sys.argv) < 2:
+		print('Usage: %s <output.wad> [cells]' % sys.argv[0])
+		sys.exit(1)
+	cells = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+	lumps = [(b'MAP01', b''), (b'TEXTMAP', textmap(cells)), (b'ENDMAP', b'')]
+	data = b''
+	directory = b''
+	offset = 12
+	for name, content in lumps:
+		directory += struct.pack('<ii8s', offset, len(content), name)
+		data += content
+		offset += len(content)
+	with open(sys.argv[1], 'wb') as f:
+		f.write(struct.pack('<4sii', b'PWAD', len(lumps), offset))
+		f.write(data)
+		f.write(directory)
+	print('%s: TEXTMAP %d bytes' % (sys.argv[1], len(lumps[1][1])))
+
+main()
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Compares TEXTMAP parse times with and without the threaded tokenizer.
+#
+# Usage: run.sh <gzdoom executable> <iwad> [cells...]
+#
+# A synthetic map is generated for every cell count (default 100 and 300)
+# and loaded twice. The times come from the "TEXTMAP parsing took"
+# developer message.
+
+if [ $# -lt 2 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> [cells...]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+shift 2
+if [ $# -eq 0 ]; then
+	set -- 100 300
+fi
+DIR="$(cd "$(dirname "$0")" && pwd)"
+WAD="${TMPDIR:-/tmp}/udmfbench$$.wad"
+LOG="$(mktemp)"
+
+for CELLS in "$@"; do
+	python3 "$DIR/genmap.py" "$WAD" "$CELLS"
+	for THREADED in 0 1; do
+		rm -f "$LOG"
+		timeout 600 "$GZDOOM" -iwad "$IWAD" -file "$WAD" -nosound -nomusic -skill 3 \
+			+logfile "$LOG" +developer 3 +udmf_threadedscan $THREADED +"map MAP01; wait 1; quit" >/dev/null 2>&1
+		printf "cells=%-5s threaded=%s " "$CELLS" "$THREADED"
+		grep -m 1 "TEXTMAP parsing took" "$LOG" || echo "no result"
+	done
+done
+rm -f "$WAD" "$LOG"
@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+# Writes a random input script for -ticinput.
+#
+# Usage: geninput.py <tics> [<seed>]
+#
+# The player runs around, turns, looks up and down and fires in bursts of a
+# few tics, then quits once <tics> tics have been played.
+
+import random
+import sys
+
+if len(sys.argv) < 2:
+    sys.exit("Usage: geninput.py <tics> [<seed>]")
+
+tics = int(sys.argv[1])
+rng = random.Random(int(sys.argv[2]) if len(sys.argv) > 2 else 0)
+
+BT_ATTACK = 1
+BT_USE = 2
+
+print("# tic buttons forwardmove sidemove yaw pitch upmove")
+tic = 0
+while tic < tics:
+    buttons = 0
+    if rng.random() < 0.3:
+        buttons |= BT_ATTACK
+    if rng.random() < 0.1:
+        buttons |= BT_USE
+    forward = rng.choice((0, 0x1900, 0x3200, -0x1900))
+    side = rng.choice((0, 0, 0x1800, -0x1800))
+    yaw = rng.randint(-0x300, 0x300)
+    pitch = rng.randint(-0x40, 0x40)
+    print(tic, buttons, forward, side, yaw, pitch, 0)
+    tic += rng.randint(4, 35)
+print("quit", tics)
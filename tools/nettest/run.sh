@@ -0,0 +1,61 @@
+#!/bin/sh
+# Runs an unattended netgame with several instances over the loopback
+# interface and reports game speed, input lag and sync state for each.
+#
+# Usage: run.sh <gzdoom executable> <iwad> <map> [<extra arguments>...]
+#
+# PLAYERS (default 4) instances are started without drawing, sound or music,
+# the host on PORT (default 5029). Each player gets its own input script from
+# geninput.py, seeded with its player number, and quits after TICS tics
+# (default 2100, one minute of game time). All files are written to OUT
+# (default nettest). LATENCY (milliseconds) and LOSS (percent) are passed to
+# net_fakelatency and net_fakeloss, these only work in debug builds.
+# The sync log of every player is compared against the host's.
+
+if [ $# -lt 3 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> <map> [<extra arguments>...]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+MAP="$3"
+shift 3
+PLAYERS="${PLAYERS:-4}"
+PORT="${PORT:-5029}"
+TICS="${TICS:-2100}"
+OUT="${OUT:-nettest}"
+LATENCY="${LATENCY:-0}"
+LOSS="${LOSS:-0}"
+DIR="$(dirname "$0")"
+
+mkdir -p "$OUT"
+PIDS=""
+i=1
+while [ $i -le "$PLAYERS" ]; do
+	rm -f "$OUT/sync$i.log" "$OUT/stats$i.log"
+	python3 "$DIR/geninput.py" "$TICS" $i > "$OUT/input$i.txt"
+	if [ $i -eq 1 ]; then
+		NET="-host $PLAYERS -port $PORT"
+	else
+		NET="-join 127.0.0.1:$PORT"
+	fi
+	# Leave a minute for the other players to connect.
+	timeout $((TICS / 35 + 60)) "$GZDOOM" -iwad "$IWAD" $NET -nodraw -nosound -nomusic \
+		-ticinput "$OUT/input$i.txt" -netstats "$OUT/stats$i.log" "$@" +map "$MAP" \
+		+net_fakelatency "$LATENCY" +net_fakeloss "$LOSS" +synclog "$OUT/sync$i.log" >"$OUT/console$i.txt" 2>&1 &
+	PIDS="$PIDS $!"
+	[ $i -eq 1 ] && sleep 1
+	i=$((i + 1))
+done
+wait $PIDS
+
+i=1
+while [ $i -le "$PLAYERS" ]; do
+	printf "player %d: " $i
+	tail -n 1 "$OUT/stats$i.log" 2>/dev/null || echo "no stats"
+	if [ $i -gt 1 ]; then
+		python3 "$DIR/../synccheck/syncdiff.py" "$OUT/sync1.log" "$OUT/sync$i.log" | sed 's/^/  /'
+	fi
+	i=$((i + 1))
+done
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Runs a two player netgame over the loopback interface with sync logging
+# enabled on both sides and compares the logs afterwards.
+#
+# Usage: run.sh <gzdoom executable> <iwad> <map> [<extra arguments>...]
+#
+# Both instances run on this machine, the host on PORT (default 5029) and
+# the other one on a random port. The game runs for DURATION seconds (default 60)
+# before both are stopped, DETAIL (default 1) is passed to synclog_detail.
+# The logs are kept in the current directory as sync1.log and sync2.log.
+# LATENCY (milliseconds) and LOSS (percent) are passed to net_fakelatency
+# and net_fakeloss on both sides, these only work in debug builds.
+
+if [ $# -lt 3 ]; then
+	echo "Usage: $0 <gzdoom executable> <iwad> <map> [<extra arguments>...]"
+	exit 1
+fi
+
+GZDOOM="$1"
+IWAD="$2"
+MAP="$3"
+shift 3
+PORT="${PORT:-5029}"
+DURATION="${DURATION:-60}"
+DETAIL="${DETAIL:-1}"
+LATENCY="${LATENCY:-0}"
+LOSS="${LOSS:-0}"
+DIR="$(dirname "$0")"
+
+rm -f sync1.log sync2.log
+timeout "$DURATION" "$GZDOOM" -iwad "$IWAD" -host 2 -port "$PORT" -nosound -nomusic "$@" +map "$MAP" \
+	+net_fakelatency "$LATENCY" +net_fakeloss "$LOSS" +synclog_detail "$DETAIL" +synclog sync1.log >/dev/null 2>&1 &
+HOST=$!
+sleep 1
+timeout "$DURATION" "$GZDOOM" -iwad "$IWAD" -join "127.0.0.1:$PORT" -nosound -nomusic "$@" \
+	+net_fakelatency "$LATENCY" +net_fakeloss "$LOSS" +synclog_detail "$DETAIL" +synclog sync2.log >/dev/null 2>&1
+wait $HOST
+
+python3 "$DIR/syncdiff.py" sync1.log sync2.log
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# Compares two sync logs written with the synclog CVAR and reports the
+# first tic at which the game states differ.
+#
+# Usage: syncdiff.py <log1> <log2>
+#
+# Logs written with synclog_detail 1 or higher also tell which actor was
+# the first one to diverge, with synclog_detail 2 the same is done for
+# sectors and RNGs. Actors are listed in thinker order, so an actor that
+# was only spawned on one side shows up as the first difference as well.
+
+import sys
+
+def read_tics(path):
+	tic = None
+	with open(path) as f:
+		for line in f:
+			fields = line.split()
+			if not fields:
+				continue
+			if fields[0] == 'tic':
+				if tic is not None:
+					yield tic
+				tic = {'tic': int(fields[1]), 'summary': [line.rstrip()], 'a': [], 's': [], 'r': []}
+			elif tic is not None:
+				if fields[0] == 'level':
+					tic['summary'].append(line.rstrip())
+				elif fields[0] in ('a', 's', 'r'):
+					tic[fields[0]].append(line.rstrip())
+	if tic is not None:
+		yield tic
+
+def first_difference(list1, list2):
+	for i in range(max(len(list1), len(list2))):
+		line1 = list1[i] if i < len(list1) else '(none)'
+		line2 = list2[i] if i < len(list2) else '(none)'
+		if line1 != line2:
+			return line1, line2
+	return None
+
+def main():
+	if len(sys.argv) != 3:
+		print('Usage: %s <log1> <log2>' % sys.argv[0])
+		return 2
+
+	names = {'a': 'actor', 's': 'sector', 'r': 'RNG'}
+	count = 0
+	for tic1, tic2 in zip(read_tics(sys.argv[1]), read_tics(sys.argv[2])):
+		if tic1['tic'] != tic2['tic']:
+			print('Logs are not aligned: tic %d vs. tic %d' % (tic1['tic'], tic2['tic']))
+			return 1
+		count += 1
+		if tic1['summary'] == tic2['summary'] and all(tic1[k] == tic2[k] for k in names):
+			continue
+
+		print('First difference at tic %d' % tic1['tic'])
+		diff = first_difference(tic1['summary'], tic2['summary'])
+		if diff:
+			print('  1: %s\n  2: %s' % diff)
+		for key, name in names.items():
+			diff = first_difference(tic1[key], tic2[key])
+			if diff:
+				print('First diverging %s:\n  1: %s\n  2: %s' % ((name,) + diff))
+		return 1
+
+	print('No difference in %d tics' % count)
+	return 0
+
+if __name__ == '__main__':
+	sys.exit(main())